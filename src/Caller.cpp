@@ -76,6 +76,7 @@ Caller::Caller()
       numIterations_(10),
       maxPSMs_(0u),
       nestedXvalBins_(1u),
+      subsetHashSampling_(false),
       selectedCpos_(0.0),
       selectedCneg_(0.0),
       reportEachIteration_(false),
@@ -201,6 +202,13 @@ bool Caller::parseOptions(int argc, char** argv) {
       "numbers (>1 million) of PSMs. When set to 0, all PSMs are used for "
       "training as normal. Default = 0.",
       "number");
+  cmd.defineOption(Option::NO_SHORT_OPT, "subset-hash-sampling",
+                   "Select the training subset of -N by a seeded hash of the "
+                   "scan number and experimental mass instead of by reservoir "
+                   "sampling. The subset is then read in parallel and with "
+                   "less memory, but its size is only approximately <x>. "
+                   "Only used for pin files that can be memory mapped.",
+                   "", TRUE_IF_SET);
   cmd.defineOption("x", "quick-validation",
                    "Quicker execution by reduced internal cross-validation.",
                    "", TRUE_IF_SET);
@@ -212,6 +220,13 @@ bool Caller::parseOptions(int argc, char** argv) {
       "[set by default] Input file given in pin-tab format. This is the "
       "default setting, flag only present for backwards compatibility.",
       "filename");
+  cmd.defineOption("", "pin-cache",
+                   "Binary cache of the parsed tab delimited input. If the "
+                   "file was made from the same input files, the PSMs are "
+                   "read from it instead of from the input, otherwise it is "
+                   "(re)written after reading the input. Not used together "
+                   "with -N or input from stdin.",
+                   "filename");
   cmd.defineOption("k", "xml-in",
                    "Input file given in deprecated pin-xml format generated by "
                    "e.g. sqt2pin with the -k option",
@@ -579,6 +594,9 @@ bool Caller::parseOptions(int argc, char** argv) {
           << "with the option --Cpos" << std::endl;
     }
   }
+  if (cmd.isOptionSet("pin-cache")) {
+    pinCacheFN_ = cmd.options["pin-cache"];
+  }
   if (cmd.isOptionSet("tab-out")) {
     tabOutputFN_ = cmd.options["tab-out"];
     checkIsWritable(tabOutputFN_);
@@ -628,6 +646,9 @@ bool Caller::parseOptions(int argc, char** argv) {
   if (cmd.isOptionSet("subset-max-train")) {
     maxPSMs_ = cmd.getUInt("subset-max-train", 0, 100000000);
   }
+  if (cmd.isOptionSet("subset-hash-sampling")) {
+    subsetHashSampling_ = true;
+  }
   if (cmd.isOptionSet("seed")) {
     PseudoRandom::setSeed(
         static_cast<unsigned long int>(cmd.getInt("seed", 1, 20000)));
@@ -929,17 +950,40 @@ void Caller::checkIsWritable(const std::string& filePath) {
   }
 }
 
-std::istream& Caller::getDataInStream(std::ifstream& fileStream) {
-  if (!readStdIn_) {
-    if (!tabInput_)
-      fileStream.exceptions(ifstream::badbit | ifstream::failbit);
-    fileStream.open(inputFN_.c_str(), ios::in);
-  } else if (maxPSMs_ > 0u) {
-    maxPSMs_ = 0u;
-    std::cerr << "Warning: cannot use subset-max-train (-N flag) when reading "
-              << "from stdin, training on all data instead." << std::endl;
-  }
-  return readStdIn_ ? std::cin : fileStream;
+std::istream& Caller::getDataInStream(
+    std::unique_ptr<std::istream>& fileStream) {
+  if (readStdIn_) {
+    // tab delimited PSMs are rescored from a temporary file, but the pin-xml
+    // input has to be read twice
+    if (maxPSMs_ > 0u && !tabInput_) {
+      maxPSMs_ = 0u;
+      std::cerr << "Warning: cannot use subset-max-train (-N flag) when reading "
+                << "from stdin, training on all data instead." << std::endl;
+    }
+    return std::cin;
+  }
+  if (inputFNs_.size() > 1) {
+    // multiple pin files are merged on the fly while reading
+    fileStream.reset(new MultiPinStream(inputFNs_));
+  } else if (tabInput_ && DecompressingStreamBuf::detectFormat(inputFN_) != 
+                            DecompressingStreamBuf::NONE) {
+    // compressed files are decompressed on a separate thread while parsing
+    fileStream = DecompressingStream::openFile(inputFN_);
+  } else if (tabInput_) {
+    // tab delimited files are parsed straight from a memory mapping if 
+    // possible, without copying each line
+    MemoryMappedFileStream* mappedStream = new MemoryMappedFileStream();
+    fileStream.reset(mappedStream);
+    if (!mappedStream->open(inputFN_)) {
+      fileStream.reset(new std::ifstream(inputFN_.c_str(), ios::in));
+    }
+  } else {
+    std::ifstream* xmlStream = new std::ifstream();
+    fileStream.reset(xmlStream);
+    xmlStream->exceptions(ifstream::badbit | ifstream::failbit);
+    xmlStream->open(inputFN_.c_str(), ios::in);
+  }
+  return *fileStream;
 }
 
 bool Caller::loadAndNormalizeData(std::istream& dataStream,
@@ -955,12 +999,44 @@ bool Caller::loadAndNormalizeData(std::istream& dataStream,
     success = xmlInterface.readPin(dataStream, inputFN_, setHandler, pCheck_,
                                    protEstimator_, enzyme_);
   } else {
-    if (VERB > 1) {
-      std::cerr << "Reading tab-delimited input from datafile " << inputFN_
-                << std::endl;
+    // the cache holds all PSMs of the input files, so it cannot stand in for 
+    // the subset read with -N, nor tell if stdin has changed
+    std::string cacheSignature;
+    if (!pinCacheFN_.empty()) {
+      if (readStdIn_ || maxPSMs_ > 0u) {
+        std::cerr << "Warning: the pin cache cannot be used together with "
+                  << "subset-max-train (-N flag) or input from stdin, "
+                  << "ignoring it." << std::endl;
+      } else {
+        cacheSignature = PinCache::getSignature(
+            inputFNs_.empty() ? std::vector<std::string>(1, inputFN_) : inputFNs_);
+      }
     }
+    if (!cacheSignature.empty() && 
+        setHandler.readCache(pinCacheFN_, cacheSignature, pCheck_)) {
+      if (VERB > 1) {
+        std::cerr << "Read tab-delimited input of " << inputFN_ 
+                  << " from pin cache " << pinCacheFN_ << std::endl;
+      }
+      success = true;
+    } else {
+      if (VERB > 1) {
+        std::cerr << "Reading tab-delimited input from datafile " << inputFN_
+                  << std::endl;
+      }
 
-    success = setHandler.readTab(dataStream, pCheck_);
+      success = setHandler.readTab(dataStream, pCheck_);
+      if (success && !cacheSignature.empty()) {
+        if (setHandler.writeCache(pinCacheFN_, cacheSignature, pCheck_)) {
+          if (VERB > 1) {
+            std::cerr << "Wrote pin cache " << pinCacheFN_ << std::endl;
+          }
+        } else {
+          std::cerr << "Warning: could not write the pin cache " 
+                    << pinCacheFN_ << "." << std::endl;
+        }
+      }
+    }
   }
 
   // Reading input files (pin or temporary file)
@@ -1079,31 +1155,36 @@ int Caller::run() {
       std::min((unsigned int)omp_get_max_threads(), numThreads_)));
 #endif
 
-  /* Validate tab file and get decoy prefix */
+  /* Validate tab file */
   TabFileValidator tabFileValidator;
-  if (!tabFileValidator.validateTabFiles(inputFNs_,
-                                         protEstimatorDecoyPrefix_)) {
+  if (!tabFileValidator.validateTabFiles(inputFNs_)) {
     return 0;
   }
+  // with "auto", the decoy prefix is detected while reading the PSMs
+  bool detectDecoyPrefix = (protEstimatorDecoyPrefix_ == "auto");
 
   if (inputFNs_.size() == 1) {
     inputFN_ = inputFNs_.at(0);
   } else if (inputFNs_.size() > 1) {
     tabInput_ = true;
-    ValidateTabFile validateTab;
-    inputFN_ = validateTab.concatenateMultiplePINs(inputFNs_);
+    inputFN_ = inputFNs_.at(0);
+    for (size_t i = 1; i < inputFNs_.size(); ++i) {
+      inputFN_ += ", " + inputFNs_.at(i);
+    }
   }
 
   int success = 0;
-  std::ifstream fileStream;
+  std::unique_ptr<std::istream> fileStream;
   XMLInterface xmlInterface(xmlOutputFN_, pepXMLOutputFN_, xmlSchemaValidation_,
                             xmlPrintDecoys_, xmlPrintExpMass_);
   SetHandler setHandler(maxPSMs_);
+  setHandler.setSubsetHashSampling(subsetHashSampling_);
   setHandler.setDecoyPrefix(protEstimatorDecoyPrefix_);
   Scores allScores(useMixMax_);
   allScores.setOutputRT(outputRT_);
 
-  if (!loadAndNormalizeData(getDataInStream(fileStream), xmlInterface,
+  std::istream& dataStream = getDataInStream(fileStream);
+  if (!loadAndNormalizeData(dataStream, xmlInterface,
                             setHandler, allScores))
     exit(EXIT_FAILURE);
 
@@ -1139,7 +1220,7 @@ int Caller::run() {
       // From Algorithm S3 of the percolator-RESET supplementary material
       // decoyFractionTraining - the probability of assigning a decoy to the
       // training set
-      std::for_each(allScores.begin(), allScores.end(), [&](ScoreHolder& sh) {
+      std::for_each(allScores.begin(), allScores.end(), [&](ScoreHolderRef sh) {
         if (sh.isDecoy() &&
             PseudoRandom::lcg_uniform_rand() > decoyFractionTraining) {
           sh.label = LabelType::PSEUDO_TARGET;
@@ -1199,17 +1280,22 @@ int Caller::run() {
     }
     std::vector<double> rawWeights;
     crossValidation.getAvgWeights(rawWeights, pNorm_);
-    setHandler.reset();
     allScores.reset();
 
-    fileStream.clear();
-    fileStream.seekg(0, ios::beg);
-    if (!tabInput_) {
-      success = xmlInterface.readAndScorePin(fileStream, rawWeights, allScores,
+    if (setHandler.hasPSMSpill()) {
+      success = setHandler.readAndScoreSpill(rawWeights, allScores);
+    } else if (!tabInput_) {
+      setHandler.reset();
+      dataStream.clear();
+      dataStream.seekg(0, ios::beg);
+      success = xmlInterface.readAndScorePin(dataStream, rawWeights, allScores,
                                              inputFN_, setHandler, pCheck_,
                                              protEstimator_, enzyme_);
     } else {
-      success = setHandler.readAndScoreTab(fileStream, rawWeights, allScores,
+      setHandler.reset();
+      dataStream.clear();
+      dataStream.seekg(0, ios::beg);
+      success = setHandler.readAndScoreTab(dataStream, rawWeights, allScores,
                                            pCheck_);
     }
 
@@ -1236,6 +1322,14 @@ int Caller::run() {
     allScores.normalizeScores(selectionFdr_, rawWeights);
   }
 
+  if (detectDecoyPrefix) {
+    protEstimatorDecoyPrefix_ = setHandler.getDecoyPrefix();
+    if (VERB > 0) {
+      std::cerr << "Using protein decoy prefix \"" << protEstimatorDecoyPrefix_
+                << "\"" << std::endl;
+    }
+  }
+
   calcAndOutputResult(allScores, xmlInterface);
   return 1;
 }
@@ -32,8 +32,10 @@ limitations under the License.
 #include "config.h"
 #endif
 
+#include "DecompressingStream.h"
 #include "Enzyme.h"
 #include "Globals.h"
+#include "MemoryMappedFile.h"
 #include "Normalizer.h"
 #include "ProteinProbEstimator.h"
 #include "SanityCheck.h"
@@ -80,6 +82,7 @@ class Caller {
 
   // file output parameters
   std::string tabOutputFN_, xmlOutputFN_, pepXMLOutputFN_;
+  std::string pinCacheFN_;
   std::string weightOutputFN_;
   std::string psmResultFN_, peptideResultFN_, proteinResultFN_;
   std::string decoyPsmResultFN_, decoyPeptideResultFN_, decoyProteinResultFN_;
@@ -96,6 +99,7 @@ class Caller {
   // SVM / cross validation parameters
   double selectionFdr_, initialSelectionFdr_, testFdr_;
   unsigned int numIterations_, maxPSMs_, nestedXvalBins_, numThreads_;
+  bool subsetHashSampling_;
   double selectedCpos_, selectedCneg_;
   bool reportEachIteration_, quickValidation_, trainBestPositive_,
       skipNormalizeScores_, analytics_, useResetAlgorithm_,
@@ -106,7 +110,7 @@ class Caller {
 
   Timer timer;
 
-  std::istream& getDataInStream(std::ifstream& fileStream);
+  std::istream& getDataInStream(std::unique_ptr<std::istream>& fileStream);
   bool loadAndNormalizeData(std::istream& dataStream,
                             XMLInterface& xmlInterface,
                             SetHandler& setHandler,
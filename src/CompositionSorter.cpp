@@ -9,45 +9,29 @@
 #include "Globals.h"
 #include "Scores.h"
 
-// helper for sorting ScoreHolder references by scan and score, to help TDC
-bool compareByScanThenScore(const ScoreHolder* lhs, const ScoreHolder* rhs) {
-  // sort by file, scan, mass in ascending order
-  if (lhs->pPSM->specFileNr != rhs->pPSM->specFileNr) {
-    return lhs->pPSM->specFileNr < rhs->pPSM->specFileNr;
-  }
-  if (lhs->pPSM->scan != rhs->pPSM->scan) {
-    return lhs->pPSM->scan < rhs->pPSM->scan;
-  }
-  if (lhs->pPSM->expMass != rhs->pPSM->expMass) {
-    return lhs->pPSM->expMass < rhs->pPSM->expMass;
-  }
-  // Then sort by score in descending order
-  return lhs->score > rhs->score;
-}
-
 void targetDecoyCompetition(std::vector<ScoreHolder*>& scoreHolders) {
-  std::sort(scoreHolders.begin(), scoreHolders.end(), compareByScanThenScore);
   if (VERB > 1) {
     std::cerr << "Before TDC there are " << scoreHolders.size() << " PSMs."
               << std::endl;
   }
-  // First, sort the vector using the custom comparator
 
-  // Use a map to track scan numbers and keep only the best score for each scan
-  std::map<int, ScoreHolder*> bestScoreByScan;
+  // Keep only the best scoring PSM for each spectrum (file, scan, mass), the
+  // first one seen in case of ties
+  std::vector<ScoreHolder*> bestScoreBySpectrum(
+      PSMDescription::getNumSpectrumIds(), NULL);
   for (ScoreHolder* holder : scoreHolders) {
-    int scan = holder->pPSM->scan;
-    if (bestScoreByScan.find(scan) == bestScoreByScan.end() ||
-        bestScoreByScan[scan]->score < holder->score) {
-      bestScoreByScan[scan] = holder;
+    ScoreHolder*& best = bestScoreBySpectrum[holder->pPSM->spectrumId];
+    if (best == NULL || best->score < holder->score) {
+      best = holder;
     }
   }
 
-  // Clear the original scoreHolders and repopulate it with the best scores from
-  // each scan
+  // Repopulate scoreHolders with the best scores, in order of spectrum id
   scoreHolders.clear();
-  for (const auto& pair : bestScoreByScan) {
-    scoreHolders.push_back(pair.second);
+  for (ScoreHolder* holder : bestScoreBySpectrum) {
+    if (holder != NULL) {
+      scoreHolders.push_back(holder);
+    }
   }
   if (VERB > 1) {
     std::cerr << "After TDC there are " << scoreHolders.size() << " PSMs."
@@ -85,24 +69,19 @@ std::string CompositionSorter::generateCompositionSignature(
 }
 
 int CompositionSorter::addPSMs(const Scores& scores, bool useTDC) {
+  // Scores hands out copies of its PSMs, so the sorter keeps its own
+  std::vector<ScoreHolder*> scoreHolders;
+  for (const ScoreHolder& scr : scores) {
+    scoreHolders_.push_back(scr);
+    scoreHolders.push_back(&scoreHolders_.back());
+  }
   if (useTDC) {
-    std::vector<ScoreHolder*> scoreHolders;
-    for (const auto& scr : scores) {
-      scoreHolders.push_back(const_cast<ScoreHolder*>(&scr));
-    }
     targetDecoyCompetition(scoreHolders);
-    for (auto& pScr : scoreHolders) {
-      std::string peptide = pScr->getPSM()->getPeptideSequence();
-      std::string signature = generateCompositionSignature(peptide);
-      compositionToPeptidesToScore_[signature][peptide].push_back(pScr);
-    }
-  } else {
-    for (const auto& scr : scores) {
-      std::string peptide = scr.getPSM()->getPeptideSequence();
-      std::string signature = generateCompositionSignature(peptide);
-      compositionToPeptidesToScore_[signature][peptide].push_back(
-          const_cast<ScoreHolder*>(&scr));
-    }
+  }
+  for (auto& pScr : scoreHolders) {
+    std::string peptide = pScr->getPSM()->getPeptideSequence();
+    std::string signature = generateCompositionSignature(peptide);
+    compositionToPeptidesToScore_[signature][peptide].push_back(pScr);
   }
   return 0;
 }
@@ -275,7 +254,7 @@ int CompositionSorter::psmAndPeptide(const Scores& scores,
 void CompositionSorter::psmsOnly(const Scores& scores, Scores& winnerPeptides) {
   // Use an unordered_map (hash map) to store the best ScoreHolder for each
   // peptide sequence
-  std::unordered_map<std::string, ScoreHolder*> bestScoreHolders;
+  std::unordered_map<std::string, ScoreHolder> bestScoreHolders;
 
   // Iterate over each ScoreHolder
   for (const ScoreHolder& sh : scores) {
@@ -283,14 +262,14 @@ void CompositionSorter::psmsOnly(const Scores& scores, Scores& winnerPeptides) {
     // Update the map if the current ScoreHolder has a higher score for the
     // peptide
     if (bestScoreHolders.find(peptide) == bestScoreHolders.end() ||
-        sh.score > bestScoreHolders[peptide]->score) {
-      bestScoreHolders[peptide] = const_cast<ScoreHolder*>(&sh);
+        sh.score > bestScoreHolders[peptide].score) {
+      bestScoreHolders[peptide] = sh;
     }
   }
 
   // Collect the best ScoreHolders into a result vector
   for (const auto& entry : bestScoreHolders) {
-    winnerPeptides.addScoreHolder(*(entry.second));
+    winnerPeptides.addScoreHolder(entry.second);
   }
   winnerPeptides.recalculateSizes();
 
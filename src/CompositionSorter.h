@@ -1,9 +1,12 @@
+#include <deque>
 #include <iostream>
 #include <map>
 #include <string>
 #include <unordered_map>
 #include <vector>
 
+#include "ScoreHolder.h"
+
 // based on the djb2 algorithm
 struct DJB2Hash {
   size_t operator()(const std::string& s) const {
@@ -15,7 +18,6 @@ struct DJB2Hash {
   }
 };
 
-class ScoreHolder;
 class Scores;
 
 class CompositionSorter {
@@ -37,6 +39,8 @@ class CompositionSorter {
                                     bool useCompositionMatch);
 
  protected:
+  // the PSMs added, which compositionToPeptidesToScore_ points to
+  std::deque<ScoreHolder> scoreHolders_;
   std::unordered_map<std::string,
                      std::map<std::string, std::vector<ScoreHolder*>>,
                      DJB2Hash>
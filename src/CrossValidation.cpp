@@ -71,6 +71,9 @@ CrossValidation::~CrossValidation() {
     }
     svmInputs_[set] = NULL;
   }
+  for (std::size_t thread = 0; thread < svmWorkspaces_.size(); ++thread) {
+    delete svmWorkspaces_[thread];
+  }
 }
 
 /**
@@ -100,6 +103,14 @@ int CrossValidation::preIterationSetup(Scores& fullset,
         fullset.size(), static_cast<int>(FeatureNames::getNumFeatures()) + 1));
     assert(svmInputs_.back());
   }
+  // One SVM solver workspace per thread, reused by all trainings
+  int numThreads = 1;
+#ifdef _OPENMP
+  numThreads = omp_get_max_threads();
+#endif
+  for (int thread = 0; thread < numThreads; ++thread) {
+    svmWorkspaces_.push_back(new SvmWorkspace());
+  }
 
   unsigned int decoysPerTarget = 1u;  // TODO: make this a command line argument
   fullset.createXvalSetsBySpectrum(trainScores_, testScores_, numFolds_,
@@ -305,22 +316,19 @@ int CrossValidation::doStep(const Normalizer* pNorm, double selectionFdr) {
 
   // Create SVM input data for parallelization
   std::vector<AlgIn*> svmInputsVec;
-  std::vector<std::vector<Scores> > nestedTestScoresVec;
+  // the nested folds are views on the PSMs of the training sets
+  std::vector<XvalFolds> nestedFoldsVec(numFolds_);
   for (std::size_t set = 0; set < numFolds_; ++set) {
-    std::vector<Scores> nestedTrainScores(nestedXvalBins_, usePi0_),
-        nestedTestScores(nestedXvalBins_, usePi0_);
+    XvalFolds& nestedFolds = nestedFoldsVec[set];
     if (nestedXvalBins_ > 1) {
-      FeatureMemoryPool featurePool;
-      trainScores_[set].createXvalSetsBySpectrum(
-          nestedTrainScores, nestedTestScores, nestedXvalBins_, featurePool);
+      trainScores_[set].createXvalFoldsBySpectrum(nestedFolds,
+                                                  nestedXvalBins_);
     } else {
       // sub-optimal cross validation
-      nestedTrainScores[0] = trainScores_[set];
-      nestedTestScores[0] = trainScores_[set];
+      trainScores_[set].createSingleXvalFold(nestedFolds);
     }
-    nestedTestScoresVec.push_back(nestedTestScores);
     // Set SVM input data for L2-SVM-MFN
-    for (std::size_t nestedFold = 0; nestedFold < nestedXvalBins_;
+    for (unsigned int nestedFold = 0; nestedFold < nestedXvalBins_;
          ++nestedFold) {
       AlgIn* svmInput = svmInputs_[set * nestedXvalBins_ + nestedFold];
       if ((VERB > 2) && (nestedFold == 0)) {
@@ -328,9 +336,11 @@ int CrossValidation::doStep(const Normalizer* pNorm, double selectionFdr) {
              << " positives and " << svmInput->negatives << " negatives"
              << std::endl;
       }
-      nestedTrainScores[nestedFold].generateNegativeTrainingSet(*svmInput, 1.0);
-      nestedTrainScores[nestedFold].generatePositiveTrainingSet(
-          *svmInput, selectionFdr, 1.0, trainBestPositive_);
+      trainScores_[set].generateNegativeTrainingSet(*svmInput, 1.0,
+                                                    nestedFolds, nestedFold);
+      trainScores_[set].generatePositiveTrainingSet(
+          *svmInput, selectionFdr, 1.0, trainBestPositive_, nestedFolds,
+          nestedFold);
       if ((VERB > 2) && (nestedXvalBins_ > 1u)) {
         cerr << "Split " << set + 1 << " nested fold " << nestedFold
              << ": Training with " << svmInput->positives << " positives and "
@@ -346,52 +356,58 @@ int CrossValidation::doStep(const Normalizer* pNorm, double selectionFdr) {
     AlgIn* svmInput =
         svmInputsVec[cpCnFold->set * nestedXvalBins_ +
                      static_cast<unsigned int>(cpCnFold->nestedSet)];
-    trainCpCnPair(*cpCnFold, pOptions, svmInput);
+    trainCpCnPair(*cpCnFold, pOptions, svmInput, getThreadSvmWorkspace());
   }
 
-  estTruePos = mergeCpCnPairs(selectionFdr, pOptions, nestedTestScoresVec,
+  estTruePos = mergeCpCnPairs(selectionFdr, pOptions, nestedFoldsVec,
                               candidatesCpos_, candidatesCfrac_);
   return estTruePos;
 }
 
+/**
+ * The SVM solver workspace of the calling thread, the only one without
+ * OpenMP
+ * @return workspace of the thread
+ */
+SvmWorkspace& CrossValidation::getThreadSvmWorkspace() {
+#ifdef _OPENMP
+  return *svmWorkspaces_[omp_get_thread_num()];
+#else
+  return *svmWorkspaces_[0];
+#endif
+}
+
 /**
  * Train SVM over a single (cpos, cneg) pair
  * @param cpCnFold contains cpos, cneg pair and SVM learned weights
  * @param pOptions options for the SVM algorithm
  * @param svmInput training data for this particular nested CV fold
+ * @param workspace SVM solver buffers of the calling thread
  */
 void CrossValidation::trainCpCnPair(CandidateCposCfrac& cpCnFold,
                                     options& pOptions,
-                                    AlgIn* svmInput) {
-  vector_double pWeights;
-  pWeights.d = static_cast<int>(FeatureNames::getNumFeatures()) + 1;
-  pWeights.vec = new double[pWeights.d];
-
+                                    AlgIn* svmInput,
+                                    SvmWorkspace& workspace) {
   double cpos = cpCnFold.cpos;
   double cfrac = cpCnFold.cfrac;
 
   // Create storage vector for SVM algorithm
-  vector_double Outputs;
   size_t numInputs =
       static_cast<std::size_t>(svmInput->positives + svmInput->negatives);
-  Outputs.vec = new double[numInputs];
-  Outputs.d = static_cast<int>(numInputs);
+  workspace.prepareSolution(
+      static_cast<int>(FeatureNames::getNumFeatures()) + 1,
+      static_cast<int>(numInputs));
 
   if (VERB > 3)
     cerr << "- cross-validation with Cpos=" << cpos << ", Cneg=" << cfrac * cpos
          << endl;
-  for (int ix = 0; ix < pWeights.d; ix++) {
-    pWeights.vec[ix] = 0;
-  }
-  for (int ix = 0; ix < Outputs.d; ix++) {
-    Outputs.vec[ix] = 0;
-  }
 
   // Call SVM algorithm (see ssl.cpp)
-  L2_SVM_MFN(*svmInput, pOptions, pWeights, Outputs, cpos, cfrac * cpos);
+  L2_SVM_MFN(*svmInput, pOptions, workspace.weights, workspace.outputs, cpos,
+             cfrac * cpos, workspace);
 
   for (std::size_t i = FeatureNames::getNumFeatures() + 1; i--;) {
-    cpCnFold.ww[i] = pWeights.vec[i];
+    cpCnFold.ww[i] = workspace.weights.vec[i];
   }
 }
 
@@ -400,13 +416,12 @@ void CrossValidation::trainCpCnPair(CandidateCposCfrac& cpCnFold,
  * CV fold
  * @param pWeights results vector from the SVM algorithm
  * @param pOptions options for the SVM algorithm
- * @param nestedTestScoresVec 2D vector, test sets per nested CV fold per CV
- * fold
+ * @param nestedFoldsVec nested CV folds of the training set per CV fold
  */
 int CrossValidation::mergeCpCnPairs(
     double selectionFdr,
     options& pOptions,
-    vector<vector<Scores> >& nestedTestScoresVec,
+    const vector<XvalFolds>& nestedFoldsVec,
     const vector<double>& cposCandidates,
     const vector<double>& cfracCandidates) {
   // for determining the number of positives, the decoys+1 in the FDR estimates
@@ -432,9 +447,9 @@ int CrossValidation::mergeCpCnPairs(
     std::map<std::pair<double, double>, int> intermediateResults;
     for (itCpCnPair = classWeightsPerFold_.begin() + a;
          itCpCnPair < classWeightsPerFold_.begin() + b; itCpCnPair++) {
-      tp = nestedTestScoresVec[set][static_cast<std::size_t>(
-                                        itCpCnPair->nestedSet)]
-               .calcScoresAndQvals(itCpCnPair->ww, testFdr_, skipDecoysPlusOne);
+      tp = trainScores_[set].countTargetsBelowFdr(
+          itCpCnPair->ww, testFdr_, skipDecoysPlusOne, nestedFoldsVec[set],
+          static_cast<unsigned int>(itCpCnPair->nestedSet));
       intermediateResults[std::make_pair(itCpCnPair->cpos,
                                          itCpCnPair->cfrac)] += tp;
       itCpCnPair->tp = tp;
@@ -470,34 +485,25 @@ int CrossValidation::mergeCpCnPairs(
   if (nestedXvalBins_ > 1) {
 #pragma omp parallel for schedule(dynamic, 1) ordered
     for (int set = 0; set < static_cast<int>(numFolds_); ++set) {
-      vector_double pWeights;
-      pWeights.d = static_cast<int>(FeatureNames::getNumFeatures()) + 1;
-      pWeights.vec = new double[pWeights.d];
-
+      SvmWorkspace& workspace = getThreadSvmWorkspace();
       AlgIn* svmInput = svmInputs_[set * nestedXvalBins_];
       trainScores_[set].generateNegativeTrainingSet(*svmInput, 1.0);
       trainScores_[set].generatePositiveTrainingSet(*svmInput, selectionFdr,
                                                     1.0, trainBestPositive_);
 
       // Create storage vector for SVM algorithm
-      vector_double Outputs;
       size_t numInputs =
           static_cast<std::size_t>(svmInput->positives + svmInput->negatives);
-      Outputs.vec = new double[numInputs];
-      Outputs.d = static_cast<int>(numInputs);
-
-      for (int ix = 0; ix < pWeights.d; ix++) {
-        pWeights.vec[ix] = 0;
-      }
-      for (int ix = 0; ix < Outputs.d; ix++) {
-        Outputs.vec[ix] = 0;
-      }
+      workspace.prepareSolution(
+          static_cast<int>(FeatureNames::getNumFeatures()) + 1,
+          static_cast<int>(numInputs));
       // Call SVM algorithm (see ssl.cpp)
-      L2_SVM_MFN(*svmInput, pOptions, pWeights, Outputs, bestCposes[set],
-                 bestCposes[set] * bestCfracs[set]);
+      L2_SVM_MFN(*svmInput, pOptions, workspace.weights, workspace.outputs,
+                 bestCposes[set], bestCposes[set] * bestCfracs[set],
+                 workspace);
 
       for (std::size_t i = FeatureNames::getNumFeatures() + 1; i--;) {
-        weights_[set][i] = pWeights.vec[i];
+        weights_[set][i] = workspace.weights.vec[i];
       }
     }
   }
@@ -526,7 +532,7 @@ void CrossValidation::postIterationProcessing(Scores& fullset,
 
     for (std::size_t set = 0; set < numFolds_; ++set) {
       Scores newTestScores(false);
-      for (ScoreHolder& sh : testScores_[set]) {
+      for (ScoreHolder sh : testScores_[set]) {
         if (sh.label == LabelType::DECOY)
           continue;
 
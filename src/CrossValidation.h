@@ -90,6 +90,7 @@ class CrossValidation {
 
  protected:
   std::vector<AlgIn*> svmInputs_;
+  std::vector<SvmWorkspace*> svmWorkspaces_;  // one per thread
   std::vector<std::vector<double> > weights_;  // svm weights for each fold
   std::vector<CandidateCposCfrac>
       classWeightsPerFold_;  // cpos, cneg pairs to train for each nested CV
@@ -123,13 +124,16 @@ class CrossValidation {
   std::vector<double> candidatesCpos_, candidatesCfrac_;
 
   void initializeGridSearch(double targetDecoySizeRatio);
+  // the SVM solver workspace of the calling thread
+  SvmWorkspace& getThreadSvmWorkspace();
   void trainCpCnPair(CandidateCposCfrac& cpCnFold,
                      options& pOptions,
-                     AlgIn* svmInput);
+                     AlgIn* svmInput,
+                     SvmWorkspace& workspace);
 
   int mergeCpCnPairs(double selectionFdr,
                      options& pOptions,
-                     std::vector<std::vector<Scores> >& nestedTestScoresVec,
+                     const std::vector<XvalFolds>& nestedFoldsVec,
                      const vector<double>& cpos_vec,
                      const vector<double>& cfrac_vec);
   int doStep(const Normalizer* pNorm, double selectionFdr);
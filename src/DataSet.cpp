@@ -19,16 +19,11 @@
 #include <cmath>
 
 FeatureNames DataSet::featureNames_;
-bool DataSet::decoyWarningTripped_ = false;
+std::atomic<bool> DataSet::decoyWarningTripped_(false);
 
 DataSet::DataSet() {}
 
-DataSet::~DataSet() {
-  std::vector<PSMDescription*>::iterator it = psms_.begin();
-  for ( ; it != psms_.end(); ++it) {
-    PSMDescription::deletePtr(*it);
-  }
-}
+DataSet::~DataSet() {}
 
 /*const double* DataSet::getFeatures(const int pos) const {
   return &feature[pos];
@@ -39,7 +34,7 @@ bool DataSet::writeTabData(ofstream& out) {
   std::vector<PSMDescription*>::iterator it = psms_.begin();
   for ( ; it != psms_.end(); ++it) {
     PSMDescription* psm = *it;
-    double* featureRow = psm->features;
+    FeatureType* featureRow = psm->features;
     out << psm->getId() << '\t' << label_ << '\t' << psm->scan << '\t' 
         << psm->expMass << '\t' << psm->calcMass;
     if (psm->hasSpectrumFileName()) {
@@ -83,7 +78,7 @@ void DataSet::fillScores(std::vector<ScoreHolder>& scores) {
   }
 }
 
-void DataSet::fillFeatures(std::vector<double*>& features) {
+void DataSet::fillFeatures(std::vector<FeatureType*>& features) {
   std::vector<PSMDescription*>::iterator it = psms_.begin();
   for ( ; it != psms_.end(); ++it) {
     PSMDescription* psm = *it;
@@ -99,21 +94,34 @@ void DataSet::fillFeatures(std::vector<double*>& features) {
  */
 void DataSet::readPsm(const std::string& line, const unsigned int lineNr,
     const std::vector<OptionalField>& optionalFields, FeatureMemoryPool& featurePool,
-    std::string decoyPrefix) { 
+    PSMArena& psmArena, std::string decoyPrefix) { 
   PSMDescription* myPsm = NULL;
   bool readProteins = true;
-  readPsm(line, lineNr, optionalFields, readProteins, myPsm, featurePool, decoyPrefix);
+  readPsm(line, lineNr, optionalFields, readProteins, myPsm, featurePool, 
+          psmArena, decoyPrefix);
   registerPsm(myPsm);
 }
 
 LabelType DataSet::readPsm(const std::string& line, const unsigned int lineNr,
     const std::vector<OptionalField>& optionalFields, bool readProteins,
-    PSMDescription*& myPsm, FeatureMemoryPool& featurePool, std::string decoyPrefix) {
-  TabReader reader(line);
+    PSMDescription*& myPsm, FeatureMemoryPool& featurePool, PSMArena& psmArena,
+    std::string decoyPrefix) {
+  myPsm = psmArena.create();
+  LabelType label = readPsm(line.data(), line.size(), lineNr, optionalFields, 
+      readProteins, myPsm, featurePool.allocate(), NULL, NULL, decoyPrefix);
+  psmArena.storeStrings(myPsm);
+  return label;
+}
+
+LabelType DataSet::readPsm(const char* line, size_t lineLength, 
+    const unsigned int lineNr, const std::vector<OptionalField>& optionalFields, 
+    bool readProteins, PSMDescription* myPsm, FeatureType* featureRow, 
+    std::string* spectrumFileName, std::vector<std::string>* proteinNames,
+    const std::string& decoyPrefix, bool deferProteins) {
+  TabReader reader(line, lineLength);
   std::string tmp;
   
-  myPsm = new PSMDescription();
-  myPsm->setId(reader.readString());
+  myPsm->setId(reader.readStringRef());
   LabelType label = reader.readInt() == 1 ? LabelType::TARGET : LabelType::DECOY;
   
   bool hasScannr = false;
@@ -147,7 +155,11 @@ LabelType DataSet::readPsm(const std::string& line, const unsigned int lineNr,
           throw MyException(temp.str());
         break;
       } case FILENAME: {
-        myPsm->setSpectrumFileName(reader.readString());
+        if (spectrumFileName != NULL) {
+          *spectrumFileName = reader.readString();
+        } else {
+          myPsm->setSpectrumFileName(reader.readString());
+        }
         break;
       } default: {
         ostringstream temp;
@@ -160,7 +172,6 @@ LabelType DataSet::readPsm(const std::string& line, const unsigned int lineNr,
   if (!hasScannr) myPsm->scan = lineNr;
   
   unsigned int numFeatures = static_cast<unsigned int>(FeatureNames::getNumFeatures());
-  double* featureRow = featurePool.allocate();
   myPsm->features = featureRow;
   for (unsigned int j = 0; j < numFeatures; j++) {
     featureRow[j] = reader.readDouble();
@@ -185,7 +196,7 @@ LabelType DataSet::readPsm(const std::string& line, const unsigned int lineNr,
     throw MyException(temp.str());
   }
   
-  std::string peptide_seq = reader.readString();
+  StringRef peptide_seq = reader.readStringRef();
   myPsm->setPeptide(peptide_seq);
   if (reader.error()) {
     ostringstream temp;
@@ -199,7 +210,7 @@ LabelType DataSet::readPsm(const std::string& line, const unsigned int lineNr,
       temp << "ERROR: Reading tab file, the peptide sequence " << peptide_seq 
         << " with PSM id " << myPsm->getId() << " is too short." << std::endl;
       throw MyException(temp.str());
-    } else if (peptide_seq.at(1) != '.' && peptide_seq.at(peptide_seq.size()-1) != '.') {
+    } else if (peptide_seq[1] != '.' && peptide_seq[peptide_seq.size()-1] != '.') {
       ostringstream temp;
       temp << "ERROR: Reading tab file, the peptide sequence " << peptide_seq 
         << " with PSM id " << myPsm->getId() << " does not contain one or two of its"
@@ -209,38 +220,43 @@ LabelType DataSet::readPsm(const std::string& line, const unsigned int lineNr,
   }
   
   if (readProteins) {
-    std::vector<std::string> proteins;
-    if (PSMDescription::getProteinNameSeparator() == "\t") {
-      while (!reader.error()) {
-        std::string tmp = reader.readString();
-        if (tmp.size() > 0) proteins.push_back(tmp);
-      }
+    StringRef proteinList = reader.readRemainder();
+    if (label == LabelType::DECOY) warnOnDecoyPrefixMismatch(proteinList, decoyPrefix);
+    if (deferProteins) {
+      myPsm->setProteinList(proteinList);
     } else {
-      std::string names = reader.readString();
-      size_t pos = 0;
-      std::string token;
-      while ((pos = names.find(PSMDescription::getProteinNameSeparator())) != std::string::npos) {
-        token = names.substr(0, pos);
-        if (token.size() > 0) proteins.push_back(token);
-        names.erase(0, pos + PSMDescription::getProteinNameSeparator().length());
+      std::vector<std::string> proteins;
+      PSMDescription::splitProteinList(proteinList, proteins);
+      if (proteinNames != NULL) {
+        proteinNames->swap(proteins);
+      } else {
+        myPsm->setProteins(proteins);
       }
-      if (names.size() > 0) proteins.push_back(names);
     }
-    proteins.swap(myPsm->proteinIds); // shrink to fit
   }
+  return label;
+}
 
-  if (label == LabelType::DECOY) {
-    for (auto const& proteinId: myPsm->proteinIds) { 
-      bool startsWithDecoyPrefix = (proteinId.rfind(decoyPrefix, 0) == 0);
-      if (!startsWithDecoyPrefix && VERB > 1 && !decoyWarningTripped_) {
+// Checks the proteins of a decoy on the protein column(s) of its line, 
+// without decoding them. Every protein starts with an empty prefix.
+void DataSet::warnOnDecoyPrefixMismatch(const StringRef& proteinList,
+    const std::string& decoyPrefix) {
+  if (VERB <= 1 || decoyPrefix.empty() || decoyWarningTripped_.load()) return;
+  size_t pos = 0u;
+  StringRef proteinId;
+  while (PSMDescription::nextProteinName(proteinList, pos, proteinId)) { 
+    bool startsWithDecoyPrefix = 
+        (proteinId.subref(0, decoyPrefix.size()) == decoyPrefix);
+    if (!startsWithDecoyPrefix) {
+      // only the thread that trips the flag warns
+      if (!decoyWarningTripped_.exchange(true)) {
         std::cerr << "Warning: protein decoy prefix " << decoyPrefix 
                   << " doesn't match the decoy protein identifier " 
                   << proteinId << "." << std::endl;
-        decoyWarningTripped_ = true;
       }
+      return;
     }
   }
-  return label;
 }
 
 void DataSet::registerPsm(PSMDescription* myPsm) {
@@ -250,5 +266,6 @@ void DataSet::registerPsm(PSMDescription* myPsm) {
     default:  { throw MyException("ERROR : Reading PSM, class DataSet has not been initiated\
     to neither target nor decoy label\n");}
   }
+  myPsm->internSpectrumId();
   psms_.push_back(myPsm);
 }
@@ -18,6 +18,7 @@
 #define DATASET_H_
 
 #include <string>
+#include <atomic>
 #include <cassert>
 #include <cctype>
 #include <iostream>
@@ -34,6 +35,7 @@
 #include "ResultHolder.h"
 #include "Globals.h"
 #include "PSMDescription.h"
+#include "PSMArena.h"
 #include "FeatureNames.h"
 #include "FeatureMemoryPool.h"
 #include "ProteinProbEstimator.h"
@@ -56,6 +58,7 @@ class DataSet {
   LabelType inline getLabel() const { return label_; }
   
   unsigned int inline getSize() const { return static_cast<unsigned int>(psms_.size()); }
+  const std::vector<PSMDescription*>& getPsms() const { return psms_; }
     
   static FeatureNames& getFeatureNames() { return featureNames_; }
   static void resetFeatureNames() { 
@@ -70,14 +73,33 @@ class DataSet {
   void print_features();
 
   void fillScores(std::vector<ScoreHolder>& scores);
-  void fillFeatures(std::vector<double*>& features);
+  void fillFeatures(std::vector<FeatureType*>& features);
   
   void readPsm(const std::string& line, const unsigned int lineNr,
                const std::vector<OptionalField>& optionalFields, 
-               FeatureMemoryPool& featurePool, std::string decoyPrefix);
+               FeatureMemoryPool& featurePool, PSMArena& psmArena,
+               std::string decoyPrefix);
+  // creates the PSM in psmArena
   static LabelType readPsm(const std::string& line, const unsigned int lineNr,
     const std::vector<OptionalField>& optionalFields, bool readProteins,
-    PSMDescription*& myPsm, FeatureMemoryPool& featurePool, std::string decoyPrefix);
+    PSMDescription*& myPsm, FeatureMemoryPool& featurePool, 
+    PSMArena& psmArena, std::string decoyPrefix);
+  // variant used by the parallel parser, which reads the line from a view 
+  // into its input buffer: the PSM and feature row are allocated by the
+  // caller, and the id and peptide of the PSM are left as views of the line,
+  // to be copied by PSMArena::storeStrings. If spectrumFileName is not NULL,
+  // the spectrum file name is handed back instead of being registered in 
+  // PSMDescription's file table; likewise for proteinNames and the protein
+  // name dictionary. With deferProteins, the protein columns are left as a 
+  // view of the line as well, see PSMDescription::setProteinList
+  static LabelType readPsm(const char* line, size_t lineLength, 
+    const unsigned int lineNr, const std::vector<OptionalField>& optionalFields, 
+    bool readProteins, PSMDescription* myPsm, FeatureType* featureRow, 
+    std::string* spectrumFileName, std::vector<std::string>* proteinNames,
+    const std::string& decoyPrefix, bool deferProteins = false);
+  
+  static void warnOnDecoyPrefixMismatch(const StringRef& proteinList,
+    const std::string& decoyPrefix);
   
   void registerPsm(PSMDescription* myPsm);
   
@@ -87,7 +109,8 @@ class DataSet {
   LabelType label_;
   
   static FeatureNames featureNames_;
-  static bool decoyWarningTripped_;
+  // set by the first parser thread that warns
+  static std::atomic<bool> decoyWarningTripped_;
 };
 
 #endif /*DATASET_H_*/
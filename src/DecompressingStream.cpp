@@ -0,0 +1,291 @@
+/*******************************************************************************
+ Copyright 2006-2012 Lukas Käll <lukas.kall@scilifelab.se>
+
+ Licensed under the Apache License, Version 2.0 (the "License");
+ you may not use this file except in compliance with the License.
+ You may obtain a copy of the License at
+
+ http://www.apache.org/licenses/LICENSE-2.0
+
+ Unless required by applicable law or agreed to in writing, software
+ distributed under the License is distributed on an "AS IS" BASIS,
+ WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ See the License for the specific language governing permissions and
+ limitations under the License.
+
+ *******************************************************************************/
+
+#include "DecompressingStream.h"
+
+#include <sstream>
+#include <vector>
+
+#ifdef HAVE_ZLIB
+#include <zlib.h>
+#endif
+#ifdef HAVE_ZSTD
+#include <zstd.h>
+#endif
+
+#include "MyException.h"
+
+DecompressingStreamBuf::Format DecompressingStreamBuf::detectFormat(
+    const std::string& fileName) {
+  std::ifstream file(fileName.c_str(), std::ios::in | std::ios::binary);
+  unsigned char magic[4] = { 0, 0, 0, 0 };
+  file.read(reinterpret_cast<char*>(magic), sizeof(magic));
+  if (file.gcount() >= 2 && magic[0] == 0x1f && magic[1] == 0x8b) {
+    return GZIP;
+  }
+  if (file.gcount() == 4 && magic[0] == 0x28 && magic[1] == 0xb5 &&
+      magic[2] == 0x2f && magic[3] == 0xfd) {
+    return ZSTD;
+  }
+  return NONE;
+}
+
+bool DecompressingStreamBuf::isSupported(Format format) {
+  switch (format) {
+#ifdef HAVE_ZLIB
+    case GZIP: return true;
+#endif
+#ifdef HAVE_ZSTD
+    case ZSTD: return true;
+#endif
+    default: return false;
+  }
+}
+
+DecompressingStreamBuf::DecompressingStreamBuf(const std::string& fileName,
+    Format format) : fileName_(fileName), format_(format), finished_(false),
+    stopRequested_(false) {
+  start();
+}
+
+DecompressingStreamBuf::~DecompressingStreamBuf() {
+  stop();
+}
+
+void DecompressingStreamBuf::start() {
+  chunks_.clear();
+  chunk_.clear();
+  finished_ = false;
+  stopRequested_ = false;
+  error_.clear();
+  setg(NULL, NULL, NULL);
+  decompressor_ = std::thread(&DecompressingStreamBuf::decompress, this);
+}
+
+void DecompressingStreamBuf::stop() {
+  {
+    std::lock_guard<std::mutex> lock(mutex_);
+    stopRequested_ = true;
+  }
+  chunkRemoved_.notify_all();
+  if (decompressor_.joinable()) decompressor_.join();
+}
+
+/* Waits for room in the queue, returns false if the reader stopped us */
+bool DecompressingStreamBuf::addChunk(std::string& chunk) {
+  std::unique_lock<std::mutex> lock(mutex_);
+  chunkRemoved_.wait(lock, [this] {
+    return stopRequested_ || chunks_.size() < kMaxQueuedChunks;
+  });
+  if (stopRequested_) return false;
+  chunks_.push_back(std::string());
+  chunks_.back().swap(chunk);
+  lock.unlock();
+  chunkAdded_.notify_one();
+  return true;
+}
+
+/* Body of the decompression thread, errors are handed to the reader */
+void DecompressingStreamBuf::decompress() {
+  std::string error;
+  try {
+    std::ifstream in(fileName_.c_str(), std::ios::in | std::ios::binary);
+    if (!in.is_open()) {
+      throw MyException("ERROR: Could not open " + fileName_ + " for reading.\n");
+    }
+    if (format_ == GZIP) {
+      decompressGzip(in);
+    } else if (format_ == ZSTD) {
+      decompressZstd(in);
+    }
+  } catch (const std::exception& e) {
+    error = e.what();
+  }
+  {
+    std::lock_guard<std::mutex> lock(mutex_);
+    finished_ = true;
+    error_ = error;
+  }
+  chunkAdded_.notify_one();
+}
+
+void DecompressingStreamBuf::decompressGzip(std::istream& in) {
+#ifdef HAVE_ZLIB
+  z_stream zs;
+  zs.zalloc = Z_NULL;
+  zs.zfree = Z_NULL;
+  zs.opaque = Z_NULL;
+  zs.next_in = Z_NULL;
+  zs.avail_in = 0;
+  if (inflateInit2(&zs, 15 + 32) != Z_OK) { // 32: expect a gzip header
+    throw MyException("ERROR: Could not initialize gzip decompression.\n");
+  }
+  std::vector<char> input(kChunkSize);
+  std::string output(kChunkSize, '\0');
+  size_t outputSize = 0u;
+  bool inMember = false, stopped = false;
+  int ret = Z_OK;
+  while (true) {
+    if (zs.avail_in == 0) {
+      in.read(&input[0], static_cast<std::streamsize>(input.size()));
+      zs.avail_in = static_cast<uInt>(in.gcount());
+      zs.next_in = reinterpret_cast<Bytef*>(&input[0]);
+      if (zs.avail_in == 0) break;
+    }
+    inMember = true;
+    zs.next_out = reinterpret_cast<Bytef*>(&output[outputSize]);
+    zs.avail_out = static_cast<uInt>(kChunkSize - outputSize);
+    ret = inflate(&zs, Z_NO_FLUSH);
+    outputSize = kChunkSize - zs.avail_out;
+    if (ret == Z_STREAM_END) {
+      // concatenated gzip members are read as one stream
+      inMember = false;
+      inflateReset(&zs);
+    } else if (ret != Z_OK && ret != Z_BUF_ERROR) {
+      std::ostringstream temp;
+      temp << "ERROR: Could not decompress " << fileName_ << ": "
+           << (zs.msg != NULL ? zs.msg : "invalid gzip data") << std::endl;
+      inflateEnd(&zs);
+      throw MyException(temp.str());
+    }
+    if (outputSize == kChunkSize) {
+      if (!addChunk(output)) {
+        stopped = true;
+        break;
+      }
+      output.assign(kChunkSize, '\0');
+      outputSize = 0u;
+    }
+  }
+  inflateEnd(&zs);
+  if (inMember && !stopped) {
+    throw MyException("ERROR: Unexpected end of the compressed file " +
+                      fileName_ + ".\n");
+  }
+  output.resize(outputSize);
+  if (!output.empty()) addChunk(output);
+#else
+  (void)in;
+#endif
+}
+
+void DecompressingStreamBuf::decompressZstd(std::istream& in) {
+#ifdef HAVE_ZSTD
+  ZSTD_DCtx* dctx = ZSTD_createDCtx();
+  if (dctx == NULL) {
+    throw MyException("ERROR: Could not initialize zstd decompression.\n");
+  }
+  std::vector<char> input(kChunkSize);
+  std::string output(kChunkSize, '\0');
+  ZSTD_inBuffer inBuffer = { &input[0], 0, 0 };
+  ZSTD_outBuffer outBuffer = { &output[0], kChunkSize, 0 };
+  size_t ret = 0u; // 0 once a frame is completely decoded
+  bool stopped = false, inputLeft = true;
+  while (true) {
+    if (inputLeft && inBuffer.pos == inBuffer.size) {
+      in.read(&input[0], static_cast<std::streamsize>(input.size()));
+      inBuffer.size = static_cast<size_t>(in.gcount());
+      inBuffer.pos = 0u;
+      inputLeft = (inBuffer.size > 0u);
+    }
+    if (!inputLeft && ret == 0u) break;
+    // without input left, the decoder still flushes the output it holds,
+    // e.g. of a last block that did not fit in the chunk
+    size_t outputBefore = outBuffer.pos;
+    ret = ZSTD_decompressStream(dctx, &outBuffer, &inBuffer);
+    if (ZSTD_isError(ret)) {
+      std::ostringstream temp;
+      temp << "ERROR: Could not decompress " << fileName_ << ": "
+           << ZSTD_getErrorName(ret) << std::endl;
+      ZSTD_freeDCtx(dctx);
+      throw MyException(temp.str());
+    }
+    bool progress = (outBuffer.pos != outputBefore);
+    if (outBuffer.pos == kChunkSize) {
+      if (!addChunk(output)) {
+        stopped = true;
+        break;
+      }
+      output.assign(kChunkSize, '\0');
+      outBuffer.dst = &output[0];
+      outBuffer.pos = 0u;
+    }
+    if (!inputLeft && !progress) break;
+  }
+  ZSTD_freeDCtx(dctx);
+  if (ret != 0u && !stopped) {
+    throw MyException("ERROR: Unexpected end of the compressed file " +
+                      fileName_ + ".\n");
+  }
+  output.resize(outBuffer.pos);
+  if (!output.empty()) addChunk(output);
+#else
+  (void)in;
+#endif
+}
+
+DecompressingStreamBuf::int_type DecompressingStreamBuf::underflow() {
+  if (gptr() < egptr()) return traits_type::to_int_type(*gptr());
+  std::unique_lock<std::mutex> lock(mutex_);
+  chunkAdded_.wait(lock, [this] { return finished_ || !chunks_.empty(); });
+  if (chunks_.empty()) {
+    if (!error_.empty()) throw MyException(error_);
+    return traits_type::eof();
+  }
+  chunk_.swap(chunks_.front());
+  chunks_.pop_front();
+  lock.unlock();
+  chunkRemoved_.notify_one();
+  char* chunkStart = &chunk_[0];
+  setg(chunkStart, chunkStart, chunkStart + chunk_.size());
+  return traits_type::to_int_type(*gptr());
+}
+
+DecompressingStreamBuf::pos_type DecompressingStreamBuf::seekoff(off_type off,
+    std::ios_base::seekdir dir, std::ios_base::openmode which) {
+  if (dir == std::ios_base::beg) return seekpos(pos_type(off), which);
+  return pos_type(off_type(-1));
+}
+
+DecompressingStreamBuf::pos_type DecompressingStreamBuf::seekpos(pos_type pos,
+    std::ios_base::openmode which) {
+  if (!(which & std::ios_base::in) || pos != pos_type(0)) {
+    return pos_type(off_type(-1));
+  }
+  stop();
+  start();
+  return pos;
+}
+
+std::unique_ptr<std::istream> DecompressingStream::openFile(
+    const std::string& fileName) {
+  DecompressingStreamBuf::Format format =
+      DecompressingStreamBuf::detectFormat(fileName);
+  if (format == DecompressingStreamBuf::NONE) {
+    return std::unique_ptr<std::istream>(
+        new std::ifstream(fileName.c_str(), std::ios::in));
+  }
+  if (!DecompressingStreamBuf::isSupported(format)) {
+    std::ostringstream temp;
+    temp << "ERROR: " << fileName << " is "
+         << (format == DecompressingStreamBuf::GZIP ? "gzip" : "zstd")
+         << " compressed, but percolator was built without support for it."
+         << " Decompress the file first." << std::endl;
+    throw MyException(temp.str());
+  }
+  return std::unique_ptr<std::istream>(new DecompressingStream(fileName, format));
+}
@@ -0,0 +1,107 @@
+/*******************************************************************************
+ Copyright 2006-2012 Lukas Käll <lukas.kall@scilifelab.se>
+
+ Licensed under the Apache License, Version 2.0 (the "License");
+ you may not use this file except in compliance with the License.
+ You may obtain a copy of the License at
+
+ http://www.apache.org/licenses/LICENSE-2.0
+
+ Unless required by applicable law or agreed to in writing, software
+ distributed under the License is distributed on an "AS IS" BASIS,
+ WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ See the License for the specific language governing permissions and
+ limitations under the License.
+
+ *******************************************************************************/
+#ifndef DECOMPRESSINGSTREAM_H_
+#define DECOMPRESSINGSTREAM_H_
+
+#include <condition_variable>
+#include <deque>
+#include <fstream>
+#include <istream>
+#include <memory>
+#include <mutex>
+#include <streambuf>
+#include <string>
+#include <thread>
+
+/*
+ * DecompressingStreamBuf reads a gzip (also multi-member, e.g. bgzip) or
+ * zstd compressed file as a stream buffer. The file is decompressed on a
+ * thread of its own, which hands chunks of decompressed data to the reader
+ * through a bounded queue, so that decompression overlaps with parsing while
+ * only a few chunks are held in memory at a time.
+ *
+ * Which formats are available depends on whether zlib and zstd were found
+ * when building. Only rewinding to the start is supported as a seek
+ * operation, which restarts the decompression.
+ */
+class DecompressingStreamBuf : public std::streambuf {
+ public:
+  enum Format { NONE, GZIP, ZSTD };
+
+  // detects the format from the magic bytes at the start of the file
+  static Format detectFormat(const std::string& fileName);
+  static bool isSupported(Format format);
+
+  DecompressingStreamBuf(const std::string& fileName, Format format);
+  ~DecompressingStreamBuf();
+
+ protected:
+  int_type underflow();
+  pos_type seekoff(off_type off, std::ios_base::seekdir dir,
+                   std::ios_base::openmode which);
+  pos_type seekpos(pos_type pos, std::ios_base::openmode which);
+
+ private:
+  static const size_t kChunkSize = 1u << 20;
+  static const size_t kMaxQueuedChunks = 8u;
+
+  std::string fileName_;
+  Format format_;
+  std::string chunk_; // chunk currently read from
+
+  // shared with the decompression thread, guarded by mutex_
+  std::thread decompressor_;
+  std::mutex mutex_;
+  std::condition_variable chunkAdded_, chunkRemoved_;
+  std::deque<std::string> chunks_;
+  bool finished_, stopRequested_;
+  std::string error_;
+
+  void start();
+  void stop();
+  void decompress();
+  void decompressGzip(std::istream& in);
+  void decompressZstd(std::istream& in);
+  bool addChunk(std::string& chunk);
+
+  DecompressingStreamBuf(const DecompressingStreamBuf&);
+  DecompressingStreamBuf& operator=(const DecompressingStreamBuf&);
+};
+
+/*
+ * std::istream reading from a DecompressingStreamBuf it owns.
+ */
+class DecompressingStream : public std::istream {
+ public:
+  DecompressingStream(const std::string& fileName,
+                      DecompressingStreamBuf::Format format)
+      : std::istream(NULL), buffer_(fileName, format) {
+    rdbuf(&buffer_);
+    // let decompression errors through instead of reporting them as EOF
+    exceptions(std::ios_base::badbit);
+  }
+
+  // Opens the file for reading, decompressing it on the fly if it is
+  // compressed. Throws a MyException for compressed files in a format that
+  // was not enabled when building.
+  static std::unique_ptr<std::istream> openFile(const std::string& fileName);
+
+ private:
+  DecompressingStreamBuf buffer_;
+};
+
+#endif /* DECOMPRESSINGSTREAM_H_ */
@@ -17,32 +17,168 @@
 
 #include "FeatureMemoryPool.h"
 
+#include <algorithm>
+#include <cassert>
+#include <cstring>
+#include <new>
+#include <stdint.h>
+
+#ifndef _WIN32
+#include <sys/mman.h>
+#else
+#include <malloc.h>
+#endif
+
+size_t FeatureMemoryPool::getRowStride(size_t numFeatures) {
+  const size_t featuresPerAlignment = kRowAlignment / sizeof(FeatureType);
+  return (numFeatures + featuresPerAlignment - 1) / featuresPerAlignment * 
+      featuresPerAlignment;
+}
+
 void FeatureMemoryPool::createPool(size_t numFeatures) {
   numFeatures_ = static_cast<unsigned int>(numFeatures);
-  numRowsPerBlock_ = kBlockSize / numFeatures_;
+  rowStride_ = static_cast<unsigned int>(getRowStride(numFeatures));
+  numRowsPerBlock_ = kBlockSize / rowStride_;
   isInitialized_ = true;
 }
 
+FeatureType* FeatureMemoryPool::allocateBlock() {
+#ifndef _WIN32
+#ifdef MAP_HUGETLB
+  // explicit huge pages, only succeeds if the administrator reserved some
+  void* hugePage = mmap(NULL, kBlockBytes, PROT_READ | PROT_WRITE, 
+                        MAP_PRIVATE | MAP_ANONYMOUS | MAP_HUGETLB, -1, 0);
+  if (hugePage != MAP_FAILED) return static_cast<FeatureType*>(hugePage);
+#endif
+  // map twice the block size and trim the mapping to a huge page boundary,
+  // so that the whole block can be backed by a transparent huge page
+  const size_t mapBytes = 2 * kBlockBytes;
+  void* addr = mmap(NULL, mapBytes, PROT_READ | PROT_WRITE, 
+                    MAP_PRIVATE | MAP_ANONYMOUS, -1, 0);
+  if (addr == MAP_FAILED) throw std::bad_alloc();
+  char* mapStart = static_cast<char*>(addr);
+  char* blockStart = reinterpret_cast<char*>(
+      (reinterpret_cast<uintptr_t>(mapStart) + kBlockBytes - 1) & 
+      ~static_cast<uintptr_t>(kBlockBytes - 1));
+  char* blockEnd = blockStart + kBlockBytes;
+  if (blockStart > mapStart) {
+    munmap(mapStart, static_cast<size_t>(blockStart - mapStart));
+  }
+  if (mapStart + mapBytes > blockEnd) {
+    munmap(blockEnd, static_cast<size_t>(mapStart + mapBytes - blockEnd));
+  }
+#ifdef MADV_HUGEPAGE
+  madvise(blockStart, kBlockBytes, MADV_HUGEPAGE);
+#endif
+  return reinterpret_cast<FeatureType*>(blockStart); // zeroed by the kernel
+#else
+  void* memStart = _aligned_malloc(kBlockBytes, 64u);
+  if (memStart == NULL) throw std::bad_alloc();
+  std::memset(memStart, 0, kBlockBytes);
+  return static_cast<FeatureType*>(memStart);
+#endif
+}
+
+void FeatureMemoryPool::freeBlock(FeatureType* memStart) {
+#ifndef _WIN32
+  munmap(memStart, kBlockBytes);
+#else
+  _aligned_free(memStart);
+#endif
+}
+
 void FeatureMemoryPool::createNewBlock() {
-  double* memStart = new double[numFeatures_ * numRowsPerBlock_]();
-  memStarts_.push_back(memStart);
+  memStarts_.push_back(allocateBlock());
+}
+
+void FeatureMemoryPool::adoptBlocks(FeatureType* memStart, size_t numRows) {
+  assert(memStarts_.empty() && numRowsPerBlock_ > 0);
+  size_t numBlocks = (numRows + numRowsPerBlock_ - 1) / numRowsPerBlock_;
+  for (size_t i = 0; i < numBlocks; ++i) {
+    memStarts_.push_back(memStart + i * kBlockSize);
+  }
+  numAdoptedBlocks_ = numBlocks;
+  initializedRows_ = static_cast<unsigned int>(numRows);
 }
 
 void FeatureMemoryPool::destroyPool() {
   for (size_t i = 0; i < memStarts_.size(); ++i) {
     if (memStarts_.at(i) != NULL) {
-      delete[] memStarts_.at(i);
+      if (i >= numAdoptedBlocks_) freeBlock(memStarts_.at(i));
       memStarts_.at(i) = NULL;
     }
   }
   isInitialized_ = false;
 }
 
-double* FeatureMemoryPool::addressFromIdx(unsigned int i) const {
-  return memStarts_.at(i / numRowsPerBlock_) + (i % numRowsPerBlock_) * numFeatures_;
+FeatureType* FeatureMemoryPool::addressFromIdx(unsigned int i) const {
+  return memStarts_.at(i / numRowsPerBlock_) + (i % numRowsPerBlock_) * rowStride_;
+}
+
+void FeatureMemoryPool::permuteRows(const std::vector<FeatureType*>& rows) {
+  const size_t numRows = initializedRows_;
+  assert(rows.size() <= numRows);
+  if (numRows == 0) return;
+  
+  // source index of the row that goes to each index
+  std::vector<std::pair<const FeatureType*, size_t> > blockStarts;
+  for (size_t i = 0; i < memStarts_.size(); ++i) {
+    blockStarts.push_back(std::make_pair(memStarts_[i], i));
+  }
+  std::sort(blockStarts.begin(), blockStarts.end());
+  std::vector<unsigned int> sourceIdxs(numRows);
+  int numListed = static_cast<int>(rows.size());
+#pragma omp parallel for schedule(static)
+  for (int k = 0; k < numListed; ++k) {
+    std::vector<std::pair<const FeatureType*, size_t> >::const_iterator it = 
+        std::upper_bound(blockStarts.begin(), blockStarts.end(), 
+            std::make_pair(static_cast<const FeatureType*>(rows[k]), 
+                           memStarts_.size()));
+    assert(it != blockStarts.begin());
+    --it;
+    size_t rowInBlock = static_cast<size_t>(rows[k] - it->first) / rowStride_;
+    sourceIdxs[k] = static_cast<unsigned int>(
+        it->second * numRowsPerBlock_ + rowInBlock);
+  }
+  std::vector<bool> isListed(numRows, false);
+  for (size_t k = 0; k < rows.size(); ++k) {
+    assert(!isListed[sourceIdxs[k]]);
+    isListed[sourceIdxs[k]] = true;
+  }
+  size_t k = rows.size();
+  for (size_t i = 0; i < numRows; ++i) {
+    if (!isListed[i]) sourceIdxs[k++] = static_cast<unsigned int>(i);
+  }
+  
+  // apply the permutation one cycle at a time, with one row of extra space
+  std::vector<FeatureType> cycleStartRow(rowStride_);
+  std::vector<bool> isPlaced(numRows, false);
+  for (size_t start = 0; start < numRows; ++start) {
+    if (isPlaced[start] || sourceIdxs[start] == start) continue;
+    FeatureType* startRow = addressFromIdx(static_cast<unsigned int>(start));
+    std::copy(startRow, startRow + rowStride_, cycleStartRow.begin());
+    size_t dest = start;
+    while (true) {
+      isPlaced[dest] = true;
+      size_t source = sourceIdxs[dest];
+      FeatureType* destRow = addressFromIdx(static_cast<unsigned int>(dest));
+      if (source == start) {
+        std::copy(cycleStartRow.begin(), cycleStartRow.end(), destRow);
+        break;
+      }
+      FeatureType* sourceRow = addressFromIdx(static_cast<unsigned int>(source));
+      std::copy(sourceRow, sourceRow + rowStride_, destRow);
+      dest = source;
+    }
+  }
+  
+  freeRows_.clear();
+  for (size_t i = numRows; i-- > rows.size(); ) {
+    freeRows_.push_back(addressFromIdx(static_cast<unsigned int>(i)));
+  }
 }
 
-double* FeatureMemoryPool::allocate() {
+FeatureType* FeatureMemoryPool::allocate() {
   if (freeRows_.size() == 0) {
     if (initializedRows_ >= numRowsPerBlock_ * memStarts_.size()) {
       createNewBlock();
@@ -50,11 +186,11 @@ double* FeatureMemoryPool::allocate() {
     freeRows_.push_back(addressFromIdx(initializedRows_));
     initializedRows_++;
   }
-  double* ret = freeRows_.back();
+  FeatureType* ret = freeRows_.back();
   freeRows_.pop_back();
   return ret;
 }
 
-void FeatureMemoryPool::deallocate(double* p) {
+void FeatureMemoryPool::deallocate(FeatureType* p) {
   freeRows_.push_back(p);
 }
@@ -22,29 +22,69 @@
 #include <vector>
 #include <iostream>
 
+/*
+ * The type the feature values are stored as. Building with 
+ * -DSINGLE_PRECISION_FEATURES=ON stores them as float, which halves the
+ * memory footprint and bandwidth of the feature rows; scores, normalization
+ * statistics and the SVM solver still accumulate in double.
+ */
+#ifdef SINGLE_PRECISION_FEATURES
+typedef float FeatureType;
+#else
+typedef double FeatureType;
+#endif
+
+/*
+ * Hands out the feature rows of the PSMs from large blocks. The blocks are
+ * the size of a huge page and, where the platform allows it, backed by 
+ * explicit or transparent huge pages to keep the TLB misses of the scoring 
+ * and training loops down. Rows start at kRowAlignment byte boundaries, the
+ * padding after the last feature of a row is kept at zero.
+ */
 class FeatureMemoryPool {
+ public:
+   static const size_t kBlockBytes = 1u << 21; // the x86-64 huge page size
+   static const unsigned int kBlockSize = 
+       kBlockBytes / sizeof(FeatureType); // in number of features
+   static const size_t kRowAlignment = 32u; // in bytes, an AVX register
  private:
-   static const unsigned int kBlockSize = 65536; // in number of doubles, e.g. 0.5MB if sizeof(double) = 8
-   unsigned int numRowsPerBlock_, numFeatures_, initializedRows_;
-   std::vector<double*> memStarts_;
-   std::vector<double*> freeRows_;
+   unsigned int numRowsPerBlock_, numFeatures_, rowStride_, initializedRows_;
+   std::vector<FeatureType*> memStarts_;
+   std::vector<FeatureType*> freeRows_;
+   size_t numAdoptedBlocks_; // leading blocks of memStarts_ that are not owned
    bool isInitialized_;
+
+   static FeatureType* allocateBlock();
+   static void freeBlock(FeatureType* memStart);
  public:
-  FeatureMemoryPool() : numRowsPerBlock_(0), numFeatures_(0), 
-                        initializedRows_(0), isInitialized_(false) {}
+  FeatureMemoryPool() : numRowsPerBlock_(0), numFeatures_(0), rowStride_(0),
+                        initializedRows_(0), numAdoptedBlocks_(0), 
+                        isInitialized_(false) {}
 
   ~FeatureMemoryPool() { destroyPool(); }
 
+  // distance in features between the starts of consecutive rows
+  static size_t getRowStride(size_t numFeatures);
+
   void createPool(size_t numFeatures);
   void createNewBlock();
+  // uses numRows rows of externally owned memory, laid out as consecutive 
+  // blocks of kBlockSize features with getRowStride() features per row, as 
+  // the first rows of an empty pool
+  void adoptBlocks(FeatureType* memStart, size_t numRows);
   void destroyPool();
   
   inline bool isInitialized() const { return isInitialized_; }
+  inline unsigned int getNumRowsPerBlock() const { return numRowsPerBlock_; }
 
-  double* addressFromIdx(unsigned int i) const;
+  FeatureType* addressFromIdx(unsigned int i) const;
+  // Moves the rows so that rows[k] ends up at index k, the rows of the pool
+  // that are not in rows are moved behind them and become the free rows. 
+  // rows has to hold every row that is in use.
+  void permuteRows(const std::vector<FeatureType*>& rows);
 
-  double* allocate();
-  void deallocate(double* p);
+  FeatureType* allocate();
+  void deallocate(FeatureType* p);
 };
 
 #endif /* FEATURE_MEMORY_POOL_H_ */
@@ -0,0 +1,61 @@
+/*******************************************************************************
+ Copyright 2006-2012 Lukas Käll <lukas.kall@scilifelab.se>
+
+ Licensed under the Apache License, Version 2.0 (the "License");
+ you may not use this file except in compliance with the License.
+ You may obtain a copy of the License at
+
+ http://www.apache.org/licenses/LICENSE-2.0
+
+ Unless required by applicable law or agreed to in writing, software
+ distributed under the License is distributed on an "AS IS" BASIS,
+ WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ See the License for the specific language governing permissions and
+ limitations under the License.
+
+ *******************************************************************************/
+#include "FeatureStatistics.h"
+
+#include <algorithm>
+#include <cassert>
+
+void FeatureStatistics::reset(size_t numFeatures) {
+  numRows_ = 0u;
+  means_.assign(numFeatures, 0.0);
+  sumSquares_.assign(numFeatures, 0.0);
+  mins_.assign(numFeatures, 1e+100);
+  maxs_.assign(numFeatures, -1e+100);
+}
+
+void FeatureStatistics::add(const FeatureType* features) {
+  ++numRows_;
+  const double invNumRows = 1.0 / static_cast<double>(numRows_);
+  for (size_t ix = 0; ix < means_.size(); ++ix) {
+    double x = features[ix];
+    double delta = x - means_[ix];
+    means_[ix] += delta * invNumRows;
+    sumSquares_[ix] += delta * (x - means_[ix]);
+    mins_[ix] = std::min(x, mins_[ix]);
+    maxs_[ix] = std::max(x, maxs_[ix]);
+  }
+}
+
+void FeatureStatistics::merge(const FeatureStatistics& other) {
+  assert(other.getNumFeatures() == getNumFeatures());
+  if (other.numRows_ == 0u) return;
+  if (numRows_ == 0u) {
+    *this = other;
+    return;
+  }
+  double n1 = static_cast<double>(numRows_);
+  double n2 = static_cast<double>(other.numRows_);
+  double n = n1 + n2;
+  for (size_t ix = 0; ix < means_.size(); ++ix) {
+    double delta = other.means_[ix] - means_[ix];
+    means_[ix] += delta * n2 / n;
+    sumSquares_[ix] += other.sumSquares_[ix] + delta * delta * n1 * n2 / n;
+    mins_[ix] = std::min(mins_[ix], other.mins_[ix]);
+    maxs_[ix] = std::max(maxs_[ix], other.maxs_[ix]);
+  }
+  numRows_ += other.numRows_;
+}
@@ -0,0 +1,58 @@
+/*******************************************************************************
+ Copyright 2006-2012 Lukas Käll <lukas.kall@scilifelab.se>
+
+ Licensed under the Apache License, Version 2.0 (the "License");
+ you may not use this file except in compliance with the License.
+ You may obtain a copy of the License at
+
+ http://www.apache.org/licenses/LICENSE-2.0
+
+ Unless required by applicable law or agreed to in writing, software
+ distributed under the License is distributed on an "AS IS" BASIS,
+ WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ See the License for the specific language governing permissions and
+ limitations under the License.
+
+ *******************************************************************************/
+#ifndef FEATURESTATISTICS_H_
+#define FEATURESTATISTICS_H_
+
+#include <cstddef>
+#include <vector>
+
+#include "FeatureMemoryPool.h"
+
+/*
+ * FeatureStatistics keeps the running mean, the sum of squared deviations
+ * from the mean (Welford's algorithm), the minimum and the maximum of every
+ * feature of the rows added to it, so that the normalizers can be set up 
+ * while the rows are parsed instead of in extra passes over the matrix.
+ * Statistics gathered over separate parts of the rows are combined with 
+ * merge(); merging the parts in a fixed order gives the same result 
+ * whatever the number of threads that gathered them.
+ */
+class FeatureStatistics {
+ public:
+  FeatureStatistics() : numRows_(0u) {}
+  explicit FeatureStatistics(size_t numFeatures) { reset(numFeatures); }
+  
+  void reset(size_t numFeatures);
+  void add(const FeatureType* features);
+  void merge(const FeatureStatistics& other);
+  
+  inline size_t getNumFeatures() const { return means_.size(); }
+  inline size_t getNumRows() const { return numRows_; }
+  inline double getMean(size_t ix) const { return means_[ix]; }
+  // the population variance, i.e. divided by the number of rows
+  inline double getVariance(size_t ix) const { 
+    return numRows_ > 0u ? sumSquares_[ix] / static_cast<double>(numRows_) : 0.0;
+  }
+  inline double getMin(size_t ix) const { return mins_[ix]; }
+  inline double getMax(size_t ix) const { return maxs_[ix]; }
+  
+ private:
+  size_t numRows_;
+  std::vector<double> means_, sumSquares_, mins_, maxs_;
+};
+
+#endif /* FEATURESTATISTICS_H_ */
@@ -0,0 +1,263 @@
+/*******************************************************************************
+ Copyright 2006-2012 Lukas Käll <lukas.kall@scilifelab.se>
+
+ Licensed under the Apache License, Version 2.0 (the "License");
+ you may not use this file except in compliance with the License.
+ You may obtain a copy of the License at
+
+ http://www.apache.org/licenses/LICENSE-2.0
+
+ Unless required by applicable law or agreed to in writing, software
+ distributed under the License is distributed on an "AS IS" BASIS,
+ WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ See the License for the specific language governing permissions and
+ limitations under the License.
+
+ *******************************************************************************/
+#include "LinearScorer.h"
+
+#if defined(__GNUC__) && (defined(__x86_64__) || defined(__i386__))
+#define LINEARSCORER_X86
+#include <immintrin.h>
+#endif
+
+/*
+ * This file is compiled with -ffp-contract=off, see src/CMakeLists.txt, as
+ * the AVX-512 target also enables FMA and the compiler would otherwise fuse
+ * the multiplications and additions of the vector kernels.
+ */
+
+namespace {
+
+template <bool kBiasFirst>
+void scoreRowsScalar(const FeatureType* const* rows, size_t numRows,
+                     const double* w, size_t numFeatures, double* scores) {
+  for (size_t i = 0; i < numRows; ++i) {
+    const FeatureType* row = rows[i];
+    double score;
+    if (kBiasFirst) {
+      score = w[numFeatures];
+      for (size_t ix = numFeatures; ix--;) {
+        score += row[ix] * w[ix];
+      }
+    } else {
+      score = 0.0;
+      for (size_t ix = 0; ix < numFeatures; ++ix) {
+        score += row[ix] * w[ix];
+      }
+      score += w[numFeatures];
+    }
+    scores[i] = score;
+  }
+}
+
+#ifdef LINEARSCORER_X86
+
+__attribute__((target("avx2")))
+inline __m256d load4(const double* features) {
+  return _mm256_loadu_pd(features);
+}
+
+__attribute__((target("avx2")))
+inline __m256d load4(const float* features) {
+  return _mm256_cvtps_pd(_mm_loadu_ps(features));
+}
+
+// feature ix of the rows r[0..4)
+__attribute__((target("avx2")))
+inline __m256d loadColumn4(const FeatureType* const* r, size_t ix) {
+  return _mm256_set_pd(r[3][ix], r[2][ix], r[1][ix], r[0][ix]);
+}
+
+// features ix..ix+3 of the rows r[0..4) as columns, by a 4x4 transpose
+__attribute__((target("avx2")))
+inline void loadColumns4(const FeatureType* const* r, size_t ix,
+                         __m256d* columns) {
+  __m256d r0 = load4(r[0] + ix), r1 = load4(r[1] + ix);
+  __m256d r2 = load4(r[2] + ix), r3 = load4(r[3] + ix);
+  __m256d t0 = _mm256_unpacklo_pd(r0, r1), t1 = _mm256_unpackhi_pd(r0, r1);
+  __m256d t2 = _mm256_unpacklo_pd(r2, r3), t3 = _mm256_unpackhi_pd(r2, r3);
+  columns[0] = _mm256_permute2f128_pd(t0, t2, 0x20);
+  columns[1] = _mm256_permute2f128_pd(t1, t3, 0x20);
+  columns[2] = _mm256_permute2f128_pd(t0, t2, 0x31);
+  columns[3] = _mm256_permute2f128_pd(t1, t3, 0x31);
+}
+
+template <bool kBiasFirst>
+__attribute__((target("avx2")))
+void scoreRowsAvx2(const FeatureType* const* rows, size_t numRows,
+                   const double* w, size_t numFeatures, double* scores) {
+  size_t numVectorRows = numRows - numRows % 4u;
+  size_t numBlockFeatures = numFeatures - numFeatures % 4u;
+  __m256d columns[4];
+  for (size_t i = 0; i < numVectorRows; i += 4u) {
+    const FeatureType* const* r = rows + i;
+    __m256d score;
+    if (kBiasFirst) {
+      score = _mm256_set1_pd(w[numFeatures]);
+      for (size_t ix = numFeatures; ix > numBlockFeatures;) {
+        --ix;
+        score = _mm256_add_pd(score, _mm256_mul_pd(loadColumn4(r, ix),
+                                                   _mm256_set1_pd(w[ix])));
+      }
+      for (size_t ix = numBlockFeatures; ix > 0u;) {
+        ix -= 4u;
+        loadColumns4(r, ix, columns);
+        for (size_t k = 4u; k--;) {
+          score = _mm256_add_pd(score, _mm256_mul_pd(columns[k],
+                                                     _mm256_set1_pd(w[ix + k])));
+        }
+      }
+    } else {
+      score = _mm256_setzero_pd();
+      for (size_t ix = 0; ix < numBlockFeatures; ix += 4u) {
+        loadColumns4(r, ix, columns);
+        for (size_t k = 0; k < 4u; ++k) {
+          score = _mm256_add_pd(score, _mm256_mul_pd(columns[k],
+                                                     _mm256_set1_pd(w[ix + k])));
+        }
+      }
+      for (size_t ix = numBlockFeatures; ix < numFeatures; ++ix) {
+        score = _mm256_add_pd(score, _mm256_mul_pd(loadColumn4(r, ix),
+                                                   _mm256_set1_pd(w[ix])));
+      }
+      score = _mm256_add_pd(score, _mm256_set1_pd(w[numFeatures]));
+    }
+    _mm256_storeu_pd(scores + i, score);
+  }
+  scoreRowsScalar<kBiasFirst>(rows + numVectorRows, numRows - numVectorRows,
+                              w, numFeatures, scores + numVectorRows);
+}
+
+// feature ix of the rows r[0..8)
+__attribute__((target("avx512f")))
+inline __m512d loadColumn8(const FeatureType* const* r, size_t ix) {
+  return _mm512_set_pd(r[7][ix], r[6][ix], r[5][ix], r[4][ix],
+                       r[3][ix], r[2][ix], r[1][ix], r[0][ix]);
+}
+
+// features ix..ix+3 of the rows r[0..8) as columns
+__attribute__((target("avx512f")))
+inline void loadColumns8(const FeatureType* const* r, size_t ix,
+                         __m512d* columns) {
+  __m256d low[4], high[4];
+  loadColumns4(r, ix, low);
+  loadColumns4(r + 4, ix, high);
+  for (size_t k = 0; k < 4u; ++k) {
+    columns[k] = _mm512_insertf64x4(_mm512_castpd256_pd512(low[k]),
+                                    high[k], 1);
+  }
+}
+
+template <bool kBiasFirst>
+__attribute__((target("avx512f")))
+void scoreRowsAvx512(const FeatureType* const* rows, size_t numRows,
+                     const double* w, size_t numFeatures, double* scores) {
+  size_t numVectorRows = numRows - numRows % 8u;
+  size_t numBlockFeatures = numFeatures - numFeatures % 4u;
+  __m512d columns[4];
+  for (size_t i = 0; i < numVectorRows; i += 8u) {
+    const FeatureType* const* r = rows + i;
+    __m512d score;
+    if (kBiasFirst) {
+      score = _mm512_set1_pd(w[numFeatures]);
+      for (size_t ix = numFeatures; ix > numBlockFeatures;) {
+        --ix;
+        score = _mm512_add_pd(score, _mm512_mul_pd(loadColumn8(r, ix),
+                                                   _mm512_set1_pd(w[ix])));
+      }
+      for (size_t ix = numBlockFeatures; ix > 0u;) {
+        ix -= 4u;
+        loadColumns8(r, ix, columns);
+        for (size_t k = 4u; k--;) {
+          score = _mm512_add_pd(score, _mm512_mul_pd(columns[k],
+                                                     _mm512_set1_pd(w[ix + k])));
+        }
+      }
+    } else {
+      score = _mm512_setzero_pd();
+      for (size_t ix = 0; ix < numBlockFeatures; ix += 4u) {
+        loadColumns8(r, ix, columns);
+        for (size_t k = 0; k < 4u; ++k) {
+          score = _mm512_add_pd(score, _mm512_mul_pd(columns[k],
+                                                     _mm512_set1_pd(w[ix + k])));
+        }
+      }
+      for (size_t ix = numBlockFeatures; ix < numFeatures; ++ix) {
+        score = _mm512_add_pd(score, _mm512_mul_pd(loadColumn8(r, ix),
+                                                   _mm512_set1_pd(w[ix])));
+      }
+      score = _mm512_add_pd(score, _mm512_set1_pd(w[numFeatures]));
+    }
+    _mm512_storeu_pd(scores + i, score);
+  }
+  scoreRowsAvx2<kBiasFirst>(rows + numVectorRows, numRows - numVectorRows,
+                            w, numFeatures, scores + numVectorRows);
+}
+
+#endif /* LINEARSCORER_X86 */
+
+LinearScorer::Kernel detectKernel() {
+#ifdef LINEARSCORER_X86
+  __builtin_cpu_init();
+  if (__builtin_cpu_supports("avx512f")) {
+    return LinearScorer::AVX512;
+  }
+  if (__builtin_cpu_supports("avx2")) {
+    return LinearScorer::AVX2;
+  }
+#endif
+  return LinearScorer::SCALAR;
+}
+
+template <bool kBiasFirst>
+void scoreRowsWith(const FeatureType* const* rows, size_t numRows,
+                   const double* w, size_t numFeatures, double* scores,
+                   LinearScorer::Kernel kernel) {
+  switch (kernel) {
+#ifdef LINEARSCORER_X86
+    case LinearScorer::AVX512:
+      scoreRowsAvx512<kBiasFirst>(rows, numRows, w, numFeatures, scores);
+      return;
+    case LinearScorer::AVX2:
+      scoreRowsAvx2<kBiasFirst>(rows, numRows, w, numFeatures, scores);
+      return;
+#endif
+    default:
+      scoreRowsScalar<kBiasFirst>(rows, numRows, w, numFeatures, scores);
+  }
+}
+
+}  // namespace
+
+LinearScorer::Kernel LinearScorer::getBestKernel() {
+  static const Kernel kernel = detectKernel();
+  return kernel;
+}
+
+const char* LinearScorer::getKernelName(Kernel kernel) {
+  switch (kernel) {
+    case AVX512:
+      return "AVX-512";
+    case AVX2:
+      return "AVX2";
+    default:
+      return "scalar";
+  }
+}
+
+void LinearScorer::scoreRows(const FeatureType* const* rows, size_t numRows,
+                             const double* w, size_t numFeatures,
+                             double* scores, SumOrder order) {
+  scoreRows(rows, numRows, w, numFeatures, scores, order, getBestKernel());
+}
+
+void LinearScorer::scoreRows(const FeatureType* const* rows, size_t numRows,
+                             const double* w, size_t numFeatures,
+                             double* scores, SumOrder order, Kernel kernel) {
+  if (order == BIAS_FIRST) {
+    scoreRowsWith<true>(rows, numRows, w, numFeatures, scores, kernel);
+  } else {
+    scoreRowsWith<false>(rows, numRows, w, numFeatures, scores, kernel);
+  }
+}
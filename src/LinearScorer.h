@@ -0,0 +1,58 @@
+/*******************************************************************************
+ Copyright 2006-2012 Lukas Käll <lukas.kall@scilifelab.se>
+
+ Licensed under the Apache License, Version 2.0 (the "License");
+ you may not use this file except in compliance with the License.
+ You may obtain a copy of the License at
+
+ http://www.apache.org/licenses/LICENSE-2.0
+
+ Unless required by applicable law or agreed to in writing, software
+ distributed under the License is distributed on an "AS IS" BASIS,
+ WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ See the License for the specific language governing permissions and
+ limitations under the License.
+
+ *******************************************************************************/
+#ifndef LINEARSCORER_H_
+#define LINEARSCORER_H_
+
+#include <cstddef>
+
+#include "FeatureMemoryPool.h"
+
+/*
+ * LinearScorer computes the SVM scores of a batch of feature rows with one
+ * weight vector, i.e. the matrix-vector product of the rows and the weights
+ * plus the bias w[numFeatures]. The kernel is picked once at runtime from the
+ * instruction sets of the CPU: AVX-512 and AVX2 score 8 and 4 rows per
+ * vector, and the portable kernel one row at a time.
+ *
+ * The vector kernels put one row in each lane and add the products of a row
+ * in the same order as the portable kernel, without fused multiply-adds, so
+ * that the scores do not depend on the CPU. Two orders are in use:
+ * BIAS_FIRST starts from the bias and adds the features from the last to the
+ * first, as Scores::calcScore always did, and BIAS_LAST adds the features
+ * from the first and then the bias, as the raw weights of -w and -N are
+ * applied.
+ */
+class LinearScorer {
+ public:
+  enum Kernel { SCALAR, AVX2, AVX512 };
+  enum SumOrder { BIAS_FIRST, BIAS_LAST };
+
+  // the fastest kernel this CPU supports, detected on the first call
+  static Kernel getBestKernel();
+  static const char* getKernelName(Kernel kernel);
+
+  // scores[i] = rows[i][0..numFeatures) . w[0..numFeatures) + w[numFeatures]
+  static void scoreRows(const FeatureType* const* rows, size_t numRows,
+                        const double* w, size_t numFeatures, double* scores,
+                        SumOrder order);
+  // as above with a given kernel, which has to be supported by the CPU
+  static void scoreRows(const FeatureType* const* rows, size_t numRows,
+                        const double* w, size_t numFeatures, double* scores,
+                        SumOrder order, Kernel kernel);
+};
+
+#endif /* LINEARSCORER_H_ */
@@ -0,0 +1,96 @@
+/*******************************************************************************
+ Copyright 2006-2012 Lukas Käll <lukas.kall@scilifelab.se>
+
+ Licensed under the Apache License, Version 2.0 (the "License");
+ you may not use this file except in compliance with the License.
+ You may obtain a copy of the License at
+
+ http://www.apache.org/licenses/LICENSE-2.0
+
+ Unless required by applicable law or agreed to in writing, software
+ distributed under the License is distributed on an "AS IS" BASIS,
+ WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ See the License for the specific language governing permissions and
+ limitations under the License.
+
+ *******************************************************************************/
+
+#include "MemoryMappedFile.h"
+
+#ifndef _WIN32
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+#endif
+
+bool MemoryMappedFile::open(const std::string& fileName, bool copyOnWrite) {
+  close();
+#ifndef _WIN32
+  int fd = ::open(fileName.c_str(), O_RDONLY);
+  if (fd < 0) return false;
+  struct stat fileStat;
+  if (fstat(fd, &fileStat) != 0 || !S_ISREG(fileStat.st_mode)) {
+    ::close(fd);
+    return false;
+  }
+  size_ = static_cast<size_t>(fileStat.st_size);
+  if (size_ > 0) {
+    int protection = copyOnWrite ? (PROT_READ | PROT_WRITE) : PROT_READ;
+    void* addr = mmap(NULL, size_, protection, MAP_PRIVATE, fd, 0);
+    if (addr == MAP_FAILED) {
+      ::close(fd);
+      size_ = 0;
+      return false;
+    }
+    data_ = static_cast<char*>(addr);
+    if (!copyOnWrite) madvise(addr, size_, MADV_SEQUENTIAL);
+  }
+  ::close(fd); // the mapping stays valid after closing the descriptor
+  setg(data_, data_, data_ + size_);
+  isOpen_ = true;
+  return true;
+#else
+  (void)fileName;
+  (void)copyOnWrite;
+  return false;
+#endif
+}
+
+void MemoryMappedFile::close() {
+#ifndef _WIN32
+  if (data_ != NULL) {
+    munmap(data_, size_);
+  }
+#endif
+  data_ = NULL;
+  size_ = 0;
+  isOpen_ = false;
+  setg(NULL, NULL, NULL);
+}
+
+void MemoryMappedFile::consume(const char* newReadPosition) {
+  setg(data_, data_ + (newReadPosition - data_), data_ + size_);
+}
+
+MemoryMappedFile::pos_type MemoryMappedFile::seekoff(off_type off, 
+    std::ios_base::seekdir dir, std::ios_base::openmode which) {
+  off_type base = 0;
+  if (dir == std::ios_base::cur) {
+    base = static_cast<off_type>(gptr() - data_);
+  } else if (dir == std::ios_base::end) {
+    base = static_cast<off_type>(size_);
+  }
+  return seekpos(pos_type(base + off), which);
+}
+
+MemoryMappedFile::pos_type MemoryMappedFile::seekpos(pos_type pos, 
+    std::ios_base::openmode which) {
+  off_type offset = static_cast<off_type>(pos);
+  if (!(which & std::ios_base::in) || offset < 0 || 
+      offset > static_cast<off_type>(size_)) {
+    return pos_type(off_type(-1));
+  }
+  setg(data_, data_ + offset, data_ + size_);
+  return pos;
+}
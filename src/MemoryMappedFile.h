@@ -0,0 +1,89 @@
+/*******************************************************************************
+ Copyright 2006-2012 Lukas Käll <lukas.kall@scilifelab.se>
+
+ Licensed under the Apache License, Version 2.0 (the "License");
+ you may not use this file except in compliance with the License.
+ You may obtain a copy of the License at
+
+ http://www.apache.org/licenses/LICENSE-2.0
+
+ Unless required by applicable law or agreed to in writing, software
+ distributed under the License is distributed on an "AS IS" BASIS,
+ WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ See the License for the specific language governing permissions and
+ limitations under the License.
+
+ *******************************************************************************/
+
+#ifndef MEMORYMAPPEDFILE_H_
+#define MEMORYMAPPEDFILE_H_
+
+#include <cstddef>
+#include <istream>
+#include <streambuf>
+#include <string>
+
+/*
+ * MemoryMappedFile maps a regular file read-only into memory and exposes it 
+ * as a stream buffer, so that it can be read through a std::istream like any
+ * other input. Readers that know about it (SetHandler) can instead access 
+ * the remaining bytes directly and parse them without copying.
+ *
+ * open() fails for non-regular files and on platforms without mmap, in which
+ * case callers should fall back to a std::ifstream. With copyOnWrite set, the
+ * mapping can also be written to, without the changes reaching the file.
+ */
+class MemoryMappedFile : public std::streambuf {
+ public:
+  MemoryMappedFile() : data_(NULL), size_(0), isOpen_(false) {}
+  ~MemoryMappedFile() { close(); }
+  
+  bool open(const std::string& fileName, bool copyOnWrite = false);
+  void close();
+  inline bool isOpen() const { return isOpen_; }
+  
+  inline const char* data() const { return data_; }
+  inline char* data() { return data_; }
+  inline size_t size() const { return size_; }
+  
+  // unread part of the file, the read position can be moved with consume()
+  inline const char* readPosition() const { return gptr(); }
+  inline const char* endPosition() const { return egptr(); }
+  void consume(const char* newReadPosition);
+  
+ protected:
+  pos_type seekoff(off_type off, std::ios_base::seekdir dir,
+                   std::ios_base::openmode which);
+  pos_type seekpos(pos_type pos, std::ios_base::openmode which);
+  
+ private:
+  char* data_;
+  size_t size_;
+  bool isOpen_;
+  
+  MemoryMappedFile(const MemoryMappedFile&);
+  MemoryMappedFile& operator=(const MemoryMappedFile&);
+};
+
+/*
+ * std::istream reading from a MemoryMappedFile it owns.
+ */
+class MemoryMappedFileStream : public std::istream {
+ public:
+  MemoryMappedFileStream() : std::istream(NULL) { rdbuf(&mappedFile_); }
+  
+  bool open(const std::string& fileName) {
+    bool success = mappedFile_.open(fileName);
+    if (success) {
+      clear();
+    } else {
+      setstate(std::ios_base::failbit);
+    }
+    return success;
+  }
+  
+ private:
+  MemoryMappedFile mappedFile_;
+};
+
+#endif /* MEMORYMAPPEDFILE_H_ */
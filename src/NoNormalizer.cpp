@@ -51,8 +51,8 @@ void NoNormalizer::normalizeweight(const std::vector<double>& in,
   }
 }
 
-void NoNormalizer::setSet(std::vector<double*>& /* featuresV */,
-                            std::vector<double*>& /* rtFeaturesV */, size_t nf,
+void NoNormalizer::setSet(std::vector<FeatureType*>& /* featuresV */,
+                            std::vector<FeatureType*>& /* rtFeaturesV */, size_t nf,
                             size_t nrf) {
   numFeatures = nf;
   numRetentionFeatures = nrf;
@@ -66,7 +66,7 @@ void NoNormalizer::setSet(std::vector<double*>& /* featuresV */,
 }
 
 
-void NoNormalizer::updateSet(vector<double*> & /* featuresV */, size_t /* offset */,
+void NoNormalizer::updateSet(vector<FeatureType*> & /* featuresV */, size_t /* offset */,
                                size_t numFeatures) {
   size_t ix;
   for (ix = 0; ix < numFeatures; ++ix) {
@@ -74,3 +74,8 @@ void NoNormalizer::updateSet(vector<double*> & /* featuresV */, size_t /* offset
     div[ix] = 1.0;
   }
 }
+
+void NoNormalizer::setStatistics(const FeatureStatistics& stats) {
+  std::vector<FeatureType*> noFeatures;
+  setSet(noFeatures, noFeatures, stats.getNumFeatures(), 0);
+}
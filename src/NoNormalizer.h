@@ -21,11 +21,12 @@ class NoNormalizer : public Normalizer { // virtual Normalizer
  public:
   NoNormalizer();
   virtual ~NoNormalizer();
-  virtual void setSet(vector<double*> & featuresV,
-                      vector<double*> & rtFeaturesV, size_t numFeatures,
+  virtual void setSet(vector<FeatureType*> & featuresV,
+                      vector<FeatureType*> & rtFeaturesV, size_t numFeatures,
                       size_t numRetentionFeatures);
-  virtual void updateSet(vector<double*> & featuresV, size_t offset,
+  virtual void updateSet(vector<FeatureType*> & featuresV, size_t offset,
                          size_t numFeatures);
+  virtual void setStatistics(const FeatureStatistics& stats);
   void unnormalizeweight(const vector<double>& in, vector<double>& out) const;
   void normalizeweight(const vector<double>& in, vector<double>& out) const;
 };
@@ -36,23 +36,22 @@ Normalizer::Normalizer() {
 Normalizer::~Normalizer() {
 }
 
-void Normalizer::normalizeSet(vector<double*>& featuresV,
-                              vector<double*>& rtFeaturesV) {
+void Normalizer::normalizeSet(vector<FeatureType*>& featuresV,
+                              vector<FeatureType*>& rtFeaturesV) {
   normalizeSet(featuresV, 0, numFeatures);
   normalizeSet(rtFeaturesV, numFeatures, numRetentionFeatures);
 }
 
-void Normalizer::normalizeSet(vector<double*>& featuresV,
+void Normalizer::normalizeSet(vector<FeatureType*>& featuresV,
                               size_t offset, size_t numFeatures) {
-  double* features;
-  vector<double*>::iterator it = featuresV.begin();
-  for (; it != featuresV.end(); ++it) {
-    features = *it;
-    normalize(features, features, offset, numFeatures);
+  int numRows = static_cast<int>(featuresV.size());
+#pragma omp parallel for schedule(static)
+  for (int i = 0; i < numRows; ++i) {
+    normalize(featuresV[i], featuresV[i], offset, numFeatures);
   }
 }
 
-void Normalizer::normalize(const double* in, double* out, size_t offset,
+void Normalizer::normalize(const FeatureType* in, FeatureType* out, size_t offset,
                            size_t numFeatures) {
   for (unsigned int ix = 0; ix < numFeatures; ++ix) {
     out[ix] = (in[ix] - sub[offset + ix]) / div[offset + ix];
@@ -20,22 +20,28 @@
 #include <vector>
 #include <iostream>
 
+#include "FeatureMemoryPool.h"
+#include "FeatureStatistics.h"
+
 using namespace std;
 
 class Normalizer {
  public:
   virtual ~Normalizer();
-  virtual void setSet(vector<double*>& /* featuresV */,
-                      vector<double*>& /* rtFeaturesV */, size_t /* numFeatures */,
+  virtual void setSet(vector<FeatureType*>& /* featuresV */,
+                      vector<FeatureType*>& /* rtFeaturesV */, size_t /* numFeatures */,
                       size_t /* numRetentionFeatures*/ ) {}
-  virtual void updateSet(vector<double*>& /* featuresV */, size_t /* offset */,
+  virtual void updateSet(vector<FeatureType*>& /* featuresV */, size_t /* offset */,
                          size_t /* numFeatures */) {}
+  // same as setSet without retention features, from statistics gathered 
+  // while the feature rows were read
+  virtual void setStatistics(const FeatureStatistics& /* stats */) {}
   
-  void normalizeSet(vector<double*>& featuresV,
-                    vector<double*>& rtFeaturesV);
-  void normalizeSet(vector<double*>& featuresV,
+  void normalizeSet(vector<FeatureType*>& featuresV,
+                    vector<FeatureType*>& rtFeaturesV);
+  void normalizeSet(vector<FeatureType*>& featuresV,
                     size_t offset, size_t numFeatures);
-  void normalize(const double* in, double* out, size_t offset,
+  void normalize(const FeatureType* in, FeatureType* out, size_t offset,
                  size_t numFeatures);
   inline double normalize(const double in, size_t index) {
     return (in - sub[index]) / div[index];
@@ -0,0 +1,94 @@
+/*******************************************************************************
+ Copyright 2006-2012 Lukas Käll <lukas.kall@scilifelab.se>
+
+ Licensed under the Apache License, Version 2.0 (the "License");
+ you may not use this file except in compliance with the License.
+ You may obtain a copy of the License at
+
+ http://www.apache.org/licenses/LICENSE-2.0
+
+ Unless required by applicable law or agreed to in writing, software
+ distributed under the License is distributed on an "AS IS" BASIS,
+ WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ See the License for the specific language governing permissions and
+ limitations under the License.
+
+ *******************************************************************************/
+
+#include "PSMArena.h"
+
+#include <cstring>
+#include <type_traits>
+
+static_assert(std::is_trivially_destructible<PSMDescription>::value,
+              "PSMArena releases PSMs without calling their destructors");
+
+void* PSMArena::allocate(size_t numBytes, size_t alignment) {
+  numBytes_ += numBytes;
+  size_t start = (used_ + alignment - 1u) & ~(alignment - 1u);
+  if (numBytes > kChunkSize / 4u) {
+    // large requests get a chunk of their own, the current one stays in use
+    chunks_.push_back(std::unique_ptr<char[]>(new char[numBytes]));
+    return chunks_.back().get();
+  }
+  if (start + numBytes > kChunkSize) {
+    chunks_.push_back(std::unique_ptr<char[]>(new char[kChunkSize]));
+    current_ = chunks_.back().get();
+    start = 0u;
+  }
+  used_ = start + numBytes;
+  return current_ + start;
+}
+
+PSMDescription* PSMArena::create() {
+  void* slot;
+  if (!freePsms_.empty()) {
+    slot = freePsms_.back();
+    freePsms_.pop_back();
+  } else {
+    slot = allocate(sizeof(PSMDescription), alignof(PSMDescription));
+    ++numPsmSlots_;
+  }
+  return new (slot) PSMDescription();
+}
+
+void PSMArena::release(PSMDescription* psm) {
+  releaseString(psm->getIdRef());
+  releaseString(psm->getFullPeptideRef());
+  freePsms_.push_back(psm);
+}
+
+StringRef PSMArena::storeString(const char* s, size_t length) {
+  if (length == 0u) return StringRef();
+  // strings that can be reused take a multiple of kStringGranularity bytes,
+  // so that any released string of their class fits them
+  size_t stringClass = getStringClass(length);
+  char* chars;
+  if (stringClass < freeStrings_.size() && !freeStrings_[stringClass].empty()) {
+    chars = freeStrings_[stringClass].back();
+    freeStrings_[stringClass].pop_back();
+  } else if (stringClass < kNumStringClasses) {
+    chars = static_cast<char*>(allocate(stringClass * kStringGranularity, 1u));
+  } else {
+    chars = static_cast<char*>(allocate(length, 1u));
+  }
+  memcpy(chars, s, length);
+  return StringRef(chars, length);
+}
+
+void PSMArena::releaseString(const StringRef& s) {
+  size_t stringClass = getStringClass(s.size());
+  if (stringClass == 0u || stringClass >= kNumStringClasses) return;
+  if (freeStrings_.size() <= stringClass) freeStrings_.resize(stringClass + 1u);
+  freeStrings_[stringClass].push_back(const_cast<char*>(s.data()));
+}
+
+void PSMArena::clear() {
+  chunks_.clear();
+  current_ = NULL;
+  used_ = kChunkSize;
+  numPsmSlots_ = 0u;
+  numBytes_ = 0u;
+  freePsms_.clear();
+  freeStrings_.clear();
+}
@@ -0,0 +1,96 @@
+/*******************************************************************************
+ Copyright 2006-2012 Lukas Käll <lukas.kall@scilifelab.se>
+
+ Licensed under the Apache License, Version 2.0 (the "License");
+ you may not use this file except in compliance with the License.
+ You may obtain a copy of the License at
+
+ http://www.apache.org/licenses/LICENSE-2.0
+
+ Unless required by applicable law or agreed to in writing, software
+ distributed under the License is distributed on an "AS IS" BASIS,
+ WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ See the License for the specific language governing permissions and
+ limitations under the License.
+
+ *******************************************************************************/
+#ifndef PSMARENA_H_
+#define PSMARENA_H_
+
+#include <cstddef>
+#include <memory>
+#include <new>
+#include <string>
+#include <vector>
+
+#include "PSMDescription.h"
+#include "StringRef.h"
+
+/*
+ * PSMArena is a bump allocator for PSMDescriptions and the characters of
+ * their ids and peptides. Memory is taken from large chunks and is only 
+ * given back when the arena is cleared or destroyed, which releases all PSMs
+ * at once without visiting them; PSMDescription is trivially destructible
+ * for this reason. PSMs that are dropped before that, e.g. when evicted from
+ * a sampled subset, can be released: their slots go to a free list that 
+ * create reuses, and the characters of their ids and peptides go to free 
+ * lists by size that storeString reuses, so that the arena stays at the size
+ * of the PSMs that are kept rather than of all PSMs that passed through it.
+ *
+ * The arena is not thread safe.
+ */
+class PSMArena {
+ public:
+  PSMArena() : current_(NULL), used_(kChunkSize), numPsmSlots_(0u), 
+      numBytes_(0u) {}
+  
+  PSMDescription* create();
+  // gives the PSM and the characters of its id and peptide back for reuse;
+  // the id and peptide have to be stored in this arena, and the features 
+  // are not touched
+  void release(PSMDescription* psm);
+  StringRef storeString(const char* s, size_t length);
+  StringRef storeString(const StringRef& s) { 
+    return storeString(s.data(), s.size()); 
+  }
+  StringRef storeString(const std::string& s) { 
+    return storeString(s.data(), s.size()); 
+  }
+  // copies the id and peptide of the PSM into the arena
+  void storeStrings(PSMDescription* psm) {
+    psm->setId(storeString(psm->getIdRef()));
+    psm->setPeptide(storeString(psm->getFullPeptideRef()));
+  }
+  
+  void clear();
+  
+  // number of PSMs and bytes taken from the chunks, including released ones
+  size_t getNumPsmSlots() const { return numPsmSlots_; }
+  size_t getNumBytes() const { return numBytes_; }
+  
+ private:
+  static const size_t kChunkSize = 1u << 20;
+  // released strings are kept by their length rounded up to a multiple of
+  // kStringGranularity, longer strings than kNumStringClasses - 1 multiples
+  // are not reused
+  static const size_t kStringGranularity = 8u;
+  static const size_t kNumStringClasses = 64u;
+  
+  std::vector<std::unique_ptr<char[]> > chunks_;
+  char* current_;
+  size_t used_;
+  size_t numPsmSlots_, numBytes_;
+  std::vector<PSMDescription*> freePsms_;
+  std::vector<std::vector<char*> > freeStrings_;
+  
+  void* allocate(size_t numBytes, size_t alignment);
+  void releaseString(const StringRef& s);
+  static size_t getStringClass(size_t length) {
+    return (length + kStringGranularity - 1u) / kStringGranularity;
+  }
+  
+  PSMArena(const PSMArena&);
+  PSMArena& operator=(const PSMArena&);
+};
+
+#endif /* PSMARENA_H_ */
@@ -18,29 +18,23 @@
 
 #include <assert.h>
 
+#include <algorithm>
 #include <cmath>
+#include <cstring>
 
 #include "Globals.h"
 
 
-PSMDescription::PSMDescription() : features(NULL), expMass(0.), calcMass(0.), retentionTime_(nan("")), scan(0u), specFileNr(0u), id_(""), peptide("") {
+PSMDescription::PSMDescription() : features(NULL), expMass(0.), calcMass(0.), retentionTime_(nan("")), scan(0u), specFileNr(0u), spectrumId(0u) {
 }
 
-PSMDescription::PSMDescription(const std::string& pep) : features(NULL), expMass(0.), calcMass(0.), retentionTime_(nan("")), scan(0u), specFileNr(0u), id_(""), peptide(pep) {
+PSMDescription::PSMDescription(StringRef pep) : features(NULL), expMass(0.), calcMass(0.), retentionTime_(nan("")), scan(0u), specFileNr(0u), spectrumId(0u), peptide(pep) {
 }
 
-PSMDescription::~PSMDescription() {}
-
 std::string PSMDescription::proteinNameSeparator_ = "\t";
 std::vector<string> PSMDescription::spectraFileNames_(0);
-
-void PSMDescription::deletePtr(PSMDescription* psm) {
-    if (psm != NULL) {
-        psm->deleteRetentionFeatures();
-        delete psm;
-        psm = NULL;
-    }
-}
+SpectrumIdTable PSMDescription::spectrumIds_;
+ProteinNameTable PSMDescription::proteinNames_;
 
 std::string PSMDescription::removePTMs(const string& peptide) {
     std::string peptideSequence = peptide;
@@ -70,12 +64,66 @@ std::string PSMDescription::removePTMs(const string& peptide) {
     return peptide.substr(0, 1) + std::string(".") + peptideSequence + std::string(".") + peptide.substr(peptide.size() - 1, 1);
 }
 
+void PSMDescription::splitProteinList(const StringRef& proteinList,
+                                      std::vector<std::string>& proteinNames) {
+    proteinNames.clear();
+    size_t pos = 0u;
+    StringRef proteinName;
+    while (nextProteinName(proteinList, pos, proteinName)) {
+        proteinNames.push_back(proteinName.str());
+    }
+}
+
+// The names are the non-empty tab separated columns if the separator is a 
+// tab, and else the non-empty parts of the first column between separators.
+bool PSMDescription::nextProteinName(const StringRef& proteinList, 
+                                     size_t& pos, StringRef& proteinName) {
+    const std::string& separator = proteinNameSeparator_;
+    const char* begin = proteinList.data();
+    const char* end = begin + proteinList.size();
+    if (separator != "\t" && pos < proteinList.size()) {
+        const char* tab = static_cast<const char*>(
+            memchr(begin + pos, '\t', proteinList.size() - pos));
+        if (tab != NULL) end = tab;
+    }
+    while (begin + pos < end) {
+        const char* name = begin + pos;
+        const char* nameEnd = separator.empty() ? end : 
+            std::search(name, end, separator.begin(), separator.end());
+        pos = (nameEnd == end) ? static_cast<size_t>(end - begin) :
+            static_cast<size_t>(nameEnd - begin) + separator.size();
+        if (nameEnd > name) {
+            proteinName = StringRef(name, static_cast<size_t>(nameEnd - name));
+            return true;
+        }
+    }
+    return false;
+}
+
+StringRef PSMDescription::getFirstProteinName() const {
+    StringRef proteinName;
+    if (!proteinList_.empty()) {
+        size_t pos = 0u;
+        nextProteinName(proteinList_, pos, proteinName);
+    } else if (!proteinIds_.empty()) {
+        proteinName = StringRef(getProteinName(proteinIds_.front()));
+    }
+    return proteinName;
+}
+
+void PSMDescription::materializeProteins() {
+    std::vector<std::string> proteinNames;
+    splitProteinList(proteinList_, proteinNames);
+    setProteins(proteinNames);
+}
+
 void PSMDescription::printProteins(std::ostream& out) {
-    std::vector<std::string>::const_iterator it = proteinIds.begin();
+    const ProteinIdSpan& proteinIds = getProteinIds();
+    ProteinIdSpan::const_iterator it = proteinIds.begin();
     if (it != proteinIds.end()) {
-        out << *it;
+        out << getProteinName(*it);
         for (++it; it != proteinIds.end(); ++it) {
-            out << PSMDescription::proteinNameSeparator_ << *it;
+            out << PSMDescription::proteinNameSeparator_ << getProteinName(*it);
         }
     }
 }
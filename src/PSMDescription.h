@@ -22,6 +22,10 @@
 #include <vector>
 
 #include "Enzyme.h"
+#include "FeatureMemoryPool.h"
+#include "ProteinNameTable.h"
+#include "SpectrumIdTable.h"
+#include "StringRef.h"
 
 /*
  * PSMDescription
@@ -29,18 +33,26 @@
  * Here are some useful abbreviations:
  * PSM - Peptide Spectrum Match
  *
+ * The id and peptide are views of characters owned elsewhere, normally by
+ * the PSMArena the PSM was created in, so that PSMs are trivially 
+ * destructible and can be released all at once.
+ *
+ * The proteins can be left as a view of the unparsed protein column(s) of 
+ * the input line, which is only split and interned when they are first asked
+ * for by getProteinIds(), see setProteinList().
  */
 class PSMDescription {
    public:
     PSMDescription();
-    PSMDescription(const std::string& peptide);
+    explicit PSMDescription(StringRef peptide);
 
-    virtual ~PSMDescription();
-    static void deletePtr(PSMDescription* psm);
-    virtual void deleteRetentionFeatures() {}
+    void deleteRetentionFeatures() {}
 
-    void clear() { proteinIds.clear(); }
-    double* getFeatures() { return features; }
+    void clear() { 
+        proteinIds_.clear(); 
+        proteinList_ = StringRef();
+    }
+    FeatureType* getFeatures() { return features; }
 
     // TODO: move these static functions somewhere else
     static std::string removePTMs(const std::string& peptideSeq);
@@ -55,7 +67,7 @@ class PSMDescription {
     }
 
     std::string getPeptideSequence() { return peptide.substr(2, peptide.size() - 4); }
-    std::string& getFullPeptideSequence() { return peptide; }
+    std::string getFullPeptideSequence() { return peptide.str(); }
     std::string getFlankN() { return peptide.substr(0, 1); }
     std::string getFlankC() { return peptide.substr(peptide.size() - 1, peptide.size()); }
 
@@ -71,11 +83,14 @@ class PSMDescription {
         return (peptide == other.peptide);
     }
 
-    inline void setId(const std::string& id) { id_ = id; }
-    inline std::string& getId() { return id_; }
+    // the characters have to outlive the PSM, see PSMArena::storeString
+    inline void setId(StringRef id) { id_ = id; }
+    inline std::string getId() const { return id_.str(); }
+    inline const StringRef& getIdRef() const { return id_; }
 
-    std::string& getFullPeptide() { return peptide; }
-    void setPeptide(const std::string& pep_seq) { peptide = pep_seq; }
+    std::string getFullPeptide() const { return peptide.str(); }
+    inline const StringRef& getFullPeptideRef() const { return peptide; }
+    void setPeptide(StringRef pep_seq) { peptide = pep_seq; }
     PSMDescription* getAParent() { return this; }
     void checkFragmentPeptides(
         std::vector<PSMDescription*>::reverse_iterator other,
@@ -88,6 +103,49 @@ class PSMDescription {
     }
     static inline const std::string& getProteinNameSeparator() { return proteinNameSeparator_; }
 
+    // Interns the protein names in the global dictionary and refers to them 
+    // by their ids in proteinIds. Not thread safe.
+    void setProteins(const std::vector<std::string>& proteinNames) {
+        proteinIds_ = proteinNames_.internSpan(proteinNames);
+        proteinList_ = StringRef();
+    }
+    void setProteinIds(const std::vector<unsigned int>& ids) {
+        proteinIds_ = proteinNames_.storeSpan(ids);
+        proteinList_ = StringRef();
+    }
+    // the ids have to outlive the PSM
+    void setProteinIds(const ProteinIdSpan& ids) {
+        proteinIds_ = ids;
+        proteinList_ = StringRef();
+    }
+    // Defers reading the proteins: proteinList holds the protein column(s) of
+    // the input line and has to outlive the PSM.
+    void setProteinList(StringRef proteinList) {
+        proteinIds_.clear();
+        proteinList_ = proteinList;
+    }
+    // Decodes a deferred protein list first, which is not thread safe.
+    inline const ProteinIdSpan& getProteinIds() {
+        if (!proteinList_.empty()) materializeProteins();
+        return proteinIds_;
+    }
+    // Splits the protein column(s) of a line at the protein name separator.
+    static void splitProteinList(const StringRef& proteinList, 
+                                 std::vector<std::string>& proteinNames);
+    // The protein name after pos in a protein list, as splitProteinList
+    // splits it, as a view of the list; returns false after the last one.
+    static bool nextProteinName(const StringRef& proteinList, size_t& pos,
+                                StringRef& proteinName);
+    // The first protein name, without decoding a deferred protein list.
+    StringRef getFirstProteinName() const;
+    static inline unsigned int internProteinName(const std::string& name) {
+        return proteinNames_.intern(name);
+    }
+    static inline const std::string& getProteinName(unsigned int proteinId) {
+        return proteinNames_.getName(proteinId);
+    }
+    static inline size_t getNumProteinNames() { return proteinNames_.size(); }
+
     void setSpectrumFileName(std::string fileName) {
         size_t index(0);
         auto specFilePos = std::find(spectraFileNames_.begin(), spectraFileNames_.end(), fileName);
@@ -107,6 +165,13 @@ class PSMDescription {
     }
     inline bool static hasSpectrumFileName() { return !spectraFileNames_.empty(); }
 
+    // Sets spectrumId to the id shared by all PSMs with the same spectrum 
+    // file, scan and experimental mass. Ids run from 0 to getNumSpectrumIds().
+    void internSpectrumId() {
+        spectrumId = spectrumIds_.intern(specFileNr, scan, expMass);
+    }
+    static inline size_t getNumSpectrumIds() { return spectrumIds_.size(); }
+
     void setRetentionFeatures(double* retentionFeatures) {(void) retentionFeatures; }
     double* getRetentionFeatures() { return NULL; }
 
@@ -118,17 +183,23 @@ class PSMDescription {
     }
     inline double getRetentionTime() const { return retentionTime_; }
 
-    double* features;  // owned by a FeatureMemoryPool instance, no need to delete
+    FeatureType* features;  // owned by a FeatureMemoryPool instance, no need to delete
     double expMass, calcMass, retentionTime_;
     unsigned int scan;
     unsigned int specFileNr;
-    std::vector<std::string> proteinIds;
+    unsigned int spectrumId;
 
    protected:
-    std::string id_;
-    std::string peptide;
+    StringRef id_;
+    StringRef peptide;
+    ProteinIdSpan proteinIds_;  // ids into the protein name dictionary
+    StringRef proteinList_;  // not yet decoded into proteinIds_ if not empty
+    
+    void materializeProteins();
     static std::string proteinNameSeparator_;
+    static ProteinNameTable proteinNames_;
     static vector<std::string> spectraFileNames_;
+    static SpectrumIdTable spectrumIds_;
 };
 
 inline std::ostream& operator<<(std::ostream& out, PSMDescription& psm) {
@@ -0,0 +1,146 @@
+/*******************************************************************************
+ Copyright 2006-2012 Lukas Käll <lukas.kall@scilifelab.se>
+
+ Licensed under the Apache License, Version 2.0 (the "License");
+ you may not use this file except in compliance with the License.
+ You may obtain a copy of the License at
+
+ http://www.apache.org/licenses/LICENSE-2.0
+
+ Unless required by applicable law or agreed to in writing, software
+ distributed under the License is distributed on an "AS IS" BASIS,
+ WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ See the License for the specific language governing permissions and
+ limitations under the License.
+
+ *******************************************************************************/
+#include "PSMSpill.h"
+
+#include <cstring>
+#include <sstream>
+
+#include "MyException.h"
+
+namespace {
+inline size_t alignedSize(size_t numBytes) {
+  return (numBytes + 7u) & ~static_cast<size_t>(7u);
+}
+}
+
+bool PSMSpill::open(size_t numFeatures) {
+  close();
+  file_ = std::tmpfile();
+  numFeatures_ = numFeatures;
+  numPsms_ = 0u;
+  blockBytes_ = 0u;
+  numBlockPsms_ = 0u;
+  return (file_ != NULL);
+}
+
+void PSMSpill::close() {
+  if (file_ != NULL) {
+    std::fclose(file_);
+    file_ = NULL;
+  }
+  std::vector<uint64_t>().swap(block_);
+}
+
+void PSMSpill::add(const PSMDescription& psm, const FeatureType* features,
+    LabelType label, const std::vector<unsigned int>& proteinIds) {
+  const StringRef& id = psm.getIdRef();
+  const StringRef& peptide = psm.getFullPeptideRef();
+  SpillRecord record;
+  record.expMass = psm.expMass;
+  record.calcMass = psm.calcMass;
+  record.retentionTime = psm.getRetentionTime();
+  record.scan = psm.scan;
+  record.specFileNr = psm.specFileNr;
+  record.numProteins = static_cast<uint32_t>(proteinIds.size());
+  record.idSize = static_cast<uint32_t>(id.size());
+  record.peptideSize = static_cast<uint32_t>(peptide.size());
+  record.label = static_cast<int32_t>(label);
+
+  size_t featureBytes = numFeatures_ * sizeof(FeatureType);
+  size_t proteinBytes = proteinIds.size() * sizeof(uint32_t);
+  size_t recordBytes = alignedSize(sizeof(SpillRecord) + featureBytes +
+      proteinBytes + id.size() + peptide.size());
+  block_.resize((blockBytes_ + recordBytes) / sizeof(uint64_t), 0u);
+  char* out = reinterpret_cast<char*>(&block_[0]) + blockBytes_;
+  std::memcpy(out, &record, sizeof(SpillRecord));
+  out += sizeof(SpillRecord);
+  std::memcpy(out, features, featureBytes);
+  out += featureBytes;
+  for (size_t i = 0; i < proteinIds.size(); ++i) {
+    uint32_t proteinId = static_cast<uint32_t>(proteinIds[i]);
+    std::memcpy(out, &proteinId, sizeof(uint32_t));
+    out += sizeof(uint32_t);
+  }
+  std::memcpy(out, id.data(), id.size());
+  out += id.size();
+  std::memcpy(out, peptide.data(), peptide.size());
+
+  blockBytes_ += recordBytes;
+  ++numBlockPsms_;
+  ++numPsms_;
+  if (blockBytes_ >= kBlockSize) flushBlock();
+}
+
+void PSMSpill::flushBlock() {
+  if (numBlockPsms_ == 0u) return;
+  uint64_t blockHeader[2] = { static_cast<uint64_t>(blockBytes_),
+                              numBlockPsms_ };
+  if (std::fwrite(blockHeader, sizeof(blockHeader), 1u, file_) != 1u ||
+      std::fwrite(&block_[0], blockBytes_, 1u, file_) != 1u) {
+    throw MyException("ERROR: Could not write the PSMs to a temporary file, "
+                      "check if there is enough disk space.\n");
+  }
+  blockBytes_ = 0u;
+  numBlockPsms_ = 0u;
+}
+
+void PSMSpill::rewind() {
+  flushBlock();
+  std::fflush(file_);
+  std::rewind(file_);
+}
+
+bool PSMSpill::readBlock(std::vector<Row>& rows) {
+  rows.clear();
+  uint64_t blockHeader[2];
+  if (std::fread(blockHeader, sizeof(blockHeader), 1u, file_) != 1u) {
+    return false;
+  }
+  blockBytes_ = static_cast<size_t>(blockHeader[0]);
+  block_.resize(blockBytes_ / sizeof(uint64_t));
+  if (std::fread(&block_[0], blockBytes_, 1u, file_) != 1u) {
+    throw MyException("ERROR: Could not read the PSMs back from the "
+                      "temporary file.\n");
+  }
+
+  rows.resize(static_cast<size_t>(blockHeader[1]));
+  const char* in = reinterpret_cast<const char*>(&block_[0]);
+  for (size_t i = 0; i < rows.size(); ++i) {
+    const char* recordBegin = in;
+    SpillRecord record;
+    std::memcpy(&record, in, sizeof(SpillRecord));
+    in += sizeof(SpillRecord);
+    Row& row = rows[i];
+    row.label = static_cast<LabelType>(record.label);
+    row.scan = record.scan;
+    row.specFileNr = record.specFileNr;
+    row.numProteins = record.numProteins;
+    row.expMass = record.expMass;
+    row.calcMass = record.calcMass;
+    row.retentionTime = record.retentionTime;
+    row.features = reinterpret_cast<const FeatureType*>(in);
+    in += numFeatures_ * sizeof(FeatureType);
+    row.proteinIds = reinterpret_cast<const uint32_t*>(in);
+    in += record.numProteins * sizeof(uint32_t);
+    row.id = StringRef(in, record.idSize);
+    in += record.idSize;
+    row.peptide = StringRef(in, record.peptideSize);
+    in += record.peptideSize;
+    in = recordBegin + alignedSize(static_cast<size_t>(in - recordBegin));
+  }
+  return true;
+}
@@ -0,0 +1,97 @@
+/*******************************************************************************
+ Copyright 2006-2012 Lukas Käll <lukas.kall@scilifelab.se>
+
+ Licensed under the Apache License, Version 2.0 (the "License");
+ you may not use this file except in compliance with the License.
+ You may obtain a copy of the License at
+
+ http://www.apache.org/licenses/LICENSE-2.0
+
+ Unless required by applicable law or agreed to in writing, software
+ distributed under the License is distributed on an "AS IS" BASIS,
+ WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ See the License for the specific language governing permissions and
+ limitations under the License.
+
+ *******************************************************************************/
+#ifndef PSMSPILL_H_
+#define PSMSPILL_H_
+
+#include <stdint.h>
+#include <cstdio>
+
+#include <string>
+#include <vector>
+
+#include "LabelType.h"
+#include "PSMDescription.h"
+#include "StringRef.h"
+
+/*
+ * PSMSpill is a binary side file holding every PSM read while a training
+ * subset is sampled with -N, so that all PSMs can be scored with the trained
+ * weights without reading the input a second time. This also allows the
+ * input to be a stream that cannot be rewound, like stdin.
+ *
+ * The file is an anonymous temporary file that is deleted when it is closed.
+ * The PSMs are written in blocks of about kBlockSize bytes, each a uint64_t
+ * byte count and a uint64_t PSM count followed by the PSMs. A PSM is a
+ * SpillRecord, its raw feature row as FeatureType, its protein ids into
+ * PSMDescription's protein name dictionary as uint32_t, and the characters
+ * of its id and peptide, padded to an 8 byte boundary.
+ */
+class PSMSpill {
+ public:
+  // a PSM of the block last read, its pointers are valid until the next one
+  struct Row {
+    LabelType label;
+    unsigned int scan, specFileNr, numProteins;
+    double expMass, calcMass, retentionTime;
+    const FeatureType* features;
+    const uint32_t* proteinIds;
+    StringRef id, peptide;
+  };
+
+  PSMSpill() : file_(NULL), numFeatures_(0u), numPsms_(0u),
+               blockBytes_(0u), numBlockPsms_(0u) {}
+  ~PSMSpill() { close(); }
+
+  // Creates the temporary file, returns false if that is not possible.
+  bool open(size_t numFeatures);
+  void close();
+
+  void add(const PSMDescription& psm, const FeatureType* features,
+           LabelType label, const std::vector<unsigned int>& proteinIds);
+
+  // Writes out the pending block and positions the file at its start.
+  void rewind();
+  // Reads the next block into rows, returns false at the end of the file.
+  bool readBlock(std::vector<Row>& rows);
+
+  inline size_t getNumFeatures() const { return numFeatures_; }
+  inline size_t getNumPsms() const { return numPsms_; }
+
+ private:
+  struct SpillRecord {
+    double expMass, calcMass, retentionTime;
+    uint32_t scan, specFileNr, numProteins, idSize, peptideSize;
+    int32_t label;
+  };
+
+  static const size_t kBlockSize = 1u << 24;
+
+  FILE* file_;
+  size_t numFeatures_;
+  size_t numPsms_;
+  // the block being written or the one last read, as uint64_t for alignment
+  std::vector<uint64_t> block_;
+  size_t blockBytes_;
+  uint64_t numBlockPsms_;
+
+  void flushBlock();
+
+  PSMSpill(const PSMSpill&);
+  PSMSpill& operator=(const PSMSpill&);
+};
+
+#endif /* PSMSPILL_H_ */
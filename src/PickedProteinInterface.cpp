@@ -93,7 +93,7 @@ bool PickedProteinInterface::initialize(Scores& peptideScores, const Enzyme* enz
   }
   
   if (max_non_enzymatic_flanks != 2) {
-    for (std::vector<ScoreHolder>::iterator shIt = peptideScores.begin(); 
+    for (Scores::iterator shIt = peptideScores.begin(); 
              shIt != peptideScores.end(); ++shIt) {    
       std::string peptideSequenceFlanked = shIt->pPSM->getFullPeptideSequence();
       
@@ -248,7 +248,7 @@ void PickedProteinInterface::groupProteins(Scores& peptideScores,
   
   std::map<std::string, std::set<std::string> > groupProteinIds;
   unsigned int numGroups = 0;
-  for (vector<ScoreHolder>::iterator peptideIt = peptideScores.begin(); 
+  for (Scores::iterator peptideIt = peptideScores.begin(); 
           peptideIt != peptideScores.end(); ++peptideIt) {
     std::string lastProteinId;
     std::set<std::string> proteinsInGroup;
@@ -256,18 +256,19 @@ void PickedProteinInterface::groupProteins(Scores& peptideScores,
     
     if (peptideIt->p > maxPeptidePval_) continue;
     
-    for (std::vector<std::string>::iterator protIt = peptideIt->pPSM->proteinIds.begin(); 
-            protIt != peptideIt->pPSM->proteinIds.end(); protIt++) {
-      std::string proteinId = *protIt;
+    for (ProteinIdSpan::const_iterator protIt = peptideIt->pPSM->getProteinIds().begin(); 
+            protIt != peptideIt->pPSM->getProteinIds().end(); protIt++) {
+      const std::string& proteinName = PSMDescription::getProteinName(*protIt);
+      std::string proteinId = proteinName;
       
       if (fragment_map.find(proteinId) != fragment_map.end()) {
-        if (reportFragmentProteins_) proteinsInGroup.insert(*protIt);
+        if (reportFragmentProteins_) proteinsInGroup.insert(proteinName);
         proteinId = fragment_map[proteinId];
       } else if (duplicate_map.find(proteinId) != duplicate_map.end()) {
-        if (reportDuplicateProteins_) proteinsInGroup.insert(*protIt);
+        if (reportDuplicateProteins_) proteinsInGroup.insert(proteinName);
         proteinId = duplicate_map[proteinId];
       } else {
-        proteinsInGroup.insert(*protIt);
+        proteinsInGroup.insert(proteinName);
       }
       
       if (isFirst) {
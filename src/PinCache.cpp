@@ -0,0 +1,350 @@
+/*******************************************************************************
+ Copyright 2006-2012 Lukas Käll <lukas.kall@scilifelab.se>
+
+ Licensed under the Apache License, Version 2.0 (the "License");
+ you may not use this file except in compliance with the License.
+ You may obtain a copy of the License at
+
+ http://www.apache.org/licenses/LICENSE-2.0
+
+ Unless required by applicable law or agreed to in writing, software
+ distributed under the License is distributed on an "AS IS" BASIS,
+ WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ See the License for the specific language governing permissions and
+ limitations under the License.
+
+ *******************************************************************************/
+
+#include "PinCache.h"
+
+#include <sys/stat.h>
+
+#include <algorithm>
+#include <cstdio>
+#include <cstring>
+#include <fstream>
+#include <map>
+#include <sstream>
+
+#include "FeatureMemoryPool.h"
+#include "MyException.h"
+
+namespace {
+const char kMagic[8] = { 'P', 'I', 'N', 'C', 'A', 'C', 'H', 'E' };
+const uint32_t kByteOrderMark = 0x01020304u;
+const uint64_t kPageSize = 4096u;
+}
+
+std::string PinCache::getSignature(const std::vector<std::string>& fileNames) {
+  std::ostringstream signature;
+  signature << "separator=" << PSMDescription::getProteinNameSeparator() << '\n';
+  std::vector<std::string>::const_iterator it = fileNames.begin();
+  for ( ; it != fileNames.end(); ++it) {
+    struct stat fileStat;
+    if (stat(it->c_str(), &fileStat) != 0) return "";
+    signature << *it << '\t' << static_cast<uint64_t>(fileStat.st_size)
+              << '\t' << static_cast<int64_t>(fileStat.st_mtime) << '\n';
+  }
+  return signature.str();
+}
+
+uint64_t PinCache::alignStream(std::ostream& out, uint64_t alignment) {
+  uint64_t pos = static_cast<uint64_t>(out.tellp());
+  static const char zeros[kPageSize] = { 0 };
+  if (pos % alignment != 0) {
+    uint64_t padding = alignment - pos % alignment;
+    out.write(zeros, static_cast<std::streamsize>(padding));
+    pos += padding;
+  }
+  return pos;
+}
+
+uint64_t PinCache::StringTableWriter::write(std::ostream& out) const {
+  uint64_t offset = alignStream(out, sizeof(uint64_t));
+  uint64_t count = size();
+  out.write(reinterpret_cast<const char*>(&count), sizeof(count));
+  out.write(reinterpret_cast<const char*>(offsets_.data()),
+            static_cast<std::streamsize>(offsets_.size() * sizeof(uint64_t)));
+  out.write(chars_.data(), static_cast<std::streamsize>(chars_.size()));
+  return offset;
+}
+
+bool PinCache::write(const std::string& fileName, const std::string& signature,
+    const std::vector<std::string>& featureNames,
+    const std::vector<double>& defaultWeights, bool concatenatedSearch,
+    const std::vector<PSMDescription*>& psms,
+    const std::vector<LabelType>& labels) {
+  size_t numFeatures = featureNames.size();
+  size_t rowStride = FeatureMemoryPool::getRowStride(numFeatures);
+  if (numFeatures == 0 || rowStride > FeatureMemoryPool::kBlockSize) {
+    return false;
+  }
+  std::string tmpFileName = fileName + ".tmp";
+  std::ofstream out(tmpFileName.c_str(), std::ios::out | std::ios::binary);
+  if (!out) return false;
+
+  PinCacheHeader header;
+  memset(&header, 0, sizeof(header));
+  memcpy(header.magic, kMagic, sizeof(kMagic));
+  header.version = kVersion;
+  header.byteOrderMark = kByteOrderMark;
+  header.numPsms = psms.size();
+  header.numFeatures = numFeatures;
+  header.blockSize = FeatureMemoryPool::kBlockSize;
+  header.featureSize = sizeof(FeatureType);
+  header.rowStride = rowStride;
+  header.recordSize = sizeof(PinCacheRecord);
+  header.concatenatedSearch = concatenatedSearch ? 1u : 0u;
+  header.numDefaultWeights = defaultWeights.size();
+  out.write(reinterpret_cast<const char*>(&header), sizeof(header));
+
+  StringTableWriter signatureTable, featureNameTable;
+  signatureTable.add(signature);
+  for (size_t i = 0; i < numFeatures; ++i) featureNameTable.add(featureNames[i]);
+  header.signatureOffset = signatureTable.write(out);
+  header.featureNamesOffset = featureNameTable.write(out);
+
+  std::vector<PinCacheRecord> records(psms.size());
+  StringTableWriter fileNameTable, idTable, peptideTable, proteinTable;
+  std::map<std::string, uint32_t> fileNrs;
+  // decode deferred protein lists first, so that all their ids are interned
+  for (size_t i = 0; i < psms.size(); ++i) psms[i]->getProteinIds();
+  // protein name dictionary id -> index in proteinTable
+  const uint32_t kNotWritten = UINT32_MAX;
+  std::vector<uint32_t> proteinIdxs(PSMDescription::getNumProteinNames(), 
+                                    kNotWritten);
+  std::vector<uint32_t> proteinLists;
+  for (size_t i = 0; i < psms.size(); ++i) {
+    PSMDescription* psm = psms[i];
+    PinCacheRecord& record = records[i];
+    record.expMass = psm->expMass;
+    record.calcMass = psm->calcMass;
+    record.retentionTime = psm->getRetentionTime();
+    record.scan = psm->scan;
+    record.specFileNr = 0u;
+    if (PSMDescription::hasSpectrumFileName()) {
+      std::string specFileName = psm->getSpectrumFileName();
+      std::map<std::string, uint32_t>::iterator fileIt = fileNrs.find(specFileName);
+      if (fileIt == fileNrs.end()) {
+        fileIt = fileNrs.insert(std::make_pair(specFileName,
+            static_cast<uint32_t>(fileNameTable.size()))).first;
+        fileNameTable.add(specFileName);
+      }
+      record.specFileNr = fileIt->second;
+    }
+    record.label = static_cast<int32_t>(labels[i]);
+    record.firstProtein = proteinLists.size();
+    record.numProteins = static_cast<uint32_t>(psm->getProteinIds().size());
+    ProteinIdSpan::const_iterator protIt = psm->getProteinIds().begin();
+    for ( ; protIt != psm->getProteinIds().end(); ++protIt) {
+      uint32_t& proteinIdx = proteinIdxs[*protIt];
+      if (proteinIdx == kNotWritten) {
+        proteinIdx = static_cast<uint32_t>(proteinTable.size());
+        proteinTable.add(PSMDescription::getProteinName(*protIt));
+      }
+      proteinLists.push_back(proteinIdx);
+    }
+    idTable.add(psm->getId());
+    peptideTable.add(psm->getFullPeptide());
+  }
+  header.fileNamesOffset = fileNameTable.write(out);
+  header.idsOffset = idTable.write(out);
+  header.peptidesOffset = peptideTable.write(out);
+  header.proteinsOffset = proteinTable.write(out);
+  header.proteinListsOffset = alignStream(out, sizeof(uint64_t));
+  header.numProteinListEntries = proteinLists.size();
+  out.write(reinterpret_cast<const char*>(proteinLists.data()),
+      static_cast<std::streamsize>(proteinLists.size() * sizeof(uint32_t)));
+
+  header.defaultWeightsOffset = alignStream(out, sizeof(uint64_t));
+  out.write(reinterpret_cast<const char*>(defaultWeights.data()),
+      static_cast<std::streamsize>(defaultWeights.size() * sizeof(double)));
+  header.recordsOffset = alignStream(out, sizeof(uint64_t));
+  out.write(reinterpret_cast<const char*>(records.data()),
+      static_cast<std::streamsize>(records.size() * sizeof(PinCacheRecord)));
+
+  // the last block is written in full, so that the pool can keep allocating
+  // rows from it after adopting the blocks
+  header.featuresOffset = alignStream(out, kPageSize);
+  size_t rowsPerBlock = FeatureMemoryPool::kBlockSize / rowStride;
+  std::vector<FeatureType> block(FeatureMemoryPool::kBlockSize);
+  for (size_t blockStart = 0; blockStart < psms.size(); blockStart += rowsPerBlock) {
+    std::fill(block.begin(), block.end(), FeatureType(0));
+    size_t blockEnd = std::min(psms.size(), blockStart + rowsPerBlock);
+    for (size_t i = blockStart; i < blockEnd; ++i) {
+      std::copy(psms[i]->features, psms[i]->features + numFeatures,
+                block.begin() + (i - blockStart) * rowStride);
+    }
+    out.write(reinterpret_cast<const char*>(block.data()),
+        static_cast<std::streamsize>(block.size() * sizeof(FeatureType)));
+  }
+  header.fileSize = static_cast<uint64_t>(out.tellp());
+
+  out.seekp(0);
+  out.write(reinterpret_cast<const char*>(&header), sizeof(header));
+  out.close();
+  if (!out || std::rename(tmpFileName.c_str(), fileName.c_str()) != 0) {
+    std::remove(tmpFileName.c_str());
+    return false;
+  }
+  return true;
+}
+
+bool PinCache::open(const std::string& fileName, const std::string& signature) {
+  header_ = NULL;
+  if (!mappedFile_.open(fileName, true)) return false;
+  if (mappedFile_.size() < sizeof(PinCacheHeader)) return false;
+
+  const PinCacheHeader* header =
+      reinterpret_cast<const PinCacheHeader*>(mappedFile_.data());
+  size_t numBlocks = 0;
+  if (header->rowStride > 0 && header->rowStride <= header->blockSize) {
+    size_t rowsPerBlock = header->blockSize / header->rowStride;
+    numBlocks = (header->numPsms + rowsPerBlock - 1) / rowsPerBlock;
+  }
+  if (memcmp(header->magic, kMagic, sizeof(kMagic)) != 0 ||
+      header->version != kVersion ||
+      header->byteOrderMark != kByteOrderMark ||
+      header->fileSize != mappedFile_.size() ||
+      header->blockSize != FeatureMemoryPool::kBlockSize ||
+      header->featureSize != sizeof(FeatureType) ||
+      header->rowStride != FeatureMemoryPool::getRowStride(header->numFeatures) ||
+      header->recordSize != sizeof(PinCacheRecord) ||
+      header->numFeatures == 0 ||
+      header->recordsOffset + header->numPsms * sizeof(PinCacheRecord) >
+          header->featuresOffset ||
+      header->defaultWeightsOffset + header->numDefaultWeights * sizeof(double) >
+          header->recordsOffset ||
+      header->proteinListsOffset % sizeof(uint32_t) != 0 ||
+      header->proteinListsOffset + 
+          header->numProteinListEntries * sizeof(uint32_t) >
+          header->defaultWeightsOffset ||
+      header->featuresOffset % kPageSize != 0 ||
+      header->featuresOffset + 
+          numBlocks * header->blockSize * sizeof(FeatureType) >
+          header->fileSize) {
+    mappedFile_.close();
+    return false;
+  }
+  header_ = header;
+  if (!isValidStringTable(header->signatureOffset) ||
+      !isValidStringTable(header->featureNamesOffset) ||
+      !isValidStringTable(header->fileNamesOffset) ||
+      !isValidStringTable(header->idsOffset) ||
+      !isValidStringTable(header->peptidesOffset) ||
+      !isValidStringTable(header->proteinsOffset) ||
+      getNumStrings(header->featureNamesOffset) != header->numFeatures ||
+      getNumStrings(header->idsOffset) != header->numPsms ||
+      getNumStrings(header->peptidesOffset) != header->numPsms ||
+      getNumStrings(header->signatureOffset) != 1u ||
+      getString(header->signatureOffset, 0u) != signature) {
+    header_ = NULL;
+    mappedFile_.close();
+    return false;
+  }
+  
+  // translate the protein lists in place to ids of the protein name 
+  // dictionary, the mapping is private so the file itself stays unchanged
+  uint64_t numProteins = getNumStrings(header->proteinsOffset);
+  std::vector<unsigned int> proteinIds(numProteins);
+  for (uint64_t i = 0; i < numProteins; ++i) {
+    proteinIds[i] = PSMDescription::internProteinName(
+        getString(header->proteinsOffset, i));
+  }
+  uint32_t* proteinLists = getProteinLists();
+  for (uint64_t i = 0; i < header->numProteinListEntries; ++i) {
+    if (proteinLists[i] >= numProteins) {
+      header_ = NULL;
+      mappedFile_.close();
+      return false;
+    }
+    proteinLists[i] = proteinIds[proteinLists[i]];
+  }
+  return true;
+}
+
+bool PinCache::isValidStringTable(uint64_t offset) const {
+  uint64_t size = mappedFile_.size();
+  if (offset % sizeof(uint64_t) != 0 || offset + sizeof(uint64_t) > size) {
+    return false;
+  }
+  uint64_t count = getNumStrings(offset);
+  uint64_t charsOffset = offset + (count + 2u) * sizeof(uint64_t);
+  if (count > size || charsOffset > size) return false;
+  const uint64_t* offsets = reinterpret_cast<const uint64_t*>(
+      mappedFile_.data() + offset) + 1;
+  return offsets[count] <= size - charsOffset;
+}
+
+uint64_t PinCache::getNumStrings(uint64_t tableOffset) const {
+  return *reinterpret_cast<const uint64_t*>(mappedFile_.data() + tableOffset);
+}
+
+StringRef PinCache::getStringRef(uint64_t tableOffset, uint64_t idx) const {
+  const uint64_t* offsets = reinterpret_cast<const uint64_t*>(
+      mappedFile_.data() + tableOffset) + 1;
+  const char* chars = reinterpret_cast<const char*>(
+      offsets + getNumStrings(tableOffset) + 1u);
+  return StringRef(chars + offsets[idx], 
+                   static_cast<size_t>(offsets[idx + 1u] - offsets[idx]));
+}
+
+size_t PinCache::getNumPsms() const {
+  return static_cast<size_t>(header_->numPsms);
+}
+
+size_t PinCache::getNumFeatures() const {
+  return static_cast<size_t>(header_->numFeatures);
+}
+
+bool PinCache::concatenatedSearch() const {
+  return header_->concatenatedSearch != 0u;
+}
+
+void PinCache::getFeatureNames(std::vector<std::string>& featureNames) const {
+  featureNames.clear();
+  for (uint64_t i = 0; i < header_->numFeatures; ++i) {
+    featureNames.push_back(getString(header_->featureNamesOffset, i));
+  }
+}
+
+void PinCache::getDefaultWeights(std::vector<double>& defaultWeights) const {
+  const double* weights = reinterpret_cast<const double*>(
+      mappedFile_.data() + header_->defaultWeightsOffset);
+  defaultWeights.assign(weights, weights + header_->numDefaultWeights);
+}
+
+void PinCache::getSpectrumFileNames(std::vector<std::string>& fileNames) const {
+  fileNames.clear();
+  uint64_t numFileNames = getNumStrings(header_->fileNamesOffset);
+  for (uint64_t i = 0; i < numFileNames; ++i) {
+    fileNames.push_back(getString(header_->fileNamesOffset, i));
+  }
+}
+
+LabelType PinCache::readPsm(size_t psmIdx, PSMArena& psmArena,
+                            PSMDescription*& psm) const {
+  const PinCacheRecord& record = getRecords()[psmIdx];
+  psm = psmArena.create();
+  psm->setPeptide(getStringRef(header_->peptidesOffset, psmIdx));
+  psm->setId(getStringRef(header_->idsOffset, psmIdx));
+  psm->expMass = record.expMass;
+  psm->calcMass = record.calcMass;
+  psm->setRetentionTime(record.retentionTime);
+  psm->scan = record.scan;
+  psm->specFileNr = record.specFileNr;
+  if (record.firstProtein + record.numProteins > 
+      header_->numProteinListEntries) {
+    std::ostringstream temp;
+    temp << "ERROR: Reading pin cache, protein index of PSM "
+         << psm->getId() << " is out of range." << std::endl;
+    throw MyException(temp.str());
+  }
+  psm->setProteinIds(ProteinIdSpan(
+      getProteinLists() + record.firstProtein, record.numProteins));
+  return static_cast<LabelType>(record.label);
+}
+
+FeatureType* PinCache::getFeatureBlocks() {
+  return reinterpret_cast<FeatureType*>(mappedFile_.data() + header_->featuresOffset);
+}
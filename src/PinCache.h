@@ -0,0 +1,156 @@
+/*******************************************************************************
+ Copyright 2006-2012 Lukas Käll <lukas.kall@scilifelab.se>
+
+ Licensed under the Apache License, Version 2.0 (the "License");
+ you may not use this file except in compliance with the License.
+ You may obtain a copy of the License at
+
+ http://www.apache.org/licenses/LICENSE-2.0
+
+ Unless required by applicable law or agreed to in writing, software
+ distributed under the License is distributed on an "AS IS" BASIS,
+ WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ See the License for the specific language governing permissions and
+ limitations under the License.
+
+ *******************************************************************************/
+#ifndef PINCACHE_H_
+#define PINCACHE_H_
+
+#include <stdint.h>
+
+#include <iostream>
+#include <string>
+#include <vector>
+
+#include "LabelType.h"
+#include "MemoryMappedFile.h"
+#include "PSMArena.h"
+#include "PSMDescription.h"
+#include "StringRef.h"
+
+/*
+ * PinCache is a binary container for the PSMs of one or more pin files,
+ * written by SetHandler after parsing the text input, so that later runs on
+ * the same input can map it into memory instead of parsing it again.
+ *
+ * The file is laid out in native byte order, with each section starting at
+ * an 8 byte boundary:
+ *   PinCacheHeader
+ *   string tables for the input signature, feature names, spectrum file
+ *     names, PSM ids, peptides and the distinct protein names
+ *   the protein lists of the PSMs, as uint32_t indices into the protein names
+ *   the default weights as doubles
+ *   one PinCacheRecord per PSM
+ *   the feature rows, starting at a page boundary and laid out in the blocks
+ *     of a FeatureMemoryPool, so that they can be adopted by the pool as is
+ * A string table is a uint64_t count n, followed by n+1 uint64_t offsets into
+ * the concatenated characters that come after them.
+ */
+class PinCache {
+ public:
+  static const uint32_t kVersion = 4u;
+
+  PinCache() : header_(NULL) {}
+
+  // Identifies the input the cache was made from by the names, sizes and
+  // modification times of the files and the protein name separator. Returns
+  // an empty string if one of the files cannot be accessed.
+  static std::string getSignature(const std::vector<std::string>& fileNames);
+
+  static bool write(const std::string& fileName, const std::string& signature,
+    const std::vector<std::string>& featureNames,
+    const std::vector<double>& defaultWeights, bool concatenatedSearch,
+    const std::vector<PSMDescription*>& psms,
+    const std::vector<LabelType>& labels);
+
+  // Maps the cache file, returns false if it does not exist, is damaged,
+  // or was made from other input than the given signature. The protein names
+  // are interned in PSMDescription's protein name dictionary.
+  bool open(const std::string& fileName, const std::string& signature);
+
+  size_t getNumPsms() const;
+  size_t getNumFeatures() const;
+  bool concatenatedSearch() const;
+  void getFeatureNames(std::vector<std::string>& featureNames) const;
+  void getDefaultWeights(std::vector<double>& defaultWeights) const;
+  void getSpectrumFileNames(std::vector<std::string>& fileNames) const;
+
+  // Creates the PSM of the given record in psmArena, without features. Its
+  // specFileNr indexes the names of getSpectrumFileNames(), its id, peptide
+  // and protein ids refer to the mapped file, which has to outlive the PSM.
+  LabelType readPsm(size_t psmIdx, PSMArena& psmArena, 
+                    PSMDescription*& psm) const;
+
+  // start of the feature blocks, writable without changing the file
+  FeatureType* getFeatureBlocks();
+
+ private:
+  struct PinCacheHeader {
+    char magic[8];
+    uint32_t version;
+    uint32_t byteOrderMark;
+    uint64_t fileSize;
+    uint64_t numPsms;
+    uint64_t numFeatures;
+    uint64_t blockSize; // in number of features
+    uint64_t featureSize; // sizeof(FeatureType) of the writing build
+    uint64_t rowStride; // in number of features
+    uint64_t recordSize;
+    uint64_t concatenatedSearch;
+    uint64_t numDefaultWeights;
+    uint64_t signatureOffset, featureNamesOffset, fileNamesOffset;
+    uint64_t idsOffset, peptidesOffset, proteinsOffset;
+    uint64_t proteinListsOffset, numProteinListEntries;
+    uint64_t defaultWeightsOffset, recordsOffset, featuresOffset;
+  };
+
+  struct PinCacheRecord {
+    double expMass, calcMass, retentionTime;
+    uint64_t firstProtein; // index into the protein lists
+    uint32_t scan, specFileNr, numProteins;
+    int32_t label;
+  };
+
+  class StringTableWriter {
+   public:
+    StringTableWriter() : offsets_(1, 0u) {}
+    void add(const std::string& s) {
+      chars_.append(s);
+      offsets_.push_back(chars_.size());
+    }
+    inline uint64_t size() const { return offsets_.size() - 1u; }
+    uint64_t write(std::ostream& out) const;
+   private:
+    std::vector<uint64_t> offsets_;
+    std::string chars_;
+  };
+
+  MemoryMappedFile mappedFile_;
+  const PinCacheHeader* header_;
+
+  static uint64_t alignStream(std::ostream& out, uint64_t alignment);
+  bool isValidStringTable(uint64_t offset) const;
+  uint64_t getNumStrings(uint64_t tableOffset) const;
+  StringRef getStringRef(uint64_t tableOffset, uint64_t idx) const;
+  inline std::string getString(uint64_t tableOffset, uint64_t idx) const {
+    return getStringRef(tableOffset, idx).str();
+  }
+  inline uint32_t* getProteinLists() {
+    return reinterpret_cast<uint32_t*>(
+        mappedFile_.data() + header_->proteinListsOffset);
+  }
+  inline const uint32_t* getProteinLists() const {
+    return reinterpret_cast<const uint32_t*>(
+        mappedFile_.data() + header_->proteinListsOffset);
+  }
+  inline const PinCacheRecord* getRecords() const {
+    return reinterpret_cast<const PinCacheRecord*>(
+        mappedFile_.data() + header_->recordsOffset);
+  }
+
+  PinCache(const PinCache&);
+  PinCache& operator=(const PinCache&);
+};
+
+#endif /* PINCACHE_H_ */
@@ -0,0 +1,62 @@
+/*******************************************************************************
+ Copyright 2006-2012 Lukas Käll <lukas.kall@scilifelab.se>
+
+ Licensed under the Apache License, Version 2.0 (the "License");
+ you may not use this file except in compliance with the License.
+ You may obtain a copy of the License at
+
+ http://www.apache.org/licenses/LICENSE-2.0
+
+ Unless required by applicable law or agreed to in writing, software
+ distributed under the License is distributed on an "AS IS" BASIS,
+ WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ See the License for the specific language governing permissions and
+ limitations under the License.
+
+ *******************************************************************************/
+
+#include "ProteinNameTable.h"
+
+#include <algorithm>
+
+unsigned int ProteinNameTable::intern(const std::string& name) {
+  std::pair<boost::unordered_map<std::string, unsigned int>::iterator, bool> 
+      inserted = ids_.emplace(name, static_cast<unsigned int>(names_.size()));
+  if (inserted.second) names_.push_back(&inserted.first->first);
+  return inserted.first->second;
+}
+
+unsigned int* ProteinNameTable::allocate(size_t numIds) {
+  if (numIds > kChunkSize / 4u) {
+    // long lists get an allocation of their own, so that the current chunk 
+    // stays in use
+    chunks_.push_back(std::unique_ptr<unsigned int[]>(new unsigned int[numIds]));
+    return chunks_.back().get();
+  }
+  if (chunkUsed_ + numIds > kChunkSize) {
+    chunks_.push_back(std::unique_ptr<unsigned int[]>(
+        new unsigned int[kChunkSize]));
+    currentChunk_ = chunks_.back().get();
+    chunkUsed_ = 0u;
+  }
+  unsigned int* ids = currentChunk_ + chunkUsed_;
+  chunkUsed_ += numIds;
+  return ids;
+}
+
+ProteinIdSpan ProteinNameTable::internSpan(
+    const std::vector<std::string>& names) {
+  if (names.empty()) return ProteinIdSpan();
+  unsigned int* ids = allocate(names.size());
+  for (size_t i = 0; i < names.size(); ++i) {
+    ids[i] = intern(names[i]);
+  }
+  return ProteinIdSpan(ids, static_cast<unsigned int>(names.size()));
+}
+
+ProteinIdSpan ProteinNameTable::storeSpan(const std::vector<unsigned int>& ids) {
+  if (ids.empty()) return ProteinIdSpan();
+  unsigned int* storedIds = allocate(ids.size());
+  std::copy(ids.begin(), ids.end(), storedIds);
+  return ProteinIdSpan(storedIds, static_cast<unsigned int>(ids.size()));
+}
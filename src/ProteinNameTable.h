@@ -0,0 +1,93 @@
+/*******************************************************************************
+ Copyright 2006-2012 Lukas Käll <lukas.kall@scilifelab.se>
+
+ Licensed under the Apache License, Version 2.0 (the "License");
+ you may not use this file except in compliance with the License.
+ You may obtain a copy of the License at
+
+ http://www.apache.org/licenses/LICENSE-2.0
+
+ Unless required by applicable law or agreed to in writing, software
+ distributed under the License is distributed on an "AS IS" BASIS,
+ WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ See the License for the specific language governing permissions and
+ limitations under the License.
+
+ *******************************************************************************/
+#ifndef PROTEINNAMETABLE_H_
+#define PROTEINNAMETABLE_H_
+
+#include <cstddef>
+#include <memory>
+#include <string>
+#include <vector>
+
+#include <boost/unordered/unordered_map.hpp>
+
+/*
+ * ProteinIdSpan refers to the ids of the proteins of a PSM, which are stored
+ * contiguously by a ProteinNameTable.
+ */
+class ProteinIdSpan {
+ public:
+  typedef const unsigned int* const_iterator;
+  
+  ProteinIdSpan() : ids_(NULL), size_(0u) {}
+  ProteinIdSpan(const unsigned int* ids, unsigned int size) 
+      : ids_(ids), size_(size) {}
+  
+  inline const_iterator begin() const { return ids_; }
+  inline const_iterator end() const { return ids_ + size_; }
+  inline size_t size() const { return size_; }
+  inline bool empty() const { return size_ == 0u; }
+  inline unsigned int operator[](size_t idx) const { return ids_[idx]; }
+  inline unsigned int front() const { return ids_[0]; }
+  inline unsigned int back() const { return ids_[size_ - 1u]; }
+  void clear() { ids_ = NULL; size_ = 0u; }
+  
+ private:
+  const unsigned int* ids_;
+  unsigned int size_;
+};
+
+/*
+ * ProteinNameTable is a dictionary of protein names, which interns each 
+ * distinct name once and hands out dense 32-bit ids in order of first 
+ * appearance. It also owns the id lists of the PSMs, which are allocated 
+ * from large chunks that are only released with the table, as PSMs usually 
+ * live as long as the table does.
+ *
+ * The table is not thread safe, names should be interned while registering
+ * the PSMs in input order, which also keeps the ids deterministic.
+ */
+class ProteinNameTable {
+ public:
+  ProteinNameTable() : currentChunk_(NULL), chunkUsed_(kChunkSize) {}
+  
+  unsigned int intern(const std::string& name);
+  inline const std::string& getName(unsigned int id) const { 
+    return *names_[id]; 
+  }
+  inline size_t size() const { return names_.size(); }
+  
+  // Interns the names and stores their ids as a span
+  ProteinIdSpan internSpan(const std::vector<std::string>& names);
+  // Stores ids that were already interned as a span
+  ProteinIdSpan storeSpan(const std::vector<unsigned int>& ids);
+  
+ private:
+  static const size_t kChunkSize = 1u << 16;
+  
+  boost::unordered_map<std::string, unsigned int> ids_;
+  std::vector<const std::string*> names_; // keys of ids_, which do not move
+  std::vector<std::unique_ptr<unsigned int[]> > chunks_;
+  unsigned int* currentChunk_;
+  size_t chunkUsed_;
+  
+  unsigned int* allocate(size_t numIds);
+  
+  ProteinNameTable(const ProteinNameTable&);
+  ProteinNameTable& operator=(const ProteinNameTable&);
+};
+
+#endif /* PROTEINNAMETABLE_H_ */
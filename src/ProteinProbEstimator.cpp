@@ -17,6 +17,14 @@
 
 #include "ProteinProbEstimator.h"
 
+#include <limits>
+
+namespace {
+// markers in the caches of proteins_ indices per protein name id
+const size_t kUnknownProteinIdx = std::numeric_limits<size_t>::max();
+const size_t kMissingProteinIdx = kUnknownProteinIdx - 1u;
+}
+
 const double ProteinProbEstimator::target_decoy_ratio = 1.0;
 const double ProteinProbEstimator::psmThresholdMayu = 0.90;
 const double ProteinProbEstimator::prior_protein = 0.5;
@@ -307,30 +315,48 @@ void ProteinProbEstimator::estimateQValuesEmp() {
 void ProteinProbEstimator::setTargetandDecoysNames(Scores& peptideScores) {
   int numGroups = 0;
   bool decoyFound = false;
-  std::vector<ScoreHolder>::iterator psm = peptideScores.begin();
+  // index into proteins_ per protein name id, so that each protein name is 
+  // looked up in proteinToIdxMap_ only once
+  std::vector<size_t> proteinIdxs(PSMDescription::getNumProteinNames(), 
+                                  kUnknownProteinIdx);
+  Scores::iterator psm = peptideScores.begin();
   for (; psm!= peptideScores.end(); ++psm) {
-    // for each protein
-    std::vector<std::string>::iterator protIt = psm->pPSM->proteinIds.begin();
-    for (; protIt != psm->pPSM->proteinIds.end(); protIt++) {
+    // for each protein, the names of deferred protein lists are only 
+    // interned here
+    const ProteinIdSpan& proteinIds = psm->pPSM->getProteinIds();
+    if (proteinIdxs.size() < PSMDescription::getNumProteinNames()) {
+      proteinIdxs.resize(PSMDescription::getNumProteinNames(), 
+                         kUnknownProteinIdx);
+    }
+    ProteinIdSpan::const_iterator protIt = proteinIds.begin();
+    for (; protIt != proteinIds.end(); protIt++) {
+      const std::string& proteinName = PSMDescription::getProteinName(*protIt);
       ProteinScoreHolder::Peptide peptide(psm->pPSM->getPeptideSequence(), 
           psm->isDecoy(), psm->p, psm->pep, psm->q, psm->score);
-      if (proteinToIdxMap_.find(*protIt) == proteinToIdxMap_.end()) {
-	      ProteinScoreHolder newProtein(*protIt, psm->isDecoy(), peptide, ++numGroups);
-	      proteinToIdxMap_[*protIt] = proteins_.size();
+      size_t& proteinIdx = proteinIdxs[*protIt];
+      if (proteinIdx == kUnknownProteinIdx) {
+        std::map<std::string, size_t>::const_iterator idxIt = 
+            proteinToIdxMap_.find(proteinName);
+        if (idxIt != proteinToIdxMap_.end()) proteinIdx = idxIt->second;
+      }
+      if (proteinIdx == kUnknownProteinIdx) {
+	      ProteinScoreHolder newProtein(proteinName, psm->isDecoy(), peptide, ++numGroups);
+	      proteinIdx = proteins_.size();
+	      proteinToIdxMap_[proteinName] = proteinIdx;
 	      proteins_.push_back(newProtein);
 	      
 	      if (!useDecoyPrefix) {
 	        if (psm->isDecoy()) {
-	          falsePosSet_.insert(*protIt);
+	          falsePosSet_.insert(proteinName);
 	          decoyFound = true;
 	        } else {
-	          truePosSet_.insert(*protIt);
+	          truePosSet_.insert(proteinName);
 	        }
-	      } else if (isDecoy(*protIt)) {
+	      } else if (isDecoy(proteinName)) {
 	        decoyFound = true;
 	      }
       } else {
-      	proteins_.at(proteinToIdxMap_[*protIt]).addPeptide(peptide);
+      	proteins_.at(proteinIdx).addPeptide(peptide);
       }
     }
   }
@@ -349,17 +375,29 @@ void ProteinProbEstimator::setTargetandDecoysNames(Scores& peptideScores) {
 }
 
 void ProteinProbEstimator::addSpectralCounts(Scores& peptideScores) {
-  std::vector<ScoreHolder>::iterator psm = peptideScores.begin();
+  // index into proteins_ per protein name id, as in setTargetandDecoysNames
+  std::vector<size_t> proteinIdxs(PSMDescription::getNumProteinNames(), 
+                                  kUnknownProteinIdx);
+  Scores::iterator psm = peptideScores.begin();
   for (; psm!= peptideScores.end(); ++psm) {
     // for each protein
-    std::vector<std::string>::const_iterator protIt = psm->pPSM->proteinIds.begin();
+    const ProteinIdSpan& proteinIds = psm->pPSM->getProteinIds();
+    if (proteinIdxs.size() < PSMDescription::getNumProteinNames()) {
+      proteinIdxs.resize(PSMDescription::getNumProteinNames(), 
+                         kUnknownProteinIdx);
+    }
+    ProteinIdSpan::const_iterator protIt = proteinIds.begin();
     std::set<unsigned int> seenProteinIdxs;
-    for (; protIt != psm->pPSM->proteinIds.end(); protIt++) {
-      if (proteinToIdxMap_.find(*protIt) != proteinToIdxMap_.end()) {
-        unsigned int proteinIdx = static_cast<unsigned int>(proteinToIdxMap_[*protIt]);
-        if (seenProteinIdxs.find(proteinIdx) == seenProteinIdxs.end()) {
-          seenProteinIdxs.insert(proteinIdx);
-        }
+    for (; protIt != proteinIds.end(); protIt++) {
+      size_t& proteinIdx = proteinIdxs[*protIt];
+      if (proteinIdx == kUnknownProteinIdx) {
+        std::map<std::string, size_t>::const_iterator idxIt = 
+            proteinToIdxMap_.find(PSMDescription::getProteinName(*protIt));
+        proteinIdx = (idxIt != proteinToIdxMap_.end()) ? 
+            idxIt->second : kMissingProteinIdx;
+      }
+      if (proteinIdx != kMissingProteinIdx) {
+        seenProteinIdxs.insert(static_cast<unsigned int>(proteinIdx));
       }
     }
     
@@ -30,6 +30,8 @@
 class PseudoRandom {
  public:
   inline static void setSeed(unsigned long s) { seed_ = s; }
+  // the current state, without drawing a number
+  inline static uint64_t getSeed() { return seed_; }
   static unsigned long lcg_rand();
   static double lcg_uniform_rand();
   const static uint64_t kRandMax = 4294967291u;
@@ -88,9 +88,10 @@ void ScoreHolder::printPSM(ostream& os, bool printDecoys, bool printExpMass) {
          << centpep << "\"/>" << endl;
     }
 
-    std::vector<std::string>::const_iterator pidIt = pPSM->proteinIds.begin();
-    for (; pidIt != pPSM->proteinIds.end(); ++pidIt) {
-      os << "      <protein_id>" << getRidOfUnprintablesAndUnicode(*pidIt)
+    ProteinIdSpan::const_iterator pidIt = pPSM->getProteinIds().begin();
+    for (; pidIt != pPSM->getProteinIds().end(); ++pidIt) {
+      os << "      <protein_id>" << getRidOfUnprintablesAndUnicode(
+             PSMDescription::getProteinName(*pidIt))
          << "</protein_id>" << endl;
     }
 
@@ -124,9 +125,10 @@ void ScoreHolder::printPeptide(ostream& os,
     os << "      <calc_mass>" << fixed << std::setprecision(3) << pPSM->calcMass
        << "</calc_mass>" << endl;
 
-    std::vector<std::string>::const_iterator pidIt = pPSM->proteinIds.begin();
-    for (; pidIt != pPSM->proteinIds.end(); ++pidIt) {
-      os << "      <protein_id>" << getRidOfUnprintablesAndUnicode(*pidIt)
+    ProteinIdSpan::const_iterator pidIt = pPSM->getProteinIds().begin();
+    for (; pidIt != pPSM->getProteinIds().end(); ++pidIt) {
+      os << "      <protein_id>" << getRidOfUnprintablesAndUnicode(
+             PSMDescription::getProteinName(*pidIt))
          << "</protein_id>" << endl;
     }
 
@@ -186,20 +188,22 @@ void ScoreHolder::printPepXML(ostream& os,
   int hit_rank = 1;
   int massdiff = 1;
   /* num_tot_proteins */
-  int num_tot_proteins = pPSM->proteinIds.size();
+  int num_tot_proteins = pPSM->getProteinIds().size();
 
-  std::vector<std::string>::const_iterator pidIt = pPSM->proteinIds.begin();
-  for (; pidIt != pPSM->proteinIds.end(); ++pidIt) {
+  ProteinIdSpan::const_iterator pidIt = pPSM->getProteinIds().begin();
+  for (; pidIt != pPSM->getProteinIds().end(); ++pidIt) {
     if (n_protein == 0) {
       /*  set calc_neutral_pep_mass  as calcMass as placeholder for now */
       os << "                <search_hit calc_neutral_pep_mass=\"" << calcMass
          << "\" num_tot_proteins=\"" << num_tot_proteins << "\" hit_rank=\""
          << hit_rank << "\" massdiff=\"" << massdiff << "\" peptide=\""
          << peptide_sequence << "\" protein=\""
-         << getRidOfUnprintablesAndUnicode(*pidIt) << "\">" << endl;
+         << getRidOfUnprintablesAndUnicode(
+             PSMDescription::getProteinName(*pidIt)) << "\">" << endl;
     } else {
       os << "                    <alternative_protein protein=\""
-         << getRidOfUnprintablesAndUnicode(*pidIt) << "\"/>" << endl;
+         << getRidOfUnprintablesAndUnicode(
+             PSMDescription::getProteinName(*pidIt)) << "\"/>" << endl;
     }
     n_protein++;
   }
@@ -245,4 +249,22 @@ void ScoreHolder::printPepXML(ostream& os,
   os << "                </search_hit>" << endl;
   os << "            </search_result>" << endl;
   os << "        </spectrum_query>" << endl;
-}
\ No newline at end of file
+}
+void ScoreHolderRef::printPSM(ostream& os, bool printDecoys,
+                              bool printExpMass) const {
+  static_cast<ScoreHolder>(*this).printPSM(os, printDecoys, printExpMass);
+}
+
+void ScoreHolderRef::printPepXML(ostream& os,
+                                 map<char, float>& aaWeight,
+                                 int index) const {
+  static_cast<ScoreHolder>(*this).printPepXML(os, aaWeight, index);
+}
+
+void ScoreHolderRef::printPeptide(ostream& os,
+                                  bool printDecoys,
+                                  bool printExpMass,
+                                  Scores& fullset) const {
+  static_cast<ScoreHolder>(*this).printPeptide(os, printDecoys, printExpMass,
+                                               fullset);
+}
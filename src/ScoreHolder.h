@@ -46,7 +46,6 @@ class ScoreHolder {
         pPSM(NULL) {}
   ScoreHolder(const double s, const LabelType l, PSMDescription* psm = NULL)
       : score(s), q(0.0), pep(0.0), p(0.0), label(l), pPSM(psm) {}
-  virtual ~ScoreHolder() {}
 
   std::pair<double, bool> toPair() const {
     return pair<double, bool>(score, isTarget());
@@ -65,21 +64,79 @@ class ScoreHolder {
                     Scores& fullset);
   std::string getCharge(std::string id);
 };
+
+/*
+ * ScoreHolderRef is a lightweight proxy for a PSM that is stored in the
+ * columns of a Scores. Its members refer to the score, q, pep, p, PSM and
+ * label of the PSM in those columns, so that the output code can read and
+ * update the PSMs of a Scores through the ScoreHolder interface. Assigning to
+ * a ScoreHolderRef writes through to the columns.
+ */
+class ScoreHolderRef {
+ public:
+  double &score, &q, &pep, &p;
+  PSMDescription*& pPSM;
+  LabelType& label;
+
+  ScoreHolderRef(double& s, double& qv, double& pe, double& pv,
+                 PSMDescription*& psm, LabelType& l)
+      : score(s), q(qv), pep(pe), p(pv), pPSM(psm), label(l) {}
+  ScoreHolderRef(const ScoreHolderRef& other) = default;
+
+  ScoreHolderRef& operator=(const ScoreHolderRef& other) {
+    return *this = static_cast<ScoreHolder>(other);
+  }
+  ScoreHolderRef& operator=(const ScoreHolder& sh) {
+    score = sh.score;
+    q = sh.q;
+    pep = sh.pep;
+    p = sh.p;
+    pPSM = sh.pPSM;
+    label = sh.label;
+    return *this;
+  }
+  operator ScoreHolder() const {
+    ScoreHolder sh(score, label, pPSM);
+    sh.q = q;
+    sh.pep = pep;
+    sh.p = p;
+    return sh;
+  }
+
+  std::pair<double, bool> toPair() const {
+    return pair<double, bool>(score, isTarget());
+  }
+
+  inline bool isTarget() const {
+    return label == LabelType::TARGET || label == LabelType::PSEUDO_TARGET;
+  }
+  inline bool isDecoy() const { return label == LabelType::DECOY; }
+  inline PSMDescription* getPSM() const { return pPSM; }
+  void printPSM(ostream& os, bool printDecoys, bool printExpMass) const;
+  void printPepXML(ostream& os, map<char, float>& aaWeight, int index) const;
+  void printPeptide(ostream& os,
+                    bool printDecoys,
+                    bool printExpMass,
+                    Scores& fullset) const;
+};
+
+/*
+ * The orderings below compare ScoreHolders or ScoreHolderRefs, so that they
+ * can sort vectors of ScoreHolders as well as the PSMs of a Scores.
+ */
 struct lessThanBaseName {
-  inline bool operator()(const ScoreHolder& struct1,
-                         const ScoreHolder& struct2) {
-    std::string id1 = struct1.pPSM->getId();
-    std::string id2 = struct2.pPSM->getId();
-    return (id1 < id2);
+  template <typename Holder>
+  inline bool operator()(const Holder& struct1, const Holder& struct2) {
+    return struct1.pPSM->getIdRef() < struct2.pPSM->getIdRef();
   }
 };
 bool operator>(const ScoreHolder& one, const ScoreHolder& other);
 bool operator<(const ScoreHolder& one, const ScoreHolder& other);
 
 struct lexicOrderProb {
-  static int compStrIt(const std::string& sv1, const std::string& sv2) {
-    auto it1 = sv1.begin(), end1 = sv1.end();
-    auto it2 = sv2.begin(), end2 = sv2.end();
+  static int compStrIt(const StringRef& sv1, const StringRef& sv2) {
+    const char *it1 = sv1.data(), *end1 = sv1.data() + sv1.size();
+    const char *it2 = sv2.data(), *end2 = sv2.data() + sv2.size();
 
     for (; it1 != end1 && it2 != end2; ++it1, ++it2) {
       if (*it1 < *it2)
@@ -94,12 +151,13 @@ struct lexicOrderProb {
     return 0;
   }
 
-  bool operator()(const ScoreHolder& x, const ScoreHolder& y) const {
-    const std::string& fullSeqX = x.pPSM->getFullPeptideSequence();
-    const std::string& fullSeqY = y.pPSM->getFullPeptideSequence();
+  template <typename Holder>
+  bool operator()(const Holder& x, const Holder& y) const {
+    const StringRef& fullSeqX = x.pPSM->getFullPeptideRef();
+    const StringRef& fullSeqY = y.pPSM->getFullPeptideRef();
 
-    std::string peptSeqX = fullSeqX.substr(2, fullSeqX.size() - 4);
-    std::string peptSeqY = fullSeqY.substr(2, fullSeqY.size() - 4);
+    StringRef peptSeqX = fullSeqX.subref(2, fullSeqX.size() - 4);
+    StringRef peptSeqY = fullSeqY.subref(2, fullSeqY.size() - 4);
 
     int peptCmp = compStrIt(peptSeqX, peptSeqY);
     return ((peptCmp == 1) || ((peptCmp == 0) && (x.label > y.label)) ||
@@ -126,7 +184,8 @@ inline unsigned int fast_uint_hash(unsigned int x) {
  * https://en.cppreference.com/w/cpp/utility/hash
  */
 struct OrderScanHash {
-  bool operator()(const ScoreHolder& x, const ScoreHolder& y) const {
+  template <typename Holder>
+  bool operator()(const Holder& x, const Holder& y) const {
     size_t hash_x = fast_uint_hash(x.pPSM->specFileNr) ^
                     (fast_uint_hash(x.pPSM->scan) << 1);
     size_t hash_y = fast_uint_hash(y.pPSM->specFileNr) ^
@@ -136,7 +195,8 @@ struct OrderScanHash {
 };
 
 struct OrderScanMassCharge {
-  bool operator()(const ScoreHolder& x, const ScoreHolder& y) const {
+  template <typename Holder>
+  bool operator()(const Holder& x, const Holder& y) const {
     if (x.pPSM->specFileNr != y.pPSM->specFileNr)
       return x.pPSM->specFileNr < y.pPSM->specFileNr;
     if (x.pPSM->scan != y.pPSM->scan)
@@ -148,7 +208,8 @@ struct OrderScanMassCharge {
 };
 
 struct OrderScanMassLabelCharge {
-  bool operator()(const ScoreHolder& x, const ScoreHolder& y) const {
+  template <typename Holder>
+  bool operator()(const Holder& x, const Holder& y) const {
     if (x.pPSM->specFileNr != y.pPSM->specFileNr)
       return x.pPSM->specFileNr < y.pPSM->specFileNr;
     if (x.pPSM->scan != y.pPSM->scan)
@@ -162,7 +223,8 @@ struct OrderScanMassLabelCharge {
 };
 
 struct OrderScanLabel {
-  bool operator()(const ScoreHolder& x, const ScoreHolder& y) const {
+  template <typename Holder>
+  bool operator()(const Holder& x, const Holder& y) const {
     if (x.pPSM->specFileNr != y.pPSM->specFileNr)
       return x.pPSM->specFileNr < y.pPSM->specFileNr;
     if (x.pPSM->scan != y.pPSM->scan)
@@ -172,7 +234,8 @@ struct OrderScanLabel {
 };
 
 struct UniqueScanMassCharge {
-  bool operator()(const ScoreHolder& x, const ScoreHolder& y) const {
+  template <typename Holder>
+  bool operator()(const Holder& x, const Holder& y) const {
     return (x.pPSM->specFileNr == y.pPSM->specFileNr) &&
            (x.pPSM->scan == y.pPSM->scan) &&
            (x.pPSM->expMass == y.pPSM->expMass);
@@ -180,7 +243,8 @@ struct UniqueScanMassCharge {
 };
 
 struct UniqueScanMassLabelCharge {
-  bool operator()(const ScoreHolder& x, const ScoreHolder& y) const {
+  template <typename Holder>
+  bool operator()(const Holder& x, const Holder& y) const {
     return (x.pPSM->specFileNr == y.pPSM->specFileNr) &&
            (x.pPSM->scan == y.pPSM->scan) && (x.label == y.label) &&
            (x.pPSM->expMass == y.pPSM->expMass);
@@ -188,7 +252,8 @@ struct UniqueScanMassLabelCharge {
 };
 
 struct UniqueScanLabel {
-  bool operator()(const ScoreHolder& x, const ScoreHolder& y) const {
+  template <typename Holder>
+  bool operator()(const Holder& x, const Holder& y) const {
     return (x.pPSM->specFileNr == y.pPSM->specFileNr) &&
            (x.pPSM->scan == y.pPSM->scan) && (x.label == y.label);
   }
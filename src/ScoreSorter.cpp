@@ -0,0 +1,239 @@
+/*******************************************************************************
+ Copyright 2006-2012 Lukas Käll <lukas.kall@scilifelab.se>
+
+ Licensed under the Apache License, Version 2.0 (the "License");
+ you may not use this file except in compliance with the License.
+ You may obtain a copy of the License at
+
+ http://www.apache.org/licenses/LICENSE-2.0
+
+ Unless required by applicable law or agreed to in writing, software
+ distributed under the License is distributed on an "AS IS" BASIS,
+ WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ See the License for the specific language governing permissions and
+ limitations under the License.
+
+ *******************************************************************************/
+#include "ScoreSorter.h"
+
+#ifdef _OPENMP
+#include <omp.h>
+#endif
+
+#include <algorithm>
+#include <cstring>
+#include <functional>
+
+namespace {
+
+const uint64_t kSignBit = static_cast<uint64_t>(1u) << 63;
+
+// a key that orders as the score, with -0.0 and 0.0 as the same key
+inline uint64_t ascendingKey(double score) {
+  if (score == 0.0) score = 0.0;
+  uint64_t bits;
+  std::memcpy(&bits, &score, sizeof(bits));
+  return (bits & kSignBit) ? ~bits : (bits | kSignBit);
+}
+
+// the ScoreHolder comparison operators for PSMs with equal scores
+struct TieGreater {
+  bool operator()(const PSMDescription* x, LabelType xLabel,
+                  const PSMDescription* y, LabelType yLabel) const {
+    if (x->scan != y->scan) return x->scan > y->scan;
+    if (x->expMass != y->expMass) return x->expMass > y->expMass;
+    return xLabel > yLabel;
+  }
+};
+
+struct TieLess {
+  bool operator()(const PSMDescription* x, LabelType xLabel,
+                  const PSMDescription* y, LabelType yLabel) const {
+    if (x->scan != y->scan) return x->scan < y->scan;
+    if (x->expMass != y->expMass) return x->expMass < y->expMass;
+    return xLabel < yLabel;
+  }
+};
+
+template <typename TieCompare>
+class KeyCompare {
+ public:
+  KeyCompare(const PSMDescription* const* psms, const LabelType* labels)
+      : psms_(psms), labels_(labels) {}
+  template <typename KeyIndex>
+  bool operator()(const KeyIndex& x, const KeyIndex& y) const {
+    if (x.key != y.key) return x.key < y.key;
+    return compare_(psms_[x.index], labels_[x.index], psms_[y.index],
+                    labels_[y.index]);
+  }
+ private:
+  const PSMDescription* const* psms_;
+  const LabelType* labels_;
+  TieCompare compare_;
+};
+
+}  // namespace
+
+void ScoreSorter::sortDescending(Iterator first, Iterator last) {
+  size_t numScores = static_cast<size_t>(last - first);
+  if (numScores < kMinRadixSortSize) {
+    std::stable_sort(first, last, std::greater<ScoreHolder>());
+    return;
+  }
+  std::vector<uint32_t> order;
+  getOrder(first, numScores, true, order);
+  permute(first, order);
+}
+
+void ScoreSorter::sortAscending(Iterator first, Iterator last) {
+  size_t numScores = static_cast<size_t>(last - first);
+  if (numScores < kMinRadixSortSize) {
+    std::stable_sort(first, last);
+    return;
+  }
+  std::vector<uint32_t> order;
+  getOrder(first, numScores, false, order);
+  permute(first, order);
+}
+
+void ScoreSorter::getDescendingOrder(const double* scores,
+                                     const PSMDescription* const* psms,
+                                     const LabelType* labels,
+                                     size_t numScores,
+                                     std::vector<uint32_t>& order) {
+  getOrder(scores, psms, labels, numScores, true, order);
+}
+
+void ScoreSorter::getAscendingOrder(const double* scores,
+                                    const PSMDescription* const* psms,
+                                    const LabelType* labels,
+                                    size_t numScores,
+                                    std::vector<uint32_t>& order) {
+  getOrder(scores, psms, labels, numScores, false, order);
+}
+
+void ScoreSorter::getOrder(Iterator first, size_t numScores, bool descending,
+                           std::vector<uint32_t>& order) {
+  std::vector<double> scores(numScores);
+  std::vector<const PSMDescription*> psms(numScores);
+  std::vector<LabelType> labels(numScores);
+  for (size_t i = 0; i < numScores; ++i) {
+    scores[i] = first[i].score;
+    psms[i] = first[i].pPSM;
+    labels[i] = first[i].label;
+  }
+  getOrder(&scores[0], &psms[0], &labels[0], numScores, descending, order);
+}
+
+void ScoreSorter::getOrder(const double* scores,
+                           const PSMDescription* const* psms,
+                           const LabelType* labels, size_t numScores,
+                           bool descending, std::vector<uint32_t>& order) {
+  std::vector<KeyIndex> items(numScores);
+  for (size_t i = 0; i < numScores; ++i) {
+    uint64_t key = ascendingKey(scores[i]);
+    items[i].key = descending ? ~key : key;
+    items[i].index = static_cast<uint32_t>(i);
+  }
+  if (numScores < kMinRadixSortSize) {
+    sortRun(psms, labels, descending, items.begin(), items.end());
+  } else {
+    radixSort(items);
+    // order the runs with the same top bits on the full keys, and equal
+    // scores on the other members compared
+    for (size_t runBegin = 0; runBegin < numScores;) {
+      uint64_t runTopBits = items[runBegin].key >> kSortedBitsShift;
+      size_t runEnd = runBegin + 1u;
+      while (runEnd < numScores &&
+             (items[runEnd].key >> kSortedBitsShift) == runTopBits) {
+        ++runEnd;
+      }
+      if (runEnd - runBegin > 1u) {
+        sortRun(psms, labels, descending, items.begin() + runBegin,
+                items.begin() + runEnd);
+      }
+      runBegin = runEnd;
+    }
+  }
+  order.resize(numScores);
+  for (size_t i = 0; i < numScores; ++i) {
+    order[i] = items[i].index;
+  }
+}
+
+void ScoreSorter::sortRun(const PSMDescription* const* psms,
+                          const LabelType* labels, bool descending,
+                          std::vector<KeyIndex>::iterator begin,
+                          std::vector<KeyIndex>::iterator end) {
+  if (descending) {
+    std::stable_sort(begin, end, KeyCompare<TieGreater>(psms, labels));
+  } else {
+    std::stable_sort(begin, end, KeyCompare<TieLess>(psms, labels));
+  }
+}
+
+void ScoreSorter::radixSort(std::vector<KeyIndex>& items) {
+  const size_t kNumBuckets = static_cast<size_t>(1u) << kDigitBits;
+  size_t numItems = items.size();
+  int numParts = 1;
+#ifdef _OPENMP
+  if (numItems >= kMinParallelSize && !omp_in_parallel()) {
+    numParts = omp_get_max_threads();
+  }
+#endif
+  std::vector<size_t> partBegins(static_cast<size_t>(numParts) + 1u);
+  for (int part = 0; part <= numParts; ++part) {
+    partBegins[part] = numItems * static_cast<size_t>(part) / numParts;
+  }
+
+  std::vector<KeyIndex> buffer(numItems);
+  // the counts and then the scatter offsets of each part and bucket
+  std::vector<size_t> offsets(numParts * kNumBuckets);
+  for (unsigned int shift = kSortedBitsShift; shift < 64u;
+       shift += kDigitBits) {
+    std::fill(offsets.begin(), offsets.end(), 0u);
+#pragma omp parallel for schedule(static, 1) num_threads(numParts) if (numParts > 1)
+    for (int part = 0; part < numParts; ++part) {
+      size_t* counts = &offsets[part * kNumBuckets];
+      for (size_t i = partBegins[part]; i < partBegins[part + 1]; ++i) {
+        ++counts[(items[i].key >> shift) & (kNumBuckets - 1u)];
+      }
+    }
+
+    bool skipPass = false;
+    for (size_t bucket = 0; bucket < kNumBuckets && !skipPass; ++bucket) {
+      size_t bucketCount = 0u;
+      for (int part = 0; part < numParts; ++part) {
+        bucketCount += offsets[part * kNumBuckets + bucket];
+      }
+      skipPass = (bucketCount == numItems);
+    }
+    if (skipPass) continue;
+
+    size_t offset = 0u;
+    for (size_t bucket = 0; bucket < kNumBuckets; ++bucket) {
+      for (int part = 0; part < numParts; ++part) {
+        size_t count = offsets[part * kNumBuckets + bucket];
+        offsets[part * kNumBuckets + bucket] = offset;
+        offset += count;
+      }
+    }
+#pragma omp parallel for schedule(static, 1) num_threads(numParts) if (numParts > 1)
+    for (int part = 0; part < numParts; ++part) {
+      size_t* next = &offsets[part * kNumBuckets];
+      for (size_t i = partBegins[part]; i < partBegins[part + 1]; ++i) {
+        buffer[next[(items[i].key >> shift) & (kNumBuckets - 1u)]++] = items[i];
+      }
+    }
+    items.swap(buffer);
+  }
+}
+
+void ScoreSorter::permute(Iterator first, const std::vector<uint32_t>& order) {
+  std::vector<ScoreHolder> sorted;
+  sorted.reserve(order.size());
+  for (size_t i = 0; i < order.size(); ++i) {
+    sorted.push_back(first[order[i]]);
+  }
+  std::copy(sorted.begin(), sorted.end(), first);
+}
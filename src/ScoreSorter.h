@@ -0,0 +1,96 @@
+/*******************************************************************************
+ Copyright 2006-2012 Lukas Käll <lukas.kall@scilifelab.se>
+
+ Licensed under the Apache License, Version 2.0 (the "License");
+ you may not use this file except in compliance with the License.
+ You may obtain a copy of the License at
+
+ http://www.apache.org/licenses/LICENSE-2.0
+
+ Unless required by applicable law or agreed to in writing, software
+ distributed under the License is distributed on an "AS IS" BASIS,
+ WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ See the License for the specific language governing permissions and
+ limitations under the License.
+
+ *******************************************************************************/
+#ifndef SCORESORTER_H_
+#define SCORESORTER_H_
+
+#include <stdint.h>
+
+#include <cstddef>
+#include <vector>
+
+#include "ScoreHolder.h"
+
+/*
+ * ScoreSorter orders PSMs by their score without moving them around while
+ * sorting. The scores are turned into 64 bit keys that order like the
+ * doubles, which are sorted together with the index of their PSM by
+ * a least significant digit radix sort on the top 33 bits of the keys, in
+ * three passes of 11 bits, skipping the passes in which all keys have the
+ * same digit. The passes are split over the threads for large inputs; every
+ * thread scatters a fixed part of the keys, so the order does not depend on
+ * the number of threads.
+ *
+ * The short runs of keys with the same top bits are then sorted on the full
+ * keys, and equal scores as the ScoreHolder comparison operators do, on the
+ * scan, the mass and the label. This gives the same order as std::stable_sort
+ * with those operators: ScoreHolders that the operators consider equal keep
+ * their input order, which std::sort leaves unspecified. Small inputs are
+ * sorted by std::stable_sort directly.
+ *
+ * The orders are computed on columns of scores, PSMs and labels, e.g. those
+ * of a Scores, reading the PSMs and labels only to break ties. Vectors of
+ * ScoreHolders can also be sorted in place.
+ */
+class ScoreSorter {
+ public:
+  typedef std::vector<ScoreHolder>::iterator Iterator;
+
+  // as std::stable_sort(first, last, greater<ScoreHolder>())
+  static void sortDescending(Iterator first, Iterator last);
+  // as std::stable_sort(first, last), i.e. by operator<
+  static void sortAscending(Iterator first, Iterator last);
+
+  // fill order with the indices of the PSMs by decreasing or increasing
+  // scores[i], as the ScoreHolder (scores[i], labels[i], psms[i]) would be
+  // ordered, leaving the columns as they are
+  static void getDescendingOrder(const double* scores,
+                                 const PSMDescription* const* psms,
+                                 const LabelType* labels, size_t numScores,
+                                 std::vector<uint32_t>& order);
+  static void getAscendingOrder(const double* scores,
+                                const PSMDescription* const* psms,
+                                const LabelType* labels, size_t numScores,
+                                std::vector<uint32_t>& order);
+
+ private:
+  struct KeyIndex {
+    uint64_t key;
+    uint32_t index;
+  };
+
+  // below this the ScoreHolders or keys are sorted by std::stable_sort
+  static const size_t kMinRadixSortSize = 4096u;
+  // the radix sort orders the key bits from here, in digits of kDigitBits
+  static const unsigned int kSortedBitsShift = 31u;
+  static const unsigned int kDigitBits = 11u;
+  // below this a radix sort pass runs on one thread
+  static const size_t kMinParallelSize = 1u << 17;
+
+  static void getOrder(Iterator first, size_t numScores, bool descending,
+                       std::vector<uint32_t>& order);
+  static void getOrder(const double* scores, const PSMDescription* const* psms,
+                       const LabelType* labels, size_t numScores,
+                       bool descending, std::vector<uint32_t>& order);
+  static void sortRun(const PSMDescription* const* psms,
+                      const LabelType* labels, bool descending,
+                      std::vector<KeyIndex>::iterator begin,
+                      std::vector<KeyIndex>::iterator end);
+  static void radixSort(std::vector<KeyIndex>& items);
+  static void permute(Iterator first, const std::vector<uint32_t>& order);
+};
+
+#endif /* SCORESORTER_H_ */
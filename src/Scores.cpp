@@ -20,6 +20,7 @@
 #include <cmath>
 #include <fstream>
 #include <iostream>
+#include <limits>
 #include <map>
 #include <memory>
 #include <set>
@@ -30,10 +31,12 @@
 
 #include "DataSet.h"
 #include "Globals.h"
+#include "LinearScorer.h"
 #include "MassHandler.h"
 #include "Normalizer.h"
 #include "PosteriorEstimator.h"
 #include "Scores.h"
+#include "ScoreSorter.h"
 #include "SetHandler.h"
 #include "ssl.h"
 #include "IsotonicPEP.h"
@@ -42,33 +45,35 @@ void Scores::merge(std::vector<Scores>& sv,
                    double fdr,
                    bool skipNormalizeScores,
                    std::vector<std::vector<double> >& all_w) {
-  scores_.clear();
+  selectPsms(std::vector<uint32_t>());
   std::vector<Scores>::iterator cvBinScores = sv.begin();
   std::vector<std::vector<double> >::iterator weights = all_w.begin();
   for (; cvBinScores != sv.end(); cvBinScores++, weights++) {
-    sort(cvBinScores->begin(), cvBinScores->end(), greater<ScoreHolder>());
+    cvBinScores->sortDescending();
     cvBinScores->checkSeparationAndSetPi0();
     cvBinScores->calcQvals(fdr);
     if (!skipNormalizeScores) {
       cvBinScores->normalizeScores(fdr, *weights);
     }
-    copy(cvBinScores->begin(), cvBinScores->end(), back_inserter(scores_));
+    appendPsms(*cvBinScores);
   }
   postMergeStep();
 }
 
 void Scores::postMergeStep() {
-  sort(scores_.begin(), scores_.end(), greater<ScoreHolder>());
+  sortDescending();
   totalNumberOfDecoys_ = static_cast<unsigned int>(
-      count_if(scores_.begin(), scores_.end(), mem_fn(&ScoreHolder::isDecoy)));
+      count(label_.begin(), label_.end(), LabelType::DECOY));
   totalNumberOfTargets_ = static_cast<unsigned int>(
-      count_if(scores_.begin(), scores_.end(), mem_fn(&ScoreHolder::isTarget)));
+      count_if(label_.begin(), label_.end(), [](LabelType label) {
+        return isTarget(label);
+      }));
   targetDecoySizeRatio_ =
       totalNumberOfTargets_ / max(1.0, (double)totalNumberOfDecoys_);
   checkSeparationAndSetPi0();
 }
 
-double Scores::calcScore(const double* feat,
+double Scores::calcScore(const FeatureType* feat,
                          const std::vector<double>& w) const {
   std::size_t ix = FeatureNames::getNumFeatures();
   double score = w[ix];
@@ -84,14 +89,18 @@ void Scores::scoreAndAddPSM(ScoreHolder& sh,
   const unsigned int numFeatures =
       static_cast<unsigned int>(FeatureNames::getNumFeatures());
 
-  for (unsigned int j = 0; j < numFeatures; j++) {
-    sh.score += sh.pPSM->features[j] * rawWeights[j];
-  }
-  sh.score += rawWeights[numFeatures];
+  const FeatureType* features = sh.pPSM->features;
+  LinearScorer::scoreRows(&features, 1u, &rawWeights[0], numFeatures,
+                          &sh.score, LinearScorer::BIAS_LAST);
 
   featurePool.deallocate(sh.pPSM->features);
+  sh.pPSM->features = NULL;
   sh.pPSM->deleteRetentionFeatures();
 
+  addScoredPSM(sh);
+}
+
+void Scores::addScoredPSM(ScoreHolder& sh) {
   if (sh.isTarget()) {
     ++totalNumberOfTargets_;
   } else if (sh.isDecoy()) {
@@ -101,14 +110,23 @@ void Scores::scoreAndAddPSM(ScoreHolder& sh,
   if (!sh.isTarget() && !sh.isDecoy()) {
     std::cerr << "Warning: the PSM " << sh.pPSM->getId()
               << " has a label not in {1,-1} and will be ignored." << std::endl;
-    PSMDescription::deletePtr(sh.pPSM);
   } else {
-    scores_.push_back(sh);
+    sh.pPSM->internSpectrumId();
+    addScoreHolder(sh);
   }
 }
 
+void Scores::addScoreHolder(const ScoreHolder& sh) {
+  score_.push_back(sh.score);
+  q_.push_back(sh.q);
+  pep_.push_back(sh.pep);
+  p_.push_back(sh.p);
+  label_.push_back(sh.label);
+  psm_.push_back(sh.pPSM);
+  featureRows_.push_back(sh.pPSM ? sh.pPSM->features : NULL);
+}
+
 void Scores::print(LabelType label, std::ostream& os) {
-  std::vector<ScoreHolder>::iterator scoreIt = scores_.begin();
   os << "PSMId\t";
   if (PSMDescription::hasSpectrumFileName()) {
     os << "filename\t";
@@ -120,15 +138,16 @@ void Scores::print(LabelType label, std::ostream& os) {
     os << "\n";
   }
 
-  for (; scoreIt != scores_.end(); ++scoreIt) {
-    if (scoreIt->label == label) {
+  for (size_t ix = 0; ix < score_.size(); ++ix) {
+    if (label_[ix] == label) {
+      PSMDescription* psm = psm_[ix];
       std::ostringstream out;
-      scoreIt->pPSM->printProteins(out);
-      ResultHolder rh(scoreIt->score, scoreIt->q, scoreIt->pep,
-                      scoreIt->pPSM->getId(), scoreIt->pPSM->getFullPeptide(),
-                      out.str(), scoreIt->pPSM->getSpectrumFileName());
+      psm->printProteins(out);
+      ResultHolder rh(score_[ix], q_[ix], pep_[ix], psm->getId(),
+                      psm->getFullPeptide(), out.str(),
+                      psm->getSpectrumFileName());
       if (is_output_rt_) {
-        rh.retentionTime = scoreIt->pPSM->getRetentionTime();
+        rh.retentionTime = psm->getRetentionTime();
         rh.outputRT =
             true;  // Ideally this should be set once outside this loop, but
                    // ResultHolder needs to be initialized before.
@@ -140,9 +159,13 @@ void Scores::print(LabelType label, std::ostream& os) {
 }
 
 void Scores::populateWithPSMs(SetHandler& setHandler) {
-  scores_.clear();
-  setHandler.populateScoresWithPSMs(scores_, LabelType::TARGET);
-  setHandler.populateScoresWithPSMs(scores_, LabelType::DECOY);
+  selectPsms(std::vector<uint32_t>());
+  std::vector<ScoreHolder> scores;
+  setHandler.populateScoresWithPSMs(scores, LabelType::TARGET);
+  setHandler.populateScoresWithPSMs(scores, LabelType::DECOY);
+  for (size_t ix = 0; ix < scores.size(); ++ix) {
+    addScoreHolder(scores[ix]);
+  }
   totalNumberOfTargets_ =
       static_cast<unsigned int>(setHandler.getSizeFromLabel(LabelType::TARGET));
   totalNumberOfDecoys_ =
@@ -210,38 +233,124 @@ void Scores::createXvalSetsBySpectrum(std::vector<Scores>& train,
   // set the number of cross validation folds for train and test to xval_fold
   train.resize(xval_fold, Scores(usePi0_));
   test.resize(xval_fold, Scores(usePi0_));
+
+  std::vector<unsigned int> testFolds;
+  std::vector<bool> pseudoTargets;
+  if (!assignXvalFoldsBySpectrum(xval_fold, decoyFractionTraining, testFolds,
+                                 pseudoTargets)) {
+    return;
+  }
+
+  // insert
+  for (size_t ix = 0; ix < score_.size(); ++ix) {
+    ScoreHolder sh = (*this)[ix];
+    if (!pseudoTargets.empty() && pseudoTargets[ix]) {
+      sh.label = LabelType::PSEUDO_TARGET;
+    }
+    for (unsigned int i = 0; i < xval_fold; ++i) {
+      if (i == testFolds[ix]) {
+        test[i].addScoreHolder(sh);
+      }
+      if (i != testFolds[ix] || xval_fold == 1) {
+        train[i].addScoreHolder(sh);
+      }
+    }
+  }
+
+  // without RESET: decoysPerTarget = 1 and decoyFractionTraining = 1, then
+  // factor = 1 and trainNullTargetWinProb = 1/2 (and decoyFactor = 1)
+  //
+  // with RESET 1 decoy: decoysPerTarget = 1 and decoyFractionTraining = 0.5,
+  // then factor = 1.5 and trainNullTargetWinProb = 3/4 (and decoyFactor = 3)
+  //
+  // with RESET 2 decoys: decoysPerTarget = 2 and decoyFractionTraining = 0.5,
+  // then factor = 2 and trainNullTargetWinProb = 2/3 (and decoyFactor = 2)
+  double factor =
+      (decoysPerTarget + 1) - decoyFractionTraining * decoysPerTarget;
+  double trainNullTargetWinProb = factor / (1.0 + decoysPerTarget);
+
+  // calculate ratios of target over decoy for train and test set
+  for (unsigned int i = 0; i < xval_fold; ++i) {
+    train[i].recalculateSizes();
+    test[i].recalculateSizes();
+
+    train[i].setNullTargetWinProb(trainNullTargetWinProb);
+    test[i].setNullTargetWinProb(trainNullTargetWinProb);
+  }
+
+  if (featurePool.isInitialized()) {
+    // lay out the feature rows fold by fold, with the targets of a test fold
+    // before its decoys, so that scoring a test fold reads adjacent rows
+    std::vector<PSMDescription*> psms;
+    psms.reserve(score_.size());
+    for (unsigned int i = 0; i < xval_fold; ++i) {
+      test[i].appendFeatureRowPsms(true, psms);
+      test[i].appendFeatureRowPsms(false, psms);
+    }
+    std::vector<FeatureType*> rows(psms.size());
+    for (size_t k = 0; k < psms.size(); ++k) {
+      rows[k] = psms[k]->features;
+    }
+    featurePool.permuteRows(rows);
+    for (size_t k = 0; k < psms.size(); ++k) {
+      psms[k]->features = featurePool.addressFromIdx(static_cast<unsigned int>(k));
+    }
+    refreshFeatureRows();
+    for (unsigned int i = 0; i < xval_fold; ++i) {
+      train[i].refreshFeatureRows();
+      test[i].refreshFeatureRows();
+    }
+  }
+}
+
+/**
+ * Sorts the PSMs by spectrum and assigns each spectrum at random to one of
+ * xval_fold test folds of about equal size
+ * @param testFolds the test fold of each PSM
+ * @param pseudoTargets with decoyFractionTraining < 1, the decoys that are
+ * used as pseudo targets, left empty otherwise
+ * @return false if there are no PSMs and the error is ignored
+ */
+bool Scores::assignXvalFoldsBySpectrum(unsigned int xval_fold,
+                                       double decoyFractionTraining,
+                                       std::vector<unsigned int>& testFolds,
+                                       std::vector<bool>& pseudoTargets) {
   // remain keeps track of residual space available in each fold
   std::vector<int> remain(xval_fold);
   // set values for remain: initially each fold is assigned (tot number of
-  // scores_ / tot number of folds)
-  int fold = static_cast<int>(xval_fold), ix = static_cast<int>(scores_.size());
+  // PSMs / tot number of folds)
+  int fold = static_cast<int>(xval_fold), ix = static_cast<int>(score_.size());
   while (fold--) {
     remain[static_cast<std::size_t>(fold)] = ix / (fold + 1);
     ix -= remain[static_cast<std::size_t>(fold)];
   }
 
-  std::sort(scores_.begin(), scores_.end(), OrderScanHash());
+  sort(OrderScanHash());
 
-  if (scores_.size() == 0) {
+  testFolds.clear();
+  pseudoTargets.clear();
+  if (score_.size() == 0) {
     ostringstream oss;
     oss << "Error: no scored PSMs were provided.\n";
     if (NO_TERMINATE) {
       cerr << oss.str() << "No-terminate flag set: ignoring error."
            << std::endl;
-      return;
+      return false;
     } else {
       throw MyException(oss.str());
     }
   }
 
-  // put scores into the folds; choose a fold (at random) and change it only
-  // when scores from a new spectra are encountered
-  unsigned int previousSpectrum = scores_.begin()->pPSM->scan;
+  testFolds.resize(score_.size());
+  if (decoyFractionTraining < 1.0) {
+    pseudoTargets.resize(score_.size(), false);
+  }
+  // choose a fold (at random) and change it only when scores from a new
+  // spectra are encountered
+  unsigned int previousSpectrum = psm_.front()->scan;
   size_t randIndex = PseudoRandom::lcg_rand() % xval_fold;
-  for (std::vector<ScoreHolder>::iterator it = scores_.begin();
-       it != scores_.end(); ++it) {
-    const unsigned int curScan = (*it).pPSM->scan;
-    ScoreHolder sh = (*it);
+  for (size_t psmIdx = 0; psmIdx < score_.size(); ++psmIdx) {
+    const unsigned int curScan = psm_[psmIdx]->scan;
 
     // if current score is from a different spectra than the one encountered in
     // the previous iteration, choose new fold
@@ -256,68 +365,76 @@ void Scores::createXvalSetsBySpectrum(std::vector<Scores>& train,
     // if we use multiple folds with RESET, assign 1-decoyFractionTraining as
     // pseudo targets.
     if (xval_fold > 1u && decoyFractionTraining < 1.0 &&
-        sh.label == LabelType::DECOY &&
+        label_[psmIdx] == LabelType::DECOY &&
         PseudoRandom::lcg_uniform_rand() > decoyFractionTraining) {
       // From Algorithm S3 of the percolator-RESET supplementary material
       // decoyFractionTraining - the probability of assigning a decoy to the
       // training set
-      sh.label = LabelType::PSEUDO_TARGET;
+      pseudoTargets[psmIdx] = true;
     }
 
-    // insert
-    for (unsigned int i = 0; i < xval_fold; ++i) {
-      if (i == randIndex) {
-        test[i].addScoreHolder(sh);
-      }
-      if (i != randIndex || xval_fold == 1) {
-        train[i].addScoreHolder(sh);
-      }
-    }
+    testFolds[psmIdx] = static_cast<unsigned int>(randIndex);
     // update number of free position for used fold
     --remain[randIndex];
     // set previous spectrum to current one for next iteration
     previousSpectrum = curScan;
   }
+  return true;
+}
 
-  // without RESET: decoysPerTarget = 1 and decoyFractionTraining = 1, then
-  // factor = 1 and trainNullTargetWinProb = 1/2 (and decoyFactor = 1)
-  //
-  // with RESET 1 decoy: decoysPerTarget = 1 and decoyFractionTraining = 0.5,
-  // then factor = 1.5 and trainNullTargetWinProb = 3/4 (and decoyFactor = 3)
-  //
-  // with RESET 2 decoys: decoysPerTarget = 2 and decoyFractionTraining = 0.5,
-  // then factor = 2 and trainNullTargetWinProb = 2/3 (and decoyFactor = 2)
-  double factor =
-      (decoysPerTarget + 1) - decoyFractionTraining * decoysPerTarget;
-  double trainNullTargetWinProb = factor / (1.0 + decoysPerTarget);
-
-  // calculate ratios of target over decoy for train and test set
+/**
+ * Divides the PSMs into xval_fold cross-validation sets as
+ * createXvalSetsBySpectrum does without RESET, but as views on these PSMs
+ * instead of copies of them, e.g. for the nested cross validation
+ * @param folds the test fold of each PSM and the PSMs of each test fold
+ * @param xval_fold number of folds
+ */
+void Scores::createXvalFoldsBySpectrum(XvalFolds& folds,
+                                       unsigned int xval_fold) {
+  std::vector<bool> pseudoTargets;
+  assignXvalFoldsBySpectrum(xval_fold, 1.0, folds.testFolds, pseudoTargets);
+  // the pi0 and null target win probability of new sets without RESET
+  folds.pi0 = 1.0;
+  folds.nullTargetWinProb = 0.5;
+
+  // the PSMs by test fold, in their order within each fold
+  folds.foldBegins.assign(xval_fold + 1u, 0u);
+  for (size_t ix = 0; ix < folds.testFolds.size(); ++ix) {
+    ++folds.foldBegins[folds.testFolds[ix] + 1u];
+  }
   for (unsigned int i = 0; i < xval_fold; ++i) {
-    train[i].recalculateSizes();
-    test[i].recalculateSizes();
-
-    train[i].setNullTargetWinProb(trainNullTargetWinProb);
-    test[i].setNullTargetWinProb(trainNullTargetWinProb);
+    folds.foldBegins[i + 1u] += folds.foldBegins[i];
+  }
+  std::vector<size_t> next(folds.foldBegins.begin(),
+                           folds.foldBegins.end() - 1);
+  folds.order.resize(folds.testFolds.size());
+  for (size_t ix = 0; ix < folds.testFolds.size(); ++ix) {
+    folds.order[next[folds.testFolds[ix]]++] = static_cast<uint32_t>(ix);
   }
+}
 
-  if (featurePool.isInitialized()) {
-    boost::unordered_map<double*, double*> movedAddresses;
-    size_t idx = 0;
-    for (unsigned int i = 0; i < xval_fold; ++i) {
-      bool isTarget = true;
-      test[i].reorderFeatureRows(featurePool, isTarget, movedAddresses, idx);
-      isTarget = false;
-      test[i].reorderFeatureRows(featurePool, isTarget, movedAddresses, idx);
-    }
+/**
+ * A single fold that trains and tests on all PSMs, with the pi0 and null
+ * target win probability of this set
+ */
+void Scores::createSingleXvalFold(XvalFolds& folds) const {
+  folds.testFolds.assign(score_.size(), 0u);
+  folds.order.resize(score_.size());
+  for (size_t ix = 0; ix < score_.size(); ++ix) {
+    folds.order[ix] = static_cast<uint32_t>(ix);
   }
+  folds.foldBegins.resize(2u);
+  folds.foldBegins[0] = 0u;
+  folds.foldBegins[1] = score_.size();
+  folds.pi0 = pi0_;
+  folds.nullTargetWinProb = nullTargetWinProb_;
 }
 
 void Scores::recalculateSizes() {
   totalNumberOfTargets_ = 0;
   totalNumberOfDecoys_ = 0;
-  std::vector<ScoreHolder>::const_iterator scoreIt = scores_.begin();
-  for (; scoreIt != scores_.end(); ++scoreIt) {
-    if (scoreIt->isTarget()) {
+  for (size_t ix = 0; ix < label_.size(); ++ix) {
+    if (isTarget(label_[ix])) {
       ++totalNumberOfTargets_;
     } else {
       ++totalNumberOfDecoys_;
@@ -326,26 +443,11 @@ void Scores::recalculateSizes() {
   targetDecoySizeRatio_ = totalNumberOfTargets_ / (double)totalNumberOfDecoys_;
 }
 
-void Scores::reorderFeatureRows(
-    FeatureMemoryPool& featurePool,
-    bool isTarget,
-    boost::unordered_map<double*, double*>& movedAddresses,
-    size_t& idx) {
-  size_t numFeatures = FeatureNames::getNumFeatures();
-  std::vector<ScoreHolder>::const_iterator scoreIt = scores_.begin();
-  for (; scoreIt != scores_.end(); ++scoreIt) {
-    if (scoreIt->isTarget() == isTarget) {
-      double* newAddress =
-          featurePool.addressFromIdx(static_cast<unsigned int>(idx++));
-      double* oldAddress = scoreIt->pPSM->features;
-      while (movedAddresses.find(oldAddress) != movedAddresses.end()) {
-        oldAddress = movedAddresses[oldAddress];
-      }
-      std::swap_ranges(oldAddress, oldAddress + numFeatures, newAddress);
-      scoreIt->pPSM->features = newAddress;
-      if (oldAddress != newAddress) {
-        movedAddresses[newAddress] = oldAddress;
-      }
+void Scores::appendFeatureRowPsms(bool isTarget,
+                                  std::vector<PSMDescription*>& psms) {
+  for (size_t ix = 0; ix < label_.size(); ++ix) {
+    if (Scores::isTarget(label_[ix]) == isTarget) {
+      psms.push_back(psm_[ix]);
     }
   }
 }
@@ -359,7 +461,7 @@ void Scores::normalizeScores(double fdr, std::vector<double>& weights) {
   unsigned int medianIndex = std::max(0u, totalNumberOfDecoys_ / 2u),
                decoys = 0u;
 
-  if (scores_.size() == 0) {
+  if (score_.size() == 0) {
     ostringstream oss;
     oss << "Error: no scored PSMs were provided.\n";
     if (NO_TERMINATE) {
@@ -371,16 +473,15 @@ void Scores::normalizeScores(double fdr, std::vector<double>& weights) {
     }
   }
 
-  std::vector<ScoreHolder>::iterator it = scores_.begin();
-  double fdrScore = it->score;
+  double fdrScore = score_.front();
   double medianDecoyScore = fdrScore + 1.0;
 
-  for (; it != scores_.end(); ++it) {
-    if (it->q < fdr)
-      fdrScore = it->score;
-    if (it->isDecoy()) {
+  for (size_t ix = 0; ix < score_.size(); ++ix) {
+    if (q_[ix] < fdr)
+      fdrScore = score_[ix];
+    if (label_[ix] == LabelType::DECOY) {
       if (++decoys == medianIndex) {
-        medianDecoyScore = it->score;
+        medianDecoyScore = score_[ix];
         break;
       }
     }
@@ -403,10 +504,9 @@ void Scores::normalizeScores(double fdr, std::vector<double>& weights) {
     }
   }
 
-  std::vector<ScoreHolder>::iterator scoreIt = scores_.begin();
-  for (; scoreIt != scores_.end(); ++scoreIt) {
-    scoreIt->score -= fdrScore;
-    scoreIt->score /= diff;
+  for (size_t ix = 0; ix < score_.size(); ++ix) {
+    score_[ix] -= fdrScore;
+    score_[ix] /= diff;
   }
   Normalizer::endScoreNormalizeWeights(weights, weights, fdrScore, diff);
 }
@@ -433,37 +533,231 @@ int Scores::calcScoresAndQvals(std::vector<double>& w,
  */
 int Scores::calcScores(std::vector<double>& w) {
   std::size_t ix;
-  std::vector<ScoreHolder>::iterator scoreIt = scores_.begin();
-  for (; scoreIt != scores_.end(); ++scoreIt) {
-    scoreIt->score = calcScore(scoreIt->pPSM->features, w);
+  if (!score_.empty()) {
+    // the same dot products as calcScore, as one batch over the feature row
+    // column into the score column, which is then sorted
+    LinearScorer::scoreRows(&featureRows_[0], featureRows_.size(), &w[0],
+        FeatureNames::getNumFeatures(), &score_[0],
+        LinearScorer::BIAS_FIRST);
+    sortDescending();
   }
-  sort(scores_.begin(), scores_.end(), greater<ScoreHolder>());
   if (VERB > 3) {
-    if (scores_.size() >= 10) {
+    if (score_.size() >= 10) {
       cerr << "10 best scores and labels" << endl;
       for (ix = 0; ix < 10; ix++) {
-        cerr << scores_[ix].score << " " << scores_[ix].label << endl;
+        cerr << score_[ix] << " " << label_[ix] << endl;
       }
       cerr << "10 worst scores and labels" << endl;
-      for (ix = scores_.size() - 10; ix < scores_.size(); ix++) {
-        cerr << scores_[ix].score << " " << scores_[ix].label << endl;
+      for (ix = score_.size() - 10; ix < score_.size(); ix++) {
+        cerr << score_[ix] << " " << label_[ix] << endl;
       }
     } else {
       cerr << "Too few scores to display top and bottom PSMs ("
-           << scores_.size() << " scores found)." << endl;
+           << score_.size() << " scores found)." << endl;
     }
   }
   return 0;
 }
 
+/**
+ * Counts the targets that calcScoresAndQvals(w, fdr, skipDecoysPlusOne)
+ * would give a q-value below fdr, without sorting the ScoreHolders or
+ * computing the q-values of all PSMs, for the validation of the candidate
+ * weights of the grid search.
+ *
+ * The PSMs are scored into a compact array of (score, isTarget) pairs. The
+ * FDR estimate of a score can not drop below the one computed with all
+ * targets above it, so once enough decoys score higher than a PSM, no PSM
+ * below it can have a q-value below fdr. Only the pairs scoring at least as
+ * high as that decoy, found by selection, are sorted and scanned. With
+ * pi0 < 1, whose mix-max correction needs all PSMs, all pairs are sorted
+ * and the q-values are computed as usual.
+ * @param w normal vector used for SVM cost
+ * @param fdr FDR threshold
+ * @return number of targets with a q-value below fdr
+ */
+int Scores::countTargetsBelowFdr(const std::vector<double>& w, double fdr,
+                                 bool skipDecoysPlusOne) const {
+  return countTargetsBelowFdr(featureRows_, label_, w, fdr, skipDecoysPlusOne,
+                              pi0_, nullTargetWinProb_);
+}
+
+/**
+ * As countTargetsBelowFdr, for the PSMs of the test set of a fold
+ * @param folds the cross validation folds of these PSMs
+ * @param fold the fold whose test set is counted
+ */
+int Scores::countTargetsBelowFdr(const std::vector<double>& w, double fdr,
+                                 bool skipDecoysPlusOne,
+                                 const XvalFolds& folds,
+                                 unsigned int fold) const {
+  size_t foldBegin = folds.foldBegins[fold];
+  size_t foldEnd = folds.foldBegins[fold + 1u];
+  std::vector<FeatureType*> rows(foldEnd - foldBegin);
+  std::vector<LabelType> labels(foldEnd - foldBegin);
+  for (size_t ix = foldBegin; ix < foldEnd; ++ix) {
+    rows[ix - foldBegin] = featureRows_[folds.order[ix]];
+    labels[ix - foldBegin] = label_[folds.order[ix]];
+  }
+  return countTargetsBelowFdr(rows, labels, w, fdr, skipDecoysPlusOne,
+                              folds.pi0, folds.nullTargetWinProb);
+}
+
+int Scores::countTargetsBelowFdr(const std::vector<FeatureType*>& rows,
+                                 const std::vector<LabelType>& labels,
+                                 const std::vector<double>& w, double fdr,
+                                 bool skipDecoysPlusOne, double pi0,
+                                 double nullTargetWinProb) {
+  const size_t numScores = rows.size();
+  if (numScores == 0u) return 0;
+  std::vector<double> rowScores(numScores);
+  LinearScorer::scoreRows(&rows[0], numScores, &w[0],
+      FeatureNames::getNumFeatures(), &rowScores[0],
+      LinearScorer::BIAS_FIRST);
+
+  std::vector<pair<double, bool> > combined(numScores);
+  std::vector<double> decoyScores;
+  int numTargets = 0;
+  for (size_t ix = 0; ix < numScores; ++ix) {
+    combined[ix] = pair<double, bool>(rowScores[ix], isTarget(labels[ix]));
+    if (combined[ix].second) {
+      ++numTargets;
+    } else {
+      decoyScores.push_back(rowScores[ix]);
+    }
+  }
+
+  if (pi0 < 1.0) {
+    std::sort(combined.begin(), combined.end(),
+              greater<pair<double, bool> >());
+    std::vector<double> qvals;
+    return calcPairQvals(combined, fdr, skipDecoysPlusOne, pi0,
+                         nullTargetWinProb, qvals);
+  }
+
+  // the FDR estimates as in PosteriorEstimator::getQValues for pi0 == 1
+  double decoyFactor = nullTargetWinProb / (1.0 - nullTargetWinProb);
+  int firstDecoyCount = skipDecoysPlusOne ? 0 : 1;
+  // the number of decoys that keeps any FDR estimate at or above fdr
+  int numBoundDecoys = 0;
+  while (numBoundDecoys <= static_cast<int>(decoyScores.size()) &&
+         (std::min)((firstDecoyCount + numBoundDecoys) * pi0 /
+             (double)((std::max)(1, numTargets)) * decoyFactor, 1.0) < fdr) {
+    ++numBoundDecoys;
+  }
+  if (numBoundDecoys == 0) return 0;
+
+  std::vector<pair<double, bool> >::iterator regionEnd = combined.end();
+  if (numBoundDecoys <= static_cast<int>(decoyScores.size())) {
+    std::nth_element(decoyScores.begin(),
+        decoyScores.begin() + (numBoundDecoys - 1), decoyScores.end(),
+        greater<double>());
+    double boundScore = decoyScores[numBoundDecoys - 1];
+    regionEnd = std::partition(combined.begin(), combined.end(),
+        [boundScore](const pair<double, bool>& p) {
+          return p.first >= boundScore;
+        });
+  }
+  std::sort(combined.begin(), regionEnd, greater<pair<double, bool> >());
+
+  int numPos = 0;
+  int n_z_ge_w = firstDecoyCount, n_w_ge_w = 0;
+  std::vector<pair<double, bool> >::const_iterator myPair = combined.begin();
+  for (; myPair != regionEnd; ++myPair) {
+    if (myPair->second) {
+      ++n_w_ge_w;
+    } else {
+      ++n_z_ge_w;
+    }
+    // the q-value of a tie group is the lowest FDR estimate from there on
+    if (myPair + 1 == regionEnd || myPair->first != (myPair + 1)->first) {
+      double fdrEstimate = n_z_ge_w * pi0 /
+          (double)((std::max)(1, n_w_ge_w)) * decoyFactor;
+      if ((std::min)(fdrEstimate, 1.0) < fdr) numPos = n_w_ge_w;
+    }
+  }
+  return numPos;
+}
+
 void Scores::getScoreLabelPairs(std::vector<pair<double, bool> >& combined) {
-  combined.clear();
-  transform(scores_.begin(), scores_.end(), back_inserter(combined),
-            mem_fn(&ScoreHolder::toPair));
+  combined.resize(score_.size());
+  for (size_t ix = 0; ix < score_.size(); ++ix) {
+    combined[ix] = pair<double, bool>(score_[ix], isTarget(label_[ix]));
+  }
+}
+
+template <typename T>
+static void selectColumn(std::vector<T>& column,
+                         const std::vector<uint32_t>& order) {
+  std::vector<T> selected(order.size());
+  for (size_t ix = 0; ix < order.size(); ++ix) {
+    selected[ix] = column[order[ix]];
+  }
+  column.swap(selected);
+}
+
+void Scores::selectPsms(const std::vector<uint32_t>& order) {
+  selectColumn(score_, order);
+  selectColumn(q_, order);
+  selectColumn(pep_, order);
+  selectColumn(p_, order);
+  selectColumn(label_, order);
+  selectColumn(psm_, order);
+  selectColumn(featureRows_, order);
+}
+
+void Scores::appendPsms(const Scores& other) {
+  score_.insert(score_.end(), other.score_.begin(), other.score_.end());
+  q_.insert(q_.end(), other.q_.begin(), other.q_.end());
+  pep_.insert(pep_.end(), other.pep_.begin(), other.pep_.end());
+  p_.insert(p_.end(), other.p_.begin(), other.p_.end());
+  label_.insert(label_.end(), other.label_.begin(), other.label_.end());
+  psm_.insert(psm_.end(), other.psm_.begin(), other.psm_.end());
+  featureRows_.insert(featureRows_.end(), other.featureRows_.begin(),
+                      other.featureRows_.end());
 }
 
 /**
- * Calculates the q-value for each psm in scores_: the q-value is the minimal
+ * Sorts the PSMs by decreasing score, as ScoreSorter::sortDescending sorts
+ * ScoreHolders
+ */
+void Scores::sortDescending() {
+  std::vector<uint32_t> order;
+  ScoreSorter::getDescendingOrder(score_.data(), psm_.data(), label_.data(),
+                                  score_.size(), order);
+  selectPsms(order);
+}
+
+void Scores::refreshFeatureRows() {
+  for (size_t ix = 0; ix < psm_.size(); ++ix) {
+    featureRows_[ix] = psm_[ix]->features;
+  }
+}
+
+/**
+ * Calculates the q-values of sorted (score, isTarget) pairs
+ * @param combined the pairs, in the order of the PSMs
+ * @param fdr FDR threshold
+ * @param qvals the q-value of each pair
+ * @return number of targets with a q-value below fdr
+ */
+int Scores::calcPairQvals(const std::vector<pair<double, bool> >& combined,
+                          double fdr, bool skipDecoysPlusOne, double pi0,
+                          double nullTargetWinProb,
+                          std::vector<double>& qvals) {
+  PosteriorEstimator::setNegative(true);  // also get q-values for decoys
+  qvals.clear();
+  PosteriorEstimator::getQValues(pi0, combined, qvals, skipDecoysPlusOne,
+                                 nullTargetWinProb);
+  int numPos = 0;
+  for (size_t ix = 0; ix < combined.size(); ++ix) {
+    if (qvals[ix] < fdr && combined[ix].second) ++numPos;
+  }
+  return numPos;
+}
+
+/**
+ * Calculates the q-value for each psm: the q-value is the minimal
  * FDR of any set that includes the particular psm
  * @param fdr FDR threshold specified by user (default 0.01)
  * @return number of true positives
@@ -474,31 +768,33 @@ int Scores::calcQvals(double fdr, bool skipDecoysPlusOne) {
   std::vector<pair<double, bool> > combined;
   getScoreLabelPairs(combined);
 
-  std::vector<double> qvals;
-  PosteriorEstimator::setNegative(true);  // also get q-values for decoys
-  PosteriorEstimator::getQValues(pi0_, combined, qvals, skipDecoysPlusOne,
-                                 nullTargetWinProb_);
-
-  // set q-values and count number of positives
-  std::vector<double>::const_iterator qIt = qvals.begin();
-  std::vector<ScoreHolder>::iterator scoreIt = scores_.begin();
-
-  int numPos = 0;
-  for (; qIt != qvals.end(); ++qIt, ++scoreIt) {
-    scoreIt->q = *qIt;
-    if (scoreIt->q < fdr && scoreIt->isTarget())
-      ++numPos;
-  }
-
+  int numPos = calcPairQvals(combined, fdr, skipDecoysPlusOne, pi0_,
+                             nullTargetWinProb_, q_);
   return numPos;
 }
 
 void Scores::generateNegativeTrainingSet(AlgIn& data, const double cneg) {
+  addNegativeTrainingSet(data, NULL, 0u);
+}
+
+/**
+ * As generateNegativeTrainingSet, for the PSMs of the training set of a fold
+ * @param folds the cross validation folds of these PSMs
+ * @param fold the fold whose training set is generated
+ */
+void Scores::generateNegativeTrainingSet(AlgIn& data, const double cneg,
+                                         const XvalFolds& folds,
+                                         unsigned int fold) {
+  addNegativeTrainingSet(data, &folds, fold);
+}
+
+void Scores::addNegativeTrainingSet(AlgIn& data, const XvalFolds* folds,
+                                    unsigned int fold) const {
   std::size_t ix2 = 0;
-  std::vector<ScoreHolder>::const_iterator scoreIt = scores_.begin();
-  for (; scoreIt != scores_.end(); ++scoreIt) {
-    if (scoreIt->isDecoy()) {
-      data.vals[ix2] = scoreIt->pPSM->features;
+  for (size_t ix = 0; ix < score_.size(); ++ix) {
+    if (label_[ix] == LabelType::DECOY &&
+        (folds == NULL || folds->isTraining(ix, fold))) {
+      data.vals[ix2] = featureRows_[ix];
       data.Y[ix2] = -1;
       // data.C[ix2] = cneg;
       ix2++;
@@ -511,22 +807,73 @@ void Scores::generatePositiveTrainingSet(AlgIn& data,
                                          const double fdr,
                                          const double cpos,
                                          const bool trainBestPositive) {
+  addPositiveTrainingSet(data, fdr, trainBestPositive, *this, NULL, 0u);
+}
+
+/**
+ * As generatePositiveTrainingSet, for the PSMs of the training set of a fold
+ * @param folds the cross validation folds of these PSMs
+ * @param fold the fold whose training set is generated
+ */
+void Scores::generatePositiveTrainingSet(AlgIn& data,
+                                         const double fdr,
+                                         const double cpos,
+                                         const bool trainBestPositive,
+                                         const XvalFolds& folds,
+                                         unsigned int fold) {
+  if (trainBestPositive) {
+    // picking the best PSM per spectrum reorders the PSMs, so it works on a
+    // copy of the training set
+    Scores trainScores(usePi0_);
+    for (size_t ix = 0; ix < score_.size(); ++ix) {
+      if (folds.isTraining(ix, fold)) {
+        trainScores.addScoreHolder((*this)[ix]);
+      }
+    }
+    addPositiveTrainingSet(data, fdr, true, trainScores, NULL, 0u);
+  } else {
+    addPositiveTrainingSet(data, fdr, false, *this, &folds, fold);
+  }
+}
+
+void Scores::addPositiveTrainingSet(AlgIn& data,
+                                    const double fdr,
+                                    const bool trainBestPositive,
+                                    Scores& scores,
+                                    const XvalFolds* folds,
+                                    unsigned int fold) {
   std::size_t ix2 = static_cast<std::size_t>(data.negatives);
   int p = 0;
 
-  std::vector<ScoreHolder>::iterator lastUniqueIt = scores_.end();
+  size_t numScores = scores.score_.size();
   if (trainBestPositive) {
-    std::sort(scores_.begin(), scores_.end(), OrderScanLabel());
-    lastUniqueIt =
-        std::unique(scores_.begin(), scores_.end(), UniqueScanLabel());
-    std::sort(scores_.begin(), lastUniqueIt, greater<ScoreHolder>());
+    // the best PSM of each spectrum to the front, by decreasing score, and
+    // the PSMs behind them as std::unique leaves them
+    scores.sort(OrderScanLabel());
+    std::vector<uint32_t> order(numScores);
+    for (size_t ix = 0; ix < numScores; ++ix) {
+      order[ix] = static_cast<uint32_t>(ix);
+    }
+    std::vector<uint32_t>::iterator lastUniqueIt = std::unique(
+        order.begin(), order.end(), [&scores](uint32_t i, uint32_t j) {
+          return UniqueScanLabel()(scores[i], scores[j]);
+        });
+    numScores = static_cast<size_t>(lastUniqueIt - order.begin());
+    scores.selectPsms(order);
+    ScoreSorter::getDescendingOrder(scores.score_.data(), scores.psm_.data(),
+                                    scores.label_.data(), numScores, order);
+    order.resize(scores.score_.size());
+    for (size_t ix = numScores; ix < order.size(); ++ix) {
+      order[ix] = static_cast<uint32_t>(ix);
+    }
+    scores.selectPsms(order);
   }
 
-  std::vector<ScoreHolder>::const_iterator scoreIt = scores_.begin();
-  for (; scoreIt != lastUniqueIt; ++scoreIt) {
-    if (scoreIt->isTarget()) {
-      if (scoreIt->q <= fdr) {
-        data.vals[ix2] = scoreIt->pPSM->features;
+  for (size_t ix = 0; ix < numScores; ++ix) {
+    if (isTarget(scores.label_[ix]) &&
+        (folds == NULL || folds->isTraining(ix, fold))) {
+      if (scores.q_[ix] <= fdr) {
+        data.vals[ix2] = scores.featureRows_[ix];
         data.Y[ix2] = 1;
         // data.C[ix2] = cpos;
         ix2++;
@@ -551,37 +898,29 @@ void Scores::weedOutRedundant() {
 void Scores::weedOutRedundant(
     std::map<std::string, unsigned int>& peptideSpecCounts,
     double specCountQvalThreshold) {
-  // lexicographically order the scores_ (based on peptides names,labels and
+  // lexicographically order the PSMs (based on peptides names,labels and
   // scores)
-  std::sort(scores_.begin(), scores_.end(), lexicOrderProb());
-
-  /*
-   * much simpler version but it does not fill up the peptide-PSM map:
-   * scores_.erase(std::unique(scores_.begin(), scores_.end(), mycmp),
-   * scores_.end());
-   */
+  sort(lexicOrderProb());
 
   std::string previousPeptide = "";
   LabelType previousLabel = LabelType::UNDEFINED;
-  size_t lastWrittenIdx = 0u;
-  for (size_t idx = 0u; idx < scores_.size(); ++idx) {
-    std::string currentPeptide = scores_.at(idx).pPSM->getPeptideSequence();
-    LabelType currentLabel = scores_.at(idx).label;
+  std::vector<uint32_t> kept;
+  for (size_t idx = 0u; idx < score_.size(); ++idx) {
+    std::string currentPeptide = psm_[idx]->getPeptideSequence();
+    LabelType currentLabel = label_[idx];
     if (currentPeptide != previousPeptide || currentLabel != previousLabel) {
       // insert as a new score
-      scores_.at(lastWrittenIdx++) = scores_.at(idx);
+      kept.push_back(static_cast<uint32_t>(idx));
       previousPeptide = currentPeptide;
       previousLabel = currentLabel;
     }
     // append the psm
-    peptidePsmMap_[scores_.at(lastWrittenIdx - 1).pPSM].push_back(
-        scores_.at(idx).pPSM);
-    if (specCountQvalThreshold > 0.0 &&
-        scores_.at(idx).q < specCountQvalThreshold) {
+    peptidePsmMap_[psm_[kept.back()]].push_back(psm_[idx]);
+    if (specCountQvalThreshold > 0.0 && q_[idx] < specCountQvalThreshold) {
       ++peptideSpecCounts[currentPeptide];
     }
   }
-  scores_.resize(lastWrittenIdx);
+  selectPsms(kept);
   postMergeStep();
 }
 
@@ -589,30 +928,25 @@ void Scores::weedOutRedundant(
  * Routine that sees to that only unique spectra are kept for TDC
  */
 void Scores::weedOutRedundantTDC() {
-  // order the scores (based on spectra id and score)
-  std::sort(scores_.begin(), scores_.end(), OrderScanMassCharge());
-  scores_.erase(
-      std::unique(scores_.begin(), scores_.end(), UniqueScanMassCharge()),
-      scores_.end());
-
-  /* does not actually release memory because of memory fragmentation
-  double previousExpMass = 0.0;
-  unsigned int previousScan = 0u;
-  size_t lastWrittenIdx = 0u;
-  for (size_t idx = 0u; idx < scores_.size(); ++idx){
-    double currentExpMass = scores_.at(idx).pPSM->expMass;
-    int currentScan = scores_.at(idx).pPSM->scan;
-    if (currentExpMass != previousExpMass || currentScan != previousScan) {
-      // insert as a new score
-      scores_.at(lastWrittenIdx++).swap(scores_.at(idx));
-      previousScan = currentScan;
-      previousExpMass = currentExpMass;
-    } else {
-      PSMDescription::deletePtr(scores_.at(idx).pPSM);
+  // find the best scoring PSM of each spectrum in a single pass over the 
+  // dense spectrum ids, keeping the first one seen in case of ties
+  const size_t kNone = std::numeric_limits<size_t>::max();
+  std::vector<size_t> bestIdx(PSMDescription::getNumSpectrumIds(), kNone);
+  for (size_t idx = 0u; idx < score_.size(); ++idx) {
+    size_t& best = bestIdx[psm_[idx]->spectrumId];
+    if (best == kNone || score_[best] < score_[idx]) {
+      best = idx;
+    }
+  }
+  
+  std::vector<uint32_t> kept;
+  for (size_t idx = 0u; idx < score_.size(); ++idx) {
+    if (bestIdx[psm_[idx]->spectrumId] == idx) {
+      kept.push_back(static_cast<uint32_t>(idx));
     }
   }
-  scores_.resize(lastWrittenIdx);
-  */
+  selectPsms(kept);
+  
   postMergeStep();
 }
 
@@ -622,10 +956,15 @@ void Scores::weedOutRedundantTDC() {
  */
 void Scores::weedOutRedundantMixMax() {
   // order the scores (based on spectra id and score)
-  std::sort(scores_.begin(), scores_.end(), OrderScanMassLabelCharge());
-  scores_.erase(
-      std::unique(scores_.begin(), scores_.end(), UniqueScanMassLabelCharge()),
-      scores_.end());
+  sort(OrderScanMassLabelCharge());
+  std::vector<uint32_t> kept;
+  for (size_t idx = 0u; idx < score_.size(); ++idx) {
+    if (kept.empty() ||
+        !UniqueScanMassLabelCharge()((*this)[kept.back()], (*this)[idx])) {
+      kept.push_back(static_cast<uint32_t>(idx));
+    }
+  }
+  selectPsms(kept);
 
   postMergeStep();
 }
@@ -640,26 +979,61 @@ int Scores::getInitDirection(const double initialSelectionFdr,
   // is too restrictive for small datasets
   bool skipDecoysPlusOne = true;
 
+  // each feature is sorted as a column of scores and counted as a column of
+  // (score, isTarget) pairs. As when the PSMs themselves were sorted, each
+  // pass starts from the order the previous one left them in, so only the
+  // feature rows, PSMs and labels are carried along in that order
+  const size_t numScores = score_.size();
+  std::vector<uint32_t> psmOrder(numScores);
+  for (size_t ix = 0; ix < numScores; ++ix) {
+    psmOrder[ix] = static_cast<uint32_t>(ix);
+  }
+  std::vector<FeatureType*> rows(featureRows_);
+  std::vector<PSMDescription*> psms(psm_);
+  std::vector<LabelType> labels(label_);
+  std::vector<double> featureScores(numScores), qvals;
+  std::vector<pair<double, bool> > combined(numScores);
+  std::vector<uint32_t> order;
   for (unsigned int featNo = 0; featNo < FeatureNames::getNumFeatures();
        featNo++) {
-    for (std::vector<ScoreHolder>::iterator scoreIt = scores_.begin();
-         scoreIt != scores_.end(); ++scoreIt) {
-      scoreIt->score = scoreIt->pPSM->features[featNo];
+    for (size_t ix = 0; ix < numScores; ++ix) {
+      featureScores[ix] = rows[ix][featNo];
+    }
+    ScoreSorter::getAscendingOrder(featureScores.data(), psms.data(),
+                                   labels.data(), numScores, order);
+    for (size_t ix = 0; ix < numScores; ++ix) {
+      combined[ix] = pair<double, bool>(featureScores[order[ix]],
+                                        isTarget(labels[order[ix]]));
     }
-    sort(scores_.begin(), scores_.end());
     // check once in forward direction (i = 0, higher scores are better) and
     // once in backward direction (i = 1, lower scores are better)
     for (int i = 0; i < 2; i++) {
       if (i == 1) {
-        reverse(scores_.begin(), scores_.end());
+        reverse(combined.begin(), combined.end());
       }
-      int positives = calcQvals(initialSelectionFdr, skipDecoysPlusOne);
+      int positives = calcPairQvals(combined, initialSelectionFdr,
+                                    skipDecoysPlusOne, pi0_,
+                                    nullTargetWinProb_, qvals);
       if (positives > bestPositives) {
         bestPositives = positives;
         bestFeature = static_cast<int>(featNo);
         lowBest = (i == 0);
       }
     }
+    // the backward direction is the order the next pass starts from
+    reverse(order.begin(), order.end());
+    selectColumn(psmOrder, order);
+    selectColumn(rows, order);
+    selectColumn(psms, order);
+    selectColumn(labels, order);
+    selectColumn(featureScores, order);
+  }
+  // leave the PSMs scored, ordered and with the q-values of the last pass,
+  // as the training starts from that order
+  if (FeatureNames::getNumFeatures() > 0u) {
+    selectPsms(psmOrder);
+    score_.swap(featureScores);
+    q_.swap(qvals);
   }
   for (std::size_t ix = FeatureNames::getNumFeatures(); ix--;) {
     direction[ix] = 0;
@@ -729,10 +1103,10 @@ void Scores::calcPep(const bool spline, const bool interp, const bool pava) {
     if (!spline) {
         if (pava) {
             std::vector<double> target_q, sc;
-            for (auto& sh : scores_) {
-                if (sh.isTarget()) {
-                    target_q.push_back(sh.q);
-                    sc.push_back(sh.score);
+            for (size_t ix = 0; ix < score_.size(); ++ix) {
+                if (isTarget(label_[ix])) {
+                    target_q.push_back(q_[ix]);
+                    sc.push_back(score_[ix]);
                 }
             }
             InferPEP reg(false);
@@ -746,33 +1120,30 @@ void Scores::calcPep(const bool spline, const bool interp, const bool pava) {
             auto it_pep = target_pep.begin();
             auto it_q = target_q.begin();
             double l_q(0.0), l_pep(0.0);
-            for (auto& sh : scores_) {
-                if (sh.isTarget()) {
-                    sh.pep = *it_pep;
+            for (size_t ix = 0; ix < score_.size(); ++ix) {
+                if (isTarget(label_[ix])) {
+                    pep_[ix] = *it_pep;
                     // remember last (l_) pep and q for interpolation
                     l_pep = *it_pep;
                     l_q = *it_q;
                     it_pep++; it_q++;
                 } else {
-                    double pep = reg.interpolate(sh.q,l_q,*it_q,l_pep,*it_pep);
-                    sh.pep = pep;
+                    double pep = reg.interpolate(q_[ix],l_q,*it_q,l_pep,*it_pep);
+                    pep_[ix] = pep;
                 }
             }
         } else {
             std::vector<double> is_decoy, sc;
-            for (auto& sh : scores_) {
-                is_decoy.push_back(sh.isTarget()? 0.: 1.);
-                sc.push_back(sh.score);
+            for (size_t ix = 0; ix < score_.size(); ++ix) {
+                is_decoy.push_back(isTarget(label_[ix])? 0.: 1.);
+                sc.push_back(score_[ix]);
             }
             InferPEP reg(true);
             auto peps = interp
                                 ? reg.tdc_to_pep(is_decoy, sc)
                                 : reg.tdc_to_pep(is_decoy);
-            auto it_pep = peps.begin();
-            for (auto& sh : scores_) {
-                sh.pep = *it_pep;
-                it_pep++;
-            }
+            std::copy(peps.begin(), peps.begin() + score_.size(),
+                      pep_.begin());
         }
     } else {
         std::vector<pair<double, bool> > combined;
@@ -781,17 +1152,14 @@ void Scores::calcPep(const bool spline, const bool interp, const bool pava) {
         std::vector<double> peps;
         // Logistic regression on the data
         PosteriorEstimator::estimatePEP(combined, usePi0_, pi0_, peps, true);
-        for (size_t ix = 0; ix < scores_.size(); ix++) {
-            scores_[ix].pep = peps[ix];
-        }
+        std::copy(peps.begin(), peps.begin() + score_.size(), pep_.begin());
     }
 }
 
 unsigned Scores::getQvaluesBelowLevel(double level) {
   unsigned hits = 0;
-  std::vector<ScoreHolder>::const_iterator scoreIt = scores_.begin();
-  for (; scoreIt != scores_.end(); ++scoreIt) {
-    if (scoreIt->isTarget() && scoreIt->q < level) {
+  for (size_t ix = 0; ix < score_.size(); ++ix) {
+    if (isTarget(label_[ix]) && q_[ix] < level) {
       hits++;
     }
   }
@@ -25,6 +25,7 @@
 #include <cfloat>
 #include <cstdlib>
 #include <iostream>
+#include <iterator>
 #include <map>
 #include <vector>
 
@@ -36,14 +37,116 @@
 #include "PseudoRandom.h"
 #include "ScoreHolder.h"
 
-#include <boost/unordered/unordered_map.hpp>
-
 class SetHandler;
 class AlgIn;
 
 /*
- * Scores is a container of ScoreHolders that allows you to do a sorted merge
- * of vectors of ScoreHolder.
+ * XvalFolds divides the PSMs of a Scores into cross validation folds without
+ * copying them. The test set of fold i is formed by the PSMs with the indices
+ * order[foldBegins[i], foldBegins[i + 1]) and its training set by all other
+ * PSMs, or by all PSMs if there is a single fold. The test sets are evaluated
+ * with pi0 and nullTargetWinProb.
+ */
+struct XvalFolds {
+  std::vector<unsigned int> testFolds;
+  std::vector<uint32_t> order;
+  std::vector<size_t> foldBegins;
+  double pi0, nullTargetWinProb;
+
+  inline size_t numFolds() const {
+    return foldBegins.empty() ? 0u : foldBegins.size() - 1u;
+  }
+  inline bool isTraining(size_t psmIdx, unsigned int fold) const {
+    return testFolds[psmIdx] != fold || numFolds() == 1u;
+  }
+};
+
+/*
+ * PsmIterator is a random access iterator over the PSMs of a Scores, which
+ * hands out a ScoreHolderRef for each PSM, or a ScoreHolder copy for the PSMs
+ * of a const Scores.
+ */
+template <typename ScoresType, typename Reference>
+class PsmIterator {
+ public:
+  typedef std::random_access_iterator_tag iterator_category;
+  typedef ScoreHolder value_type;
+  typedef std::ptrdiff_t difference_type;
+  typedef Reference reference;
+  // holds the Reference that operator-> points to
+  class pointer {
+   public:
+    explicit pointer(const Reference& ref) : ref_(ref) {}
+    const Reference* operator->() const { return &ref_; }
+   private:
+    Reference ref_;
+  };
+
+  PsmIterator() : scores_(NULL), index_(0u) {}
+  PsmIterator(ScoresType* scores, size_t index)
+      : scores_(scores), index_(index) {}
+  // an iterator converts to a const_iterator
+  template <typename OtherScoresType, typename OtherReference>
+  PsmIterator(const PsmIterator<OtherScoresType, OtherReference>& other)
+      : scores_(other.scores_), index_(other.index_) {}
+
+  Reference operator*() const { return (*scores_)[index_]; }
+  pointer operator->() const { return pointer(**this); }
+  Reference operator[](difference_type n) const {
+    return (*scores_)[index_ + n];
+  }
+
+  PsmIterator& operator++() { ++index_; return *this; }
+  PsmIterator operator++(int) { PsmIterator it(*this); ++index_; return it; }
+  PsmIterator& operator--() { --index_; return *this; }
+  PsmIterator operator--(int) { PsmIterator it(*this); --index_; return it; }
+  PsmIterator& operator+=(difference_type n) { index_ += n; return *this; }
+  PsmIterator& operator-=(difference_type n) { index_ -= n; return *this; }
+  PsmIterator operator+(difference_type n) const {
+    return PsmIterator(scores_, index_ + n);
+  }
+  PsmIterator operator-(difference_type n) const {
+    return PsmIterator(scores_, index_ - n);
+  }
+  difference_type operator-(const PsmIterator& other) const {
+    return static_cast<difference_type>(index_) -
+           static_cast<difference_type>(other.index_);
+  }
+
+  bool operator==(const PsmIterator& other) const {
+    return index_ == other.index_;
+  }
+  bool operator!=(const PsmIterator& other) const {
+    return index_ != other.index_;
+  }
+  bool operator<(const PsmIterator& other) const {
+    return index_ < other.index_;
+  }
+  bool operator>(const PsmIterator& other) const {
+    return index_ > other.index_;
+  }
+  bool operator<=(const PsmIterator& other) const {
+    return index_ <= other.index_;
+  }
+  bool operator>=(const PsmIterator& other) const {
+    return index_ >= other.index_;
+  }
+
+ private:
+  template <typename OtherScoresType, typename OtherReference>
+  friend class PsmIterator;
+
+  ScoresType* scores_;
+  size_t index_;
+};
+
+/*
+ * Scores is a container of scored PSMs that allows you to do a sorted merge
+ * of several of them. The PSMs are stored as a structure of arrays: a column
+ * each of scores, q-values, PEPs, p-values, labels, PSMDescriptions and
+ * feature rows, so that the scoring, sorting and q-value passes only read
+ * the columns they need, front to back. The PSMs are handed out as
+ * ScoreHolderRef proxies.
  *
  * Here are some useful abbreviations:
  * FDR - False Discovery Rate
@@ -53,8 +156,8 @@ class AlgIn;
  */
 class Scores {
  public:
-  using iterator = std::vector<ScoreHolder>::iterator;
-  using const_iterator = std::vector<ScoreHolder>::const_iterator;
+  using iterator = PsmIterator<Scores, ScoreHolderRef>;
+  using const_iterator = PsmIterator<const Scores, ScoreHolder>;
 
   Scores(bool usePi0)
       : usePi0_(usePi0),
@@ -70,19 +173,43 @@ class Scores {
              std::vector<std::vector<double> >& all_w);
   void postMergeStep();
 
-  iterator begin() { return scores_.begin(); }
-  iterator end() { return scores_.end(); }
-  const_iterator begin() const { return scores_.begin(); }
-  const_iterator end() const { return scores_.end(); }
+  iterator begin() { return iterator(this, 0u); }
+  iterator end() { return iterator(this, score_.size()); }
+  const_iterator begin() const { return const_iterator(this, 0u); }
+  const_iterator end() const { return const_iterator(this, score_.size()); }
 
-  double calcScore(const double* features, const std::vector<double>& w) const;
+  inline ScoreHolderRef operator[](size_t ix) {
+    return ScoreHolderRef(score_[ix], q_[ix], pep_[ix], p_[ix], psm_[ix],
+                          label_[ix]);
+  }
+  inline ScoreHolder operator[](size_t ix) const {
+    ScoreHolder sh(score_[ix], label_[ix], psm_[ix]);
+    sh.q = q_[ix];
+    sh.pep = pep_[ix];
+    sh.p = p_[ix];
+    return sh;
+  }
+  // sorts the PSMs as std::sort with compare sorts ScoreHolders, calling
+  // compare on ScoreHolderRefs
+  template <typename Compare>
+  void sort(Compare compare);
+
+  double calcScore(const FeatureType* features, const std::vector<double>& w) const;
   void scoreAndAddPSM(ScoreHolder& sh,
                       const std::vector<double>& rawWeights,
                       FeatureMemoryPool& featurePool);
+  // adds a PSM that has already been scored, without features
+  void addScoredPSM(ScoreHolder& sh);
   int calcScoresAndQvals(vector<double>& w,
                          double fdr,
                          bool skipDecoysPlusOne = false);
   int calcScores(vector<double>& w);
+  // the return value of calcScoresAndQvals, leaving the ScoreHolders as they are
+  int countTargetsBelowFdr(const vector<double>& w, double fdr,
+                           bool skipDecoysPlusOne = false) const;
+  int countTargetsBelowFdr(const vector<double>& w, double fdr,
+                           bool skipDecoysPlusOne, const XvalFolds& folds,
+                           unsigned int fold) const;
   int calcQvals(double fdr, bool skipDecoysPlusOne = false);
   void calcPep(const bool spline = false, const bool interpol = false, const bool from_q = false);
  
@@ -96,12 +223,23 @@ class Scores {
                                 FeatureMemoryPool& featurePool,
                                 double decoyFractionTraining = 1.0,
                                 unsigned int decoysPerTarget = 1u);
+  void createXvalFoldsBySpectrum(XvalFolds& folds, unsigned int xval_fold);
+  void createSingleXvalFold(XvalFolds& folds) const;
 
   void generatePositiveTrainingSet(AlgIn& data,
                                    const double fdr,
                                    const double cpos,
                                    const bool trainBestPositive);
   void generateNegativeTrainingSet(AlgIn& data, const double cneg);
+  // as above, from the training set of one of the folds
+  void generatePositiveTrainingSet(AlgIn& data,
+                                   const double fdr,
+                                   const double cpos,
+                                   const bool trainBestPositive,
+                                   const XvalFolds& folds,
+                                   unsigned int fold);
+  void generateNegativeTrainingSet(AlgIn& data, const double cneg,
+                                   const XvalFolds& folds, unsigned int fold);
 
   void recalculateSizes();
   void normalizeScores(double fdr, std::vector<double>& weights);
@@ -127,7 +265,7 @@ class Scores {
   inline unsigned int posSize() const { return totalNumberOfTargets_; }
   inline unsigned int negSize() const { return totalNumberOfDecoys_; }
 
-  inline void addScoreHolder(const ScoreHolder& sh) { scores_.push_back(sh); }
+  void addScoreHolder(const ScoreHolder& sh);
 
   inline void setNullTargetWinProb(const double nullTargetWinProb) {
     nullTargetWinProb_ = nullTargetWinProb;
@@ -138,7 +276,7 @@ class Scores {
   }
 
   void reset() {
-    scores_.clear();
+    selectPsms(std::vector<uint32_t>());
     totalNumberOfTargets_ = 0;
     totalNumberOfDecoys_ = 0;
   }
@@ -154,17 +292,66 @@ class Scores {
   double targetDecoySizeRatio_, nullTargetWinProb_;
   unsigned int totalNumberOfDecoys_, totalNumberOfTargets_;
 
-  std::vector<ScoreHolder> scores_;
+  // the columns of the PSMs, all of the same size
+  std::vector<double> score_, q_, pep_, p_;
+  std::vector<LabelType> label_;
+  std::vector<PSMDescription*> psm_;
+  // the feature row of each PSM, as in its PSMDescription when it was added
+  // or when the rows were laid out by createXvalSetsBySpectrum
+  std::vector<FeatureType*> featureRows_;
   std::map<PSMDescription*, std::vector<PSMDescription*> > peptidePsmMap_;
 
-  void reorderFeatureRows(
-      FeatureMemoryPool& featurePool,
-      bool isTarget,
-      boost::unordered_map<double*, double*>& movedAddresses,
-      size_t& idx);
+  void appendFeatureRowPsms(bool isTarget, std::vector<PSMDescription*>& psms);
   void getScoreLabelPairs(std::vector<std::pair<double, bool> >& combined);
+  static inline bool isTarget(LabelType label) {
+    return label == LabelType::TARGET || label == LabelType::PSEUDO_TARGET;
+  }
+  // keeps the PSMs with the indices in order, in that order, moving each
+  // column once
+  void selectPsms(const std::vector<uint32_t>& order);
+  void appendPsms(const Scores& other);
+  void sortDescending();
+  void refreshFeatureRows();
+  // the q-values of sorted (score, isTarget) pairs
+  static int calcPairQvals(
+      const std::vector<std::pair<double, bool> >& combined, double fdr,
+      bool skipDecoysPlusOne, double pi0, double nullTargetWinProb,
+      std::vector<double>& qvals);
+  static int countTargetsBelowFdr(const std::vector<FeatureType*>& rows,
+                                  const std::vector<LabelType>& labels,
+                                  const std::vector<double>& w, double fdr,
+                                  bool skipDecoysPlusOne, double pi0,
+                                  double nullTargetWinProb);
+
+  bool assignXvalFoldsBySpectrum(unsigned int xval_fold,
+                                 double decoyFractionTraining,
+                                 std::vector<unsigned int>& testFolds,
+                                 std::vector<bool>& pseudoTargets);
+  // the training sets of all PSMs, or of the training set of a fold
+  void addNegativeTrainingSet(AlgIn& data, const XvalFolds* folds,
+                              unsigned int fold) const;
+  static void addPositiveTrainingSet(AlgIn& data, const double fdr,
+                                     const bool trainBestPositive,
+                                     Scores& scores,
+                                     const XvalFolds* folds,
+                                     unsigned int fold);
   void checkSeparationAndSetPi0();
   bool is_output_rt_ = false;
 };
 
+template <typename Compare>
+void Scores::sort(Compare compare) {
+  // std::sort makes the same comparisons on the indices as on ScoreHolders,
+  // so the PSMs end up in the same order
+  std::vector<uint32_t> order(score_.size());
+  for (size_t ix = 0; ix < order.size(); ++ix) {
+    order[ix] = static_cast<uint32_t>(ix);
+  }
+  std::sort(order.begin(), order.end(), [this, &compare](uint32_t i,
+                                                        uint32_t j) {
+    return compare((*this)[i], (*this)[j]);
+  });
+  selectPsms(order);
+}
+
 #endif /*SCORES_H_*/
@@ -17,13 +17,27 @@
 
 #include "SetHandler.h"
 
-SetHandler::SetHandler(unsigned int maxPSMs) : maxPSMs_(maxPSMs) {}
+#include <cmath>
+
+#include "LinearScorer.h"
+
+const size_t SetHandler::kReadBlockSize;
+
+SetHandler::SetHandler(unsigned int maxPSMs) : maxPSMs_(maxPSMs), 
+    subsetHashSampling_(false), detectDecoyPrefix_(false), hasDecoyProteins_(false) {}
 
 SetHandler::~SetHandler() {
   reset();
 }
 
 void SetHandler::reset() {
+  deleteSubsets();
+  psmSpill_.reset();
+  featureStats_.reset(0u);
+  DataSet::resetFeatureNames();
+}
+
+void SetHandler::deleteSubsets() {
   for (unsigned int ix = 0; ix < subsets_.size(); ix++) {
     if (subsets_[ix] != NULL) {
       delete subsets_[ix];
@@ -31,7 +45,7 @@ void SetHandler::reset() {
     subsets_[ix] = NULL;
   }
   subsets_.clear();
-  DataSet::resetFeatureNames();
+  psmArena_.clear();
 }
 /**
  * Gets the vector index of the DataSet matching the label
@@ -55,21 +69,68 @@ void SetHandler::push_back_dataset( DataSet * ds ) {
   subsets_.push_back(ds);
 }
 
+void SetHandler::setDecoyPrefix(std::string& decoyPrefix) {
+  detectDecoyPrefix_ = (decoyPrefix == "auto");
+  // the detected prefix is shared by all decoy proteins, so there is nothing
+  // to warn about while parsing
+  decoyPrefix_ = detectDecoyPrefix_ ? "" : decoyPrefix;
+}
+
+/**
+ * Returns the decoy prefix set by setDecoyPrefix(), or if that was "auto", the
+ * longest common prefix of the first protein of all decoy PSMs read, cut 
+ * after its first underscore (e.g. "decoy_").
+ */
+std::string SetHandler::getDecoyPrefix() const {
+  if (!detectDecoyPrefix_) return decoyPrefix_;
+  std::string prefix = decoyProteinsCommonPrefix_;
+  size_t loc = prefix.find("_");
+  if (loc != std::string::npos) {
+    prefix = prefix.substr(0, loc + 1);
+  }
+  return prefix;
+}
+
+void SetHandler::addToDecoyPrefix(PSMDescription* decoyPsm) {
+  if (!detectDecoyPrefix_) return;
+  // a view of the first protein, so that deferred proteins stay undecoded
+  StringRef proteinId = decoyPsm->getFirstProteinName();
+  if (proteinId.empty()) return;
+  if (!hasDecoyProteins_) {
+    decoyProteinsCommonPrefix_ = proteinId.str();
+    hasDecoyProteins_ = true;
+  } else {
+    size_t len = 0u;
+    size_t maxLen = std::min(decoyProteinsCommonPrefix_.size(), proteinId.size());
+    while (len < maxLen && decoyProteinsCommonPrefix_[len] == proteinId[len]) {
+      ++len;
+    }
+    decoyProteinsCommonPrefix_.resize(len);
+  }
+}
+
 void SetHandler::populateScoresWithPSMs(vector<ScoreHolder> &scores, LabelType label) {
   subsets_[getSubsetIndexFromLabel(label)]->fillScores(scores);
 }
 
 void SetHandler::normalizeFeatures(Normalizer*& pNorm) {
-  std::vector<double*> featuresV, rtFeaturesV;
+  std::vector<FeatureType*> featuresV, rtFeaturesV;
   for (unsigned int ix = 0; ix < subsets_.size(); ++ix) {
     subsets_[ix]->fillFeatures(featuresV);
   }
   pNorm = Normalizer::getNormalizer();
 
-  pNorm->setSet(featuresV,
-      rtFeaturesV,
-      FeatureNames::getNumFeatures(),
-      0);
+  // the statistics gathered while parsing cover all rows unless some were
+  // read in another way, e.g. from a pin cache or as a sampled subset
+  if (featureStats_.getNumRows() == featuresV.size() &&
+      featureStats_.getNumFeatures() == FeatureNames::getNumFeatures()) {
+    pNorm->setStatistics(featureStats_);
+  } else {
+    pNorm->setSet(featuresV,
+        rtFeaturesV,
+        FeatureNames::getNumFeatures(),
+        0);
+  }
   pNorm->normalizeSet(featuresV, rtFeaturesV);
 }
 
@@ -84,6 +145,86 @@ int SetHandler::readTab(istream& dataStream, SanityCheck*& pCheck) {
   return readAndScoreTab(dataStream, noWeights, noScores, pCheck);
 }
 
+bool SetHandler::readCache(const std::string& cacheFN, 
+    const std::string& signature, SanityCheck*& pCheck) {
+  std::unique_ptr<PinCache> pinCache(new PinCache());
+  if (!pinCache->open(cacheFN, signature)) return false;
+  hasDecoyProteins_ = false;
+  decoyProteinsCommonPrefix_.clear();
+  
+  std::vector<std::string> names;
+  pinCache->getFeatureNames(names);
+  FeatureNames& featureNames = DataSet::getFeatureNames();
+  for (size_t i = 0; i < names.size(); ++i) {
+    featureNames.insertFeature(names[i]);
+  }
+  featureNames.initFeatures();
+  featurePool_.createPool(DataSet::getNumFeatures());
+  // the feature rows are used in place, they are only copied once written to
+  featurePool_.adoptBlocks(pinCache->getFeatureBlocks(), pinCache->getNumPsms());
+  
+  // the spectrum file names are registered in the order they were first seen
+  std::vector<std::string> specFileNames;
+  pinCache->getSpectrumFileNames(specFileNames);
+  std::vector<unsigned int> specFileNrs(specFileNames.size());
+  PSMDescription specFileLookUp;
+  for (size_t i = 0; i < specFileNames.size(); ++i) {
+    specFileLookUp.setSpectrumFileName(specFileNames[i]);
+    specFileNrs[i] = specFileLookUp.specFileNr;
+  }
+  
+  DataSet* targetSet = new DataSet();
+  assert(targetSet);
+  targetSet->setLabel(LabelType::TARGET);
+  DataSet* decoySet = new DataSet();
+  assert(decoySet);
+  decoySet->setLabel(LabelType::DECOY);
+  for (size_t i = 0; i < pinCache->getNumPsms(); ++i) {
+    PSMDescription* myPsm = NULL;
+    LabelType label = pinCache->readPsm(i, psmArena_, myPsm);
+    myPsm->features = featurePool_.addressFromIdx(static_cast<unsigned int>(i));
+    if (!specFileNrs.empty()) myPsm->specFileNr = specFileNrs.at(myPsm->specFileNr);
+    if (label == LabelType::TARGET) {
+      targetSet->registerPsm(myPsm);
+    } else {
+      decoySet->registerPsm(myPsm);
+      addToDecoyPrefix(myPsm);
+    }
+  }
+  if (VERB > 1) {
+    std::cerr << "Found " << pinCache->getNumPsms() << " PSMs" << std::endl;
+  }
+  push_back_dataset(targetSet);
+  push_back_dataset(decoySet);
+  
+  std::vector<double> init_values;
+  pinCache->getDefaultWeights(init_values);
+  pCheck = new SanityCheck();
+  pCheck->checkAndSetDefaultDir();
+  if (!init_values.empty()) pCheck->addDefaultWeights(init_values);
+  pCheck->setConcatenatedSearch(pinCache->concatenatedSearch());
+  
+  pinCache_ = std::move(pinCache);
+  return true;
+}
+
+bool SetHandler::writeCache(const std::string& cacheFN, 
+    const std::string& signature, SanityCheck* pCheck) {
+  std::vector<PSMDescription*> psms;
+  std::vector<LabelType> labels;
+  for (unsigned int ix = 0; ix < subsets_.size(); ++ix) {
+    const std::vector<PSMDescription*>& subsetPsms = subsets_[ix]->getPsms();
+    psms.insert(psms.end(), subsetPsms.begin(), subsetPsms.end());
+    labels.resize(psms.size(), subsets_[ix]->getLabel());
+  }
+  std::vector<std::string> featureNames;
+  for (unsigned int i = 0; i < DataSet::getNumFeatures(); ++i) {
+    featureNames.push_back(DataSet::getFeatureNames().getFeatureName(i));
+  }
+  return PinCache::write(cacheFN, signature, featureNames, 
+      pCheck->getDefaultWeights(), pCheck->concatenatedSearch(), psms, labels);
+}
+
 int SetHandler::getOptionalFields(const std::string& headerLine, 
     std::vector<OptionalField>& optionalFields) {
   TabReader reader(headerLine);
@@ -228,10 +369,53 @@ void SetHandler::readPSMs(istream& dataStream, std::string& psmLine,
     } else {
       throw MyException(temp.str());
     }
+  } else if (maxPSMs_ > 0u && subsetHashSampling_ && 
+             dynamic_cast<MemoryMappedFile*>(dataStream.rdbuf()) != NULL) {
+    // keep the spectra whose hashed ScanId falls below the fraction of PSMs
+    // to train on, which is decided per line before the rest of it is parsed
+    MemoryMappedFile* mappedFile = 
+        dynamic_cast<MemoryMappedFile*>(dataStream.rdbuf());
+    size_t numPsms = 1u + countLines(mappedFile->readPosition(), 
+                                     mappedFile->endPosition());
+    uint64_t sampleThreshold = UINT64_MAX;
+    double scaledFraction = std::ldexp(
+        static_cast<double>(maxPSMs_) / static_cast<double>(numPsms), 64);
+    if (scaledFraction < std::ldexp(1.0, 64)) {
+      sampleThreshold = static_cast<uint64_t>(scaledFraction);
+    }
+    uint64_t sampleSeed = PseudoRandom::getSeed();
+    std::vector<unsigned char> spectrumLabels;
+    forEachPsmBlock(dataStream, psmLine, 
+        [&](const char* blockBegin, const char* blockEnd, bool mappedLines) {
+          readPsmBlock(blockBegin, blockEnd, lineNr, concatenatedSearch, 
+                       optionalFields, spectrumLabels, targetSet, decoySet,
+                       mappedLines, sampleSeed, sampleThreshold);
+        });
   } else if (maxPSMs_ > 0u) { // reservoir sampling to create subset of size maxPSMs_
+    // a memory mapped file is read again for the rescoring, in parallel by
+    // readAndScoreTab; any other input is parsed completely here and every
+    // PSM goes to the spill, so that it does not have to be read again
+    bool spillPsms = 
+        (dynamic_cast<MemoryMappedFile*>(dataStream.rdbuf()) == NULL);
+    size_t numFeatures = FeatureNames::getNumFeatures();
+    if (spillPsms) psmSpill_.reset(new PSMSpill());
+    if (spillPsms && !psmSpill_->open(numFeatures)) {
+      psmSpill_.reset();
+      ostringstream temp;
+      temp << "ERROR: Could not create a temporary file for the PSMs that "
+          << "are not in the training subset." << std::endl;
+      throw MyException(temp.str());
+    }
+    PSMDescription psm;
+    std::vector<FeatureType> featureRow(std::max<size_t>(numFeatures, 1u));
+    std::vector<std::string> proteinNames;
+    std::vector<unsigned int> proteinIds;
     std::priority_queue<PSMDescriptionPriority> subsetPSMs;
-    // ScanId -> (priority, isDecoy)
-    std::map<ScanId, std::pair<size_t, bool> > scanIdLookUp;
+    // dense ids for the ScanIds, indexing the priority and isDecoy vectors;
+    // the spectrum file is not read at this point
+    SpectrumIdTable scanIds;
+    std::vector<size_t> scanPriorities;
+    std::vector<bool> scanIsDecoy;
     unsigned int upperLimit = UINT_MAX;
     do {
       if (lineNr % 1000000 == 0 && VERB > 1) {
@@ -240,32 +424,61 @@ void SetHandler::readPSMs(istream& dataStream, std::string& psmLine,
       psmLine = rtrim(psmLine);
       
       int label = 0;
-      ScanId scanId = getScanId(psmLine, label, optionalFields, lineNr);
+      ScanId scanId = getScanId(psmLine.data(), psmLine.size(), label, 
+                                optionalFields, lineNr);
       bool isDecoy = (label == -1);
+      unsigned int scanIdx = scanIds.intern(0u, 
+          static_cast<unsigned int>(scanId.first), scanId.second);
       size_t randIdx;
-      if (scanIdLookUp.find(scanId) != scanIdLookUp.end()) {
-        if (concatenatedSearch && isDecoy != scanIdLookUp[scanId].second) {
+      if (scanIdx < scanPriorities.size()) {
+        if (concatenatedSearch && isDecoy != scanIsDecoy[scanIdx]) {
           concatenatedSearch = false;
         }
-        randIdx = scanIdLookUp[scanId].first;
+        randIdx = scanPriorities[scanIdx];
       } else {
         randIdx = PseudoRandom::lcg_rand();
-        scanIdLookUp[scanId].first = randIdx;
-        scanIdLookUp[scanId].second = isDecoy;
+        scanPriorities.push_back(randIdx);
+        scanIsDecoy.push_back(isDecoy);
+      }
+      
+      LabelType psmLabel = LabelType::UNDEFINED;
+      if (spillPsms) {
+        bool readProteins = true;
+        psmLabel = DataSet::readPsm(psmLine.data(), psmLine.size(), lineNr, 
+            optionalFields, readProteins, &psm, &featureRow[0], NULL, 
+            &proteinNames, decoyPrefix_);
+        proteinIds.resize(proteinNames.size());
+        for (size_t i = 0; i < proteinNames.size(); ++i) {
+          proteinIds[i] = PSMDescription::internProteinName(proteinNames[i]);
+        }
+        psmSpill_->add(psm, &featureRow[0], psmLabel, proteinIds);
       }
       
       if (subsetPSMs.size() < maxPSMs_ || randIdx < upperLimit) {
+        // the training PSMs do not need their proteins
         PSMDescriptionPriority psmPriority;
-        bool readProteins = false;
-        psmPriority.label = DataSet::readPsm(psmLine, lineNr, optionalFields, 
-                                 readProteins, psmPriority.psm, featurePool_, decoyPrefix_);
+        if (spillPsms) {
+          psmPriority.psm = psmArena_.create();
+          *psmPriority.psm = psm;
+          psmPriority.psm->clear();
+          psmArena_.storeStrings(psmPriority.psm);
+          psmPriority.psm->features = featurePool_.allocate();
+          std::copy(featureRow.begin(), featureRow.begin() + numFeatures, 
+                    psmPriority.psm->features);
+          psmPriority.label = psmLabel;
+        } else {
+          bool readProteins = false;
+          psmPriority.label = DataSet::readPsm(psmLine, lineNr, optionalFields, 
+              readProteins, psmPriority.psm, featurePool_, psmArena_, 
+              decoyPrefix_);
+        }
         psmPriority.priority = randIdx;
         subsetPSMs.push(psmPriority);
         if (subsetPSMs.size() > maxPSMs_) {
           PSMDescriptionPriority del = subsetPSMs.top();
           upperLimit = static_cast<unsigned int>(del.priority);
           featurePool_.deallocate(del.psm->features);
-          PSMDescription::deletePtr(del.psm);
+          psmArena_.release(del.psm);
           subsetPSMs.pop();
         }
       }
@@ -273,33 +486,15 @@ void SetHandler::readPSMs(istream& dataStream, std::string& psmLine,
     } while (getline(dataStream, psmLine));
     
     addQueueToSets(subsetPSMs, targetSet, decoySet);
-  } else { // simply read all PSMs
-    std::map<ScanId, bool> scanIdLookUp; // ScanId -> isDecoy
-    do {
-      if (lineNr % 1000000 == 0 && VERB > 1) {
-        std::cerr << "Reading line " << lineNr << std::endl;
-      }
-      psmLine = rtrim(psmLine);
-      int label = 0;
-      ScanId scanId = getScanId(psmLine, label, optionalFields, lineNr);
-      bool isDecoy = (label == -1);
-      if (scanIdLookUp.find(scanId) != scanIdLookUp.end()) {
-        if (concatenatedSearch && isDecoy != scanIdLookUp[scanId]) {
-          concatenatedSearch = false;
-        }
-      } else {
-        scanIdLookUp[scanId] = isDecoy;
-      }
-      if (label == 1) {
-        targetSet->readPsm(psmLine, lineNr, optionalFields, featurePool_, decoyPrefix_);
-      } else if (label == -1) {
-        decoySet->readPsm(psmLine, lineNr, optionalFields, featurePool_, decoyPrefix_);
-      } else {
-        std::cerr << "Warning: the PSM on line " << lineNr
-            << " has a label not in {1,-1} and will be ignored." << std::endl;
-      }
-      ++lineNr;
-    } while (getline(dataStream, psmLine));
+  } else { // simply read all PSMs, parsing blocks of lines in parallel
+    // spectrumId -> kSeenTarget | kSeenDecoy
+    std::vector<unsigned char> spectrumLabels;
+    forEachPsmBlock(dataStream, psmLine, 
+        [&](const char* blockBegin, const char* blockEnd, bool mappedLines) {
+          readPsmBlock(blockBegin, blockEnd, lineNr, concatenatedSearch, 
+                       optionalFields, spectrumLabels, targetSet, decoySet,
+                       mappedLines);
+        });
   }
   
   if (VERB > 1) {
@@ -310,6 +505,260 @@ void SetHandler::readPSMs(istream& dataStream, std::string& psmLine,
   push_back_dataset(decoySet);
 }
 
+/**
+ * Calls parseBlock(blockBegin, blockEnd, mappedLines) for consecutive blocks 
+ * of about kReadBlockSize bytes of complete PSM lines, starting with the 
+ * already read firstLine. Memory mapped input is handed over without copying,
+ * with mappedLines set: those lines stay valid as long as the stream does.
+ */
+template <typename BlockParser>
+void SetHandler::forEachPsmBlock(istream& dataStream, 
+    const std::string& firstLine, BlockParser parseBlock) {
+  MemoryMappedFile* mappedFile = 
+      dynamic_cast<MemoryMappedFile*>(dataStream.rdbuf());
+  if (mappedFile != NULL) {
+    // parse straight from the mapped file, the first PSM line has already 
+    // been consumed though
+    parseBlock(firstLine.data(), firstLine.data() + firstLine.size(), false);
+    const char* blockBegin = mappedFile->readPosition();
+    const char* fileEnd = mappedFile->endPosition();
+    while (blockBegin < fileEnd) {
+      const char* blockEnd = blockBegin + 
+          std::min(kReadBlockSize, static_cast<size_t>(fileEnd - blockBegin));
+      if (blockEnd < fileEnd) {
+        const char* lineEnd = static_cast<const char*>(memchr(blockEnd - 1, 
+            '\n', static_cast<size_t>(fileEnd - blockEnd) + 1u));
+        blockEnd = (lineEnd == NULL) ? fileEnd : lineEnd + 1;
+      }
+      parseBlock(blockBegin, blockEnd, true);
+      blockBegin = blockEnd;
+    }
+    mappedFile->consume(fileEnd);
+  } else {
+    std::string block(firstLine);
+    block.push_back('\n');
+    bool moreData = true;
+    do {
+      moreData = readBlock(dataStream, block);
+      parseBlock(block.data(), block.data() + block.size(), false);
+      block.clear();
+    } while (moreData);
+  }
+}
+
+/**
+ * Appends up to kReadBlockSize bytes of the stream to block, followed by the
+ * remainder of the line that was cut off, so that the block only contains
+ * complete lines.
+ * @return false if the end of the stream was reached
+ */
+bool SetHandler::readBlock(istream& dataStream, std::string& block) {
+  size_t oldSize = block.size();
+  block.resize(oldSize + kReadBlockSize);
+  dataStream.read(&block[oldSize], static_cast<std::streamsize>(kReadBlockSize));
+  block.resize(oldSize + static_cast<size_t>(dataStream.gcount()));
+  std::string lineRemainder;
+  if (block.size() > 0 && block[block.size() - 1] != '\n' && 
+      getline(dataStream, lineRemainder)) {
+    block += lineRemainder;
+    block.push_back('\n');
+  }
+  return dataStream.good();
+}
+
+void SetHandler::splitLines(const char* blockBegin, const char* blockEnd,
+    std::vector<std::pair<const char*, size_t> >& lines) {
+  const char* lineStart = blockBegin;
+  while (lineStart < blockEnd) {
+    const char* lineEnd = static_cast<const char*>(
+        memchr(lineStart, '\n', static_cast<size_t>(blockEnd - lineStart)));
+    if (lineEnd == NULL) lineEnd = blockEnd;
+    lines.push_back(std::make_pair(lineStart, 
+                                   static_cast<size_t>(lineEnd - lineStart)));
+    lineStart = lineEnd + 1;
+  }
+}
+
+size_t SetHandler::countLines(const char* begin, const char* end) {
+  size_t numLines = 0u;
+  while (begin < end) {
+    const char* lineEnd = static_cast<const char*>(
+        memchr(begin, '\n', static_cast<size_t>(end - begin)));
+    ++numLines;
+    if (lineEnd == NULL) break;
+    begin = lineEnd + 1;
+  }
+  return numLines;
+}
+
+namespace {
+struct ParsedPsmLine {
+  PSMDescription* psm;
+  int label;
+  std::string spectrumFileName;
+  std::vector<std::string> proteinNames;
+  
+  ParsedPsmLine() : psm(NULL), label(0) {}
+};
+
+const unsigned char kSeenTarget = 1u, kSeenDecoy = 2u;
+
+// splitmix64 finalizer over the seed and the ScanId, the bits of the mass
+// are used as is since the same ScanId is always written the same way
+inline uint64_t hashScanId(uint64_t seed, const ScanId& scanId) {
+  uint64_t massBits;
+  std::memcpy(&massBits, &scanId.second, sizeof(massBits));
+  uint64_t h = seed ^ (static_cast<uint64_t>(
+      static_cast<uint32_t>(scanId.first)) * 0x9e3779b97f4a7c15ull);
+  h ^= massBits + 0x9e3779b97f4a7c15ull + (h << 6) + (h >> 2);
+  h = (h ^ (h >> 30)) * 0xbf58476d1ce4e5b9ull;
+  h = (h ^ (h >> 27)) * 0x94d049bb133111ebull;
+  return h ^ (h >> 31);
+}
+}
+
+/**
+ * Parses the PSM lines in [blockBegin, blockEnd) concurrently and then adds
+ * them to the target and decoy sets in input order, so that the result does
+ * not depend on the number of threads. Feature rows and spectrum file numbers 
+ * are assigned in input order as well.
+ * @param lineNr line number of the first line in the block, is advanced past 
+ *   the last line of the block
+ * @param spectrumLabels per spectrumId, whether targets and/or decoys were 
+ *   seen for it; a spectrum with both means the search was not concatenated
+ * @param mappedLines the lines outlive the PSMs, which then keep views of 
+ *   their ids, peptides and protein columns instead of copies; the proteins 
+ *   are only decoded when they are first used
+ * @param sampleSeed, sampleThreshold only the lines whose ScanId hashes to at
+ *   most sampleThreshold are read, the others are skipped without parsing
+ *   more than their first columns
+ */
+void SetHandler::readPsmBlock(const char* blockBegin, const char* blockEnd,
+    unsigned int& lineNr, bool& concatenatedSearch,
+    std::vector<OptionalField>& optionalFields,
+    std::vector<unsigned char>& spectrumLabels,
+    DataSet* targetSet, DataSet* decoySet, bool mappedLines,
+    uint64_t sampleSeed, uint64_t sampleThreshold) {
+  std::vector<std::pair<const char*, size_t> > lines;
+  splitLines(blockBegin, blockEnd, lines);
+  
+  int numLines = static_cast<int>(lines.size());
+  std::vector<unsigned char> sampled(lines.size(), 1u);
+  if (sampleThreshold < UINT64_MAX) {
+#pragma omp parallel for schedule(dynamic, 1024)
+    for (int i = 0; i < numLines; ++i) {
+      try {
+        int label = 0;
+        size_t lineLength = rtrimmedLength(lines[i].first, lines[i].second);
+        ScanId scanId = getScanId(lines[i].first, lineLength, label, 
+            optionalFields, lineNr + static_cast<unsigned int>(i));
+        sampled[i] = (hashScanId(sampleSeed, scanId) <= sampleThreshold);
+      } catch (const MyException&) {
+        // kept, so that the error is reported when the line is read
+      }
+    }
+  }
+  
+  std::vector<ParsedPsmLine> parsedLines(lines.size());
+  std::vector<FeatureType*> featureRows(lines.size(), NULL);
+  std::vector<PSMDescription*> psms(lines.size(), NULL);
+  for (int i = 0; i < numLines; ++i) {
+    if (sampled[i]) {
+      featureRows[i] = featurePool_.allocate();
+      psms[i] = psmArena_.create();
+    }
+  }
+  
+  bool hasSpectrumFileName = (std::find(optionalFields.begin(), 
+      optionalFields.end(), FILENAME) != optionalFields.end());
+  bool readProteins = true;
+  int firstErrorLine = numLines;
+  std::string firstError;
+  // the feature statistics are gathered per chunk of lines while the rows
+  // are in cache, and merged in line order to not depend on the threads
+  const int kChunkSize = 1024;
+  int numChunks = (numLines + kChunkSize - 1) / kChunkSize;
+  std::vector<FeatureStatistics> chunkStats(static_cast<size_t>(numChunks),
+      FeatureStatistics(featureStats_.getNumFeatures()));
+#pragma omp parallel for schedule(dynamic, 1)
+  for (int chunk = 0; chunk < numChunks; ++chunk) {
+    int chunkEnd = std::min(numLines, (chunk + 1) * kChunkSize);
+    for (int i = chunk * kChunkSize; i < chunkEnd; ++i) {
+      if (!sampled[i]) continue;
+      ParsedPsmLine& parsedLine = parsedLines[i];
+      unsigned int psmLineNr = lineNr + static_cast<unsigned int>(i);
+      try {
+        const char* psmLine = lines[i].first;
+        size_t lineLength = rtrimmedLength(psmLine, lines[i].second);
+        getScanId(psmLine, lineLength, parsedLine.label, optionalFields, 
+                  psmLineNr);
+        if (parsedLine.label == 1 || parsedLine.label == -1) {
+          parsedLine.psm = psms[i];
+          DataSet::readPsm(psmLine, lineLength, psmLineNr, optionalFields, 
+              readProteins, parsedLine.psm, featureRows[i], 
+              hasSpectrumFileName ? &parsedLine.spectrumFileName : NULL, 
+              &parsedLine.proteinNames, decoyPrefix_, mappedLines);
+          chunkStats[chunk].add(featureRows[i]);
+        }
+      } catch (const MyException& e) {
+#pragma omp critical (read_psm_block_error)
+        if (i < firstErrorLine) {
+          firstErrorLine = i;
+          firstError = e.what();
+        }
+      }
+    }
+  }
+  
+  if (firstErrorLine < numLines) {
+    for (int i = 0; i < numLines; ++i) {
+      if (featureRows[i] != NULL) featurePool_.deallocate(featureRows[i]);
+    }
+    throw MyException(firstError);
+  }
+  for (int chunk = 0; chunk < numChunks; ++chunk) {
+    featureStats_.merge(chunkStats[chunk]);
+  }
+  
+  for (int i = 0; i < numLines; ++i) {
+    if (lineNr % 1000000 == 0 && VERB > 1) {
+      std::cerr << "Reading line " << lineNr << std::endl;
+    }
+    ParsedPsmLine& parsedLine = parsedLines[i];
+    if (!sampled[i]) {
+      // not in the training subset
+    } else if (parsedLine.psm != NULL) {
+      if (hasSpectrumFileName) {
+        parsedLine.psm->setSpectrumFileName(parsedLine.spectrumFileName);
+      }
+      if (!mappedLines) {
+        psmArena_.storeStrings(parsedLine.psm);
+        parsedLine.psm->setProteins(parsedLine.proteinNames);
+      }
+      if (parsedLine.label == 1) {
+        targetSet->registerPsm(parsedLine.psm);
+      } else {
+        addToDecoyPrefix(parsedLine.psm);
+        decoySet->registerPsm(parsedLine.psm);
+      }
+      unsigned int spectrumId = parsedLine.psm->spectrumId;
+      if (spectrumId >= spectrumLabels.size()) {
+        spectrumLabels.resize(PSMDescription::getNumSpectrumIds(), 0u);
+      }
+      spectrumLabels[spectrumId] |= 
+          (parsedLine.label == 1 ? kSeenTarget : kSeenDecoy);
+      if (spectrumLabels[spectrumId] == (kSeenTarget | kSeenDecoy)) {
+        concatenatedSearch = false;
+      }
+    } else {
+      std::cerr << "Warning: the PSM on line " << lineNr
+          << " has a label not in {1,-1} and will be ignored." << std::endl;
+      featurePool_.deallocate(featureRows[i]);
+    }
+    ++lineNr;
+  }
+}
+
 void SetHandler::addQueueToSets(
     std::priority_queue<PSMDescriptionPriority>& subsetPSMs,
     DataSet* targetSet, DataSet* decoySet) {
@@ -323,16 +772,16 @@ void SetHandler::addQueueToSets(
       std::cerr << "Warning: the PSM " << psmPriority.psm->getId()
           << " has a label not in {1,-1} and will be ignored." << std::endl;
       featurePool_.deallocate(psmPriority.psm->features);
-      PSMDescription::deletePtr(psmPriority.psm);
+      psmArena_.release(psmPriority.psm);
     }
     subsetPSMs.pop();
   }
 }
 
-ScanId SetHandler::getScanId(const std::string& psmLine, int& label,
+ScanId SetHandler::getScanId(const char* psmLine, size_t lineLength, int& label,
     std::vector<OptionalField>& optionalFields, unsigned int lineNr) {
   ScanId scanId;
-  TabReader reader(psmLine);
+  TabReader reader(psmLine, lineLength);
   
   reader.skip();
   if (reader.error()) {
@@ -429,6 +878,9 @@ int SetHandler::readAndScoreTab(istream& dataStream,
     std::cerr << "ERROR: Cannot open data stream." << std::endl;
     return 0;
   }
+  hasDecoyProteins_ = false;
+  decoyProteinsCommonPrefix_.clear();
+
   std::string psmLine, headerLine, defaultDirectionLine;
   
   getline(dataStream, headerLine); // line with feature names
@@ -471,6 +923,7 @@ int SetHandler::readAndScoreTab(istream& dataStream,
   } else {
     featurePool_.createPool(DataSet::getNumFeatures());
   }  
+  featureStats_.reset(DataSet::getNumFeatures());
   
   // fill in the default weights if present
   std::vector<double> init_values;
@@ -513,24 +966,183 @@ void SetHandler::readAndScorePSMs(istream& dataStream, std::string& psmLine,
     bool hasInitialValueRow, std::vector<OptionalField>& optionalFields, 
     std::vector<double>& rawWeights, Scores& allScores) {
   unsigned int lineNr = (hasInitialValueRow ? 3u : 2u);
+  psmLine = rtrim(psmLine);
+  forEachPsmBlock(dataStream, psmLine, 
+      [&](const char* blockBegin, const char* blockEnd, bool mappedLines) {
+        scorePsmBlock(blockBegin, blockEnd, lineNr, optionalFields, 
+                      rawWeights, allScores, mappedLines);
+      });
+  
+  if (VERB > 1) {
+    std::cerr << "Found " << lineNr - (hasInitialValueRow ? 3u : 2u) << " PSMs" << std::endl;
+  }
+}
+
+/**
+ * Score-only counterpart of readPsmBlock: the PSM lines in [blockBegin, 
+ * blockEnd) are parsed and scored with rawWeights concurrently, each thread 
+ * reusing the feature rows of a chunk of lines that are scored as a batch by 
+ * LinearScorer, and are then added to allScores in input order. No feature 
+ * rows are kept, so the memory use is bounded by the block.
+ */
+void SetHandler::scorePsmBlock(const char* blockBegin, const char* blockEnd,
+    unsigned int& lineNr, std::vector<OptionalField>& optionalFields,
+    const std::vector<double>& rawWeights, Scores& allScores, 
+    bool mappedLines) {
+  std::vector<std::pair<const char*, size_t> > lines;
+  splitLines(blockBegin, blockEnd, lines);
+  
+  int numLines = static_cast<int>(lines.size());
+  std::vector<ParsedPsmLine> parsedLines(lines.size());
+  std::vector<double> scores(lines.size());
+  for (int i = 0; i < numLines; ++i) {
+    parsedLines[i].psm = psmArena_.create();
+  }
+  
+  bool hasSpectrumFileName = (std::find(optionalFields.begin(), 
+      optionalFields.end(), FILENAME) != optionalFields.end());
+  const size_t numFeatures = FeatureNames::getNumFeatures();
   bool readProteins = true;
-  do {
+  int firstErrorLine = numLines;
+  std::string firstError;
+  // the lines are parsed per chunk into the rows of the thread, which are
+  // then scored together
+  const int kChunkSize = 1024;
+  int numChunks = (numLines + kChunkSize - 1) / kChunkSize;
+#pragma omp parallel
+  {
+    const size_t rowStride = std::max<size_t>(numFeatures, 1u);
+    std::vector<FeatureType> featureRows(rowStride * kChunkSize, 0);
+    std::vector<const FeatureType*> rows(kChunkSize);
+    for (int i = 0; i < kChunkSize; ++i) {
+      rows[i] = &featureRows[rowStride * i];
+    }
+#pragma omp for schedule(dynamic, 1)
+    for (int chunk = 0; chunk < numChunks; ++chunk) {
+      int chunkBegin = chunk * kChunkSize;
+      int chunkEnd = std::min(numLines, chunkBegin + kChunkSize);
+      for (int i = chunkBegin; i < chunkEnd; ++i) {
+        ParsedPsmLine& parsedLine = parsedLines[i];
+        unsigned int psmLineNr = lineNr + static_cast<unsigned int>(i);
+        try {
+          const char* psmLine = lines[i].first;
+          size_t lineLength = rtrimmedLength(psmLine, lines[i].second);
+          LabelType label = DataSet::readPsm(psmLine, lineLength, psmLineNr, 
+              optionalFields, readProteins, parsedLine.psm, 
+              &featureRows[rowStride * (i - chunkBegin)], 
+              hasSpectrumFileName ? &parsedLine.spectrumFileName : NULL, 
+              &parsedLine.proteinNames, decoyPrefix_, mappedLines);
+          parsedLine.label = static_cast<int>(label);
+          parsedLine.psm->features = NULL;
+        } catch (const MyException& e) {
+#pragma omp critical (score_psm_block_error)
+          if (i < firstErrorLine) {
+            firstErrorLine = i;
+            firstError = e.what();
+          }
+        }
+      }
+      LinearScorer::scoreRows(&rows[0], 
+          static_cast<size_t>(chunkEnd - chunkBegin), &rawWeights[0], 
+          numFeatures, &scores[chunkBegin], LinearScorer::BIAS_LAST);
+    }
+  }
+  
+  if (firstErrorLine < numLines) {
+    throw MyException(firstError);
+  }
+  
+  for (int i = 0; i < numLines; ++i) {
     if (lineNr % 1000000 == 0 && VERB > 1) {
       std::cerr << "Processing line " << lineNr << std::endl;
     }
-    psmLine = rtrim(psmLine);
-    ScoreHolder sh;
-    sh.label = DataSet::readPsm(psmLine, lineNr, optionalFields, readProteins, sh.pPSM, featurePool_, decoyPrefix_);
-    allScores.scoreAndAddPSM(sh, rawWeights, featurePool_);
+    ParsedPsmLine& parsedLine = parsedLines[i];
+    if (hasSpectrumFileName) {
+      parsedLine.psm->setSpectrumFileName(parsedLine.spectrumFileName);
+    }
+    if (!mappedLines) {
+      psmArena_.storeStrings(parsedLine.psm);
+      parsedLine.psm->setProteins(parsedLine.proteinNames);
+    }
+    ScoreHolder sh(scores[i], static_cast<LabelType>(parsedLine.label), 
+                   parsedLine.psm);
+    if (sh.label == LabelType::DECOY) addToDecoyPrefix(sh.pPSM);
+    allScores.addScoredPSM(sh);
     ++lineNr;
-  } while (getline(dataStream, psmLine));
+  }
+}
+
+/**
+ * Scores all PSMs of the spill written by readTab with the given weights and
+ * adds them to allScores in input order. The training subset is released
+ * first. The dot products of each block are computed in parallel.
+ */
+int SetHandler::readAndScoreSpill(const std::vector<double>& rawWeights, 
+    Scores& allScores) {
+  assert(psmSpill_.get() != NULL);
+  deleteSubsets();
+  hasDecoyProteins_ = false;
+  decoyProteinsCommonPrefix_.clear();
+  
+  const size_t numFeatures = psmSpill_->getNumFeatures();
+  std::vector<PSMSpill::Row> rows;
+  std::vector<const FeatureType*> featureRows;
+  std::vector<double> scores;
+  std::vector<unsigned int> proteinIds;
+  psmSpill_->rewind();
+  while (psmSpill_->readBlock(rows)) {
+    int numRows = static_cast<int>(rows.size());
+    scores.resize(rows.size());
+    featureRows.resize(rows.size());
+    for (int i = 0; i < numRows; ++i) {
+      featureRows[i] = rows[i].features;
+    }
+    const int kChunkSize = 1024;
+    int numChunks = (numRows + kChunkSize - 1) / kChunkSize;
+#pragma omp parallel for schedule(static)
+    for (int chunk = 0; chunk < numChunks; ++chunk) {
+      int chunkBegin = chunk * kChunkSize;
+      int chunkEnd = std::min(numRows, chunkBegin + kChunkSize);
+      LinearScorer::scoreRows(&featureRows[chunkBegin], 
+          static_cast<size_t>(chunkEnd - chunkBegin), &rawWeights[0], 
+          numFeatures, &scores[chunkBegin], LinearScorer::BIAS_LAST);
+    }
+    
+    for (int i = 0; i < numRows; ++i) {
+      const PSMSpill::Row& row = rows[i];
+      PSMDescription* psm = psmArena_.create();
+      psm->setId(psmArena_.storeString(row.id));
+      psm->setPeptide(psmArena_.storeString(row.peptide));
+      psm->scan = row.scan;
+      psm->specFileNr = row.specFileNr;
+      psm->expMass = row.expMass;
+      psm->calcMass = row.calcMass;
+      psm->setRetentionTime(row.retentionTime);
+      proteinIds.assign(row.proteinIds, row.proteinIds + row.numProteins);
+      psm->setProteinIds(proteinIds);
+      
+      ScoreHolder sh(scores[i], row.label, psm);
+      if (sh.label == LabelType::DECOY) addToDecoyPrefix(psm);
+      allScores.addScoredPSM(sh);
+    }
+  }
   
   if (VERB > 1) {
-    std::cerr << "Found " << lineNr - (hasInitialValueRow ? 3u : 2u) << " PSMs" << std::endl;
+    std::cerr << "Scored " << psmSpill_->getNumPsms() 
+              << " PSMs from the temporary file" << std::endl;
   }
+  psmSpill_.reset();
+  return 1;
 }
 
 std::string& SetHandler::rtrim(std::string &s) {
   s.erase(std::find_if(s.rbegin(), s.rend(), [](unsigned char ch) { return !std::isspace(ch); }).base(), s.end());
   return s;
 }
+
+size_t SetHandler::rtrimmedLength(const char* line, size_t length) {
+  while (length > 0 && std::isspace(static_cast<unsigned char>(line[length - 1]))) {
+    --length;
+  }
+  return length;
+}
@@ -31,6 +31,9 @@
 #include <locale>
 #include <queue>
 #include <climits>
+#include <stdint.h>
+#include <cstring>
+#include <memory>
 
 #include "ResultHolder.h"
 #include "DataSet.h"
@@ -41,6 +44,12 @@
 #include "SanityCheck.h"
 #include "PseudoRandom.h"
 #include "FeatureMemoryPool.h"
+#include "FeatureStatistics.h"
+#include "MemoryMappedFile.h"
+#include "PSMArena.h"
+#include "PinCache.h"
+#include "PSMSpill.h"
+#include "SpectrumIdTable.h"
 
 using namespace std;
 
@@ -71,17 +80,41 @@ class SetHandler {
 
   void push_back_dataset(DataSet* ds);
 
-  void setDecoyPrefix(std::string& decoyPrefix) { decoyPrefix_ = decoyPrefix; }
+  // A decoy prefix of "auto" makes the reader derive the prefix from the 
+  // protein names of the decoy PSMs while parsing, see getDecoyPrefix().
+  void setDecoyPrefix(std::string& decoyPrefix);
+  std::string getDecoyPrefix() const;
 
      
   //const double* getFeatures(const int setPos, const int ixPos) const; 
   size_t getMaxPSMs() { return maxPSMs_; }
+  // Selects the maxPSMs subset by a seeded hash of the ScanIds instead of by
+  // reservoir sampling, for input that can be memory mapped, see readPSMs().
+  void setSubsetHashSampling(bool hashSampling) { 
+    subsetHashSampling_ = hashSampling; 
+  }
   
   // Reads in tab delimited stream and returns a SanityCheck object based on
   // the presence of default weights. Returns 0 on error, 1 on success.
+  // PSMs read from a MemoryMappedFile keep views of its lines for their ids,
+  // peptides and proteins, so the stream has to outlive them.
   int readTab(std::istream& dataStream, SanityCheck*& pCheck);
+  // Scores the PSMs with rawWeights while parsing them in parallel, without
+  // keeping their features. Returns 0 on error, 1 on success.
   int readAndScoreTab(std::istream& dataStream, 
     std::vector<double>& rawWeights, Scores& allScores, SanityCheck*& pCheck);
+  // With maxPSMs set, readTab keeps all PSMs of input that is not memory
+  // mapped in a PSMSpill, which can then be scored in place of reading the 
+  // input a second time with readAndScoreTab.
+  bool hasPSMSpill() const { return psmSpill_.get() != NULL; }
+  int readAndScoreSpill(const std::vector<double>& rawWeights, 
+    Scores& allScores);
+  // Reads the PSMs from a cache written by writeCache() for the input with 
+  // the given signature, see PinCache. Returns false if there is no such cache.
+  bool readCache(const std::string& cacheFN, const std::string& signature,
+    SanityCheck*& pCheck);
+  bool writeCache(const std::string& cacheFN, const std::string& signature,
+    SanityCheck* pCheck);
   void addQueueToSets(std::priority_queue<PSMDescriptionPriority>& subsetPSMs,
     DataSet* targetSet, DataSet* decoySet);
   
@@ -99,20 +132,34 @@ class SetHandler {
     return (subsets_[getSubsetIndexFromLabel(label)]);
   }
   
-  static void deletePSMPointer(PSMDescription* psm);
-  
   FeatureMemoryPool& getFeaturePool() { return featurePool_; }
+  PSMArena& getPSMArena() { return psmArena_; }
   
   void reset();
 
  protected:
   size_t maxPSMs_;
+  bool subsetHashSampling_;
   vector<DataSet*> subsets_;
   FeatureMemoryPool featurePool_;
+  PSMArena psmArena_; // owns the PSMs of the subsets
+  std::unique_ptr<PinCache> pinCache_; // holds the feature rows if read from cache
+  std::unique_ptr<PSMSpill> psmSpill_; // all PSMs if a subset was sampled
+  // of the feature rows read by readPsmBlock, for the normalizer
+  FeatureStatistics featureStats_;
   std::string decoyPrefix_; // Used to determine if a psm is a decoy
+  bool detectDecoyPrefix_;
+  bool hasDecoyProteins_;
+  std::string decoyProteinsCommonPrefix_;
+  
+  // number of bytes read from the input per parallel parsing block
+  static const size_t kReadBlockSize = 1u << 24;
   
+  void deleteSubsets();
   unsigned int getSubsetIndexFromLabel(LabelType label);
+  void addToDecoyPrefix(PSMDescription* decoyPsm);
   static inline std::string &rtrim(std::string &s);
+  static inline size_t rtrimmedLength(const char* line, size_t length);
   
   int getOptionalFields(const std::string& headerLine, 
     std::vector<OptionalField>& optionalFields);
@@ -122,15 +169,32 @@ class SetHandler {
     int optionalFieldCount, FeatureNames& featureNames);
   bool getInitValues(const std::string& defaultDirectionLine, 
     int optionalFieldCount, std::vector<double>& init_values);
-  ScanId getScanId(const std::string& psmLine, int& label,
+  ScanId getScanId(const char* psmLine, size_t lineLength, int& label,
     std::vector<OptionalField>& optionalFields, unsigned int lineNr);
     
   void readPSMs(istream& dataStream, std::string& psmLine, 
     bool hasInitialValueRow, bool& separateSearches,
     std::vector<OptionalField>& optionalFields);
+  static bool readBlock(istream& dataStream, std::string& block);
+  template <typename BlockParser>
+  void forEachPsmBlock(istream& dataStream, const std::string& firstLine,
+    BlockParser parseBlock);
+  static void splitLines(const char* blockBegin, const char* blockEnd,
+    std::vector<std::pair<const char*, size_t> >& lines);
+  static size_t countLines(const char* begin, const char* end);
+  void readPsmBlock(const char* blockBegin, const char* blockEnd,
+    unsigned int& lineNr, bool& concatenatedSearch,
+    std::vector<OptionalField>& optionalFields,
+    std::vector<unsigned char>& spectrumLabels,
+    DataSet* targetSet, DataSet* decoySet, bool mappedLines,
+    uint64_t sampleSeed = 0u, uint64_t sampleThreshold = UINT64_MAX);
   void readAndScorePSMs(istream& dataStream, std::string& psmLine, 
     bool hasInitialValueRow, std::vector<OptionalField>& optionalFields, 
     std::vector<double>& rawWeights, Scores& allScores);
+  void scorePsmBlock(const char* blockBegin, const char* blockEnd,
+    unsigned int& lineNr, std::vector<OptionalField>& optionalFields,
+    const std::vector<double>& rawWeights, Scores& allScores, 
+    bool mappedLines);
 };
 
 #endif /*SETHANDLER_H_*/
@@ -0,0 +1,65 @@
+/*******************************************************************************
+ Copyright 2006-2012 Lukas Käll <lukas.kall@scilifelab.se>
+
+ Licensed under the Apache License, Version 2.0 (the "License");
+ you may not use this file except in compliance with the License.
+ You may obtain a copy of the License at
+
+ http://www.apache.org/licenses/LICENSE-2.0
+
+ Unless required by applicable law or agreed to in writing, software
+ distributed under the License is distributed on an "AS IS" BASIS,
+ WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ See the License for the specific language governing permissions and
+ limitations under the License.
+
+ *******************************************************************************/
+#ifndef SPECTRUMIDTABLE_H_
+#define SPECTRUMIDTABLE_H_
+
+#include <cstddef>
+
+#include <boost/functional/hash.hpp>
+#include <boost/unordered/unordered_map.hpp>
+
+/*
+ * SpectrumIdTable interns the identity of a spectrum, i.e. its spectrum file
+ * number, scan number and experimental mass, into a dense 32-bit id. The ids
+ * are handed out in order of first appearance, so that PSMs can be grouped
+ * by spectrum with a counting pass over arrays indexed by the id, rather than
+ * by sorting or looking up the three fields in a tree.
+ */
+class SpectrumIdTable {
+ public:
+  unsigned int intern(unsigned int specFileNr, unsigned int scan, 
+                      double expMass) {
+    SpectrumKey key = { specFileNr, scan, expMass };
+    return ids_.emplace(key, static_cast<unsigned int>(ids_.size())).first->second;
+  }
+  inline size_t size() const { return ids_.size(); }
+  void clear() { ids_.clear(); }
+  
+ private:
+  struct SpectrumKey {
+    unsigned int specFileNr, scan;
+    double expMass;
+    
+    bool operator==(const SpectrumKey& other) const {
+      return specFileNr == other.specFileNr && scan == other.scan &&
+             expMass == other.expMass;
+    }
+  };
+  struct SpectrumKeyHash {
+    size_t operator()(const SpectrumKey& key) const {
+      size_t seed = 0;
+      boost::hash_combine(seed, key.specFileNr);
+      boost::hash_combine(seed, key.scan);
+      boost::hash_combine(seed, key.expMass);
+      return seed;
+    }
+  };
+  
+  boost::unordered_map<SpectrumKey, unsigned int, SpectrumKeyHash> ids_;
+};
+
+#endif /* SPECTRUMIDTABLE_H_ */
@@ -58,17 +58,17 @@ void StdvNormalizer::normalizeweight(const std::vector<double>& in,
   out[i] = in[i] + sum;
 }
 
-void StdvNormalizer::setSet(std::vector<double*>& featuresV,
-                            std::vector<double*>& rtFeaturesV, size_t nf,
+void StdvNormalizer::setSet(std::vector<FeatureType*>& featuresV,
+                            std::vector<FeatureType*>& rtFeaturesV, size_t nf,
                             size_t nrf) {
   numFeatures = nf;
   numRetentionFeatures = nrf;
   sub.resize(nf + nrf, 0.0);
   div.resize(nf + nrf, 0.0);
   double n = 0.0;
-  double* features;
+  FeatureType* features;
   size_t ix;
-  vector<double*>::iterator it = featuresV.begin();
+  vector<FeatureType*>::iterator it = featuresV.begin();
   for (; it != featuresV.end(); ++it) {
     features = *it;
     n++;
@@ -135,12 +135,12 @@ void StdvNormalizer::setSet(std::vector<double*>& featuresV,
 }
 
 
-void StdvNormalizer::updateSet(vector<double*> & featuresV, size_t offset,
+void StdvNormalizer::updateSet(vector<FeatureType*> & featuresV, size_t offset,
                                size_t numFeatures) {
   double n = 0.0;
-  double* features;
+  FeatureType* features;
   size_t ix;
-  vector<double*>::iterator it = featuresV.begin();
+  vector<FeatureType*>::iterator it = featuresV.begin();
   for (; it != featuresV.end(); ++it) {
     features = *it;
     n++;
@@ -189,3 +189,38 @@ void StdvNormalizer::updateSet(vector<double*> & featuresV, size_t offset,
     cerr << endl;
   }
 }
+
+void StdvNormalizer::setStatistics(const FeatureStatistics& stats) {
+  numFeatures = stats.getNumFeatures();
+  numRetentionFeatures = 0;
+  sub.resize(numFeatures, 0.0);
+  div.resize(numFeatures, 0.0);
+  size_t ix;
+  if (VERB > 2) {
+    cerr.precision(2);
+    cerr << "Normalization factors" << endl << "Avg ";
+  }
+  for (ix = 0; ix < numFeatures; ++ix) {
+    sub[ix] = stats.getMean(ix);
+    if (VERB > 2) {
+      cerr << "\t" << sub[ix];
+    }
+  }
+  if (VERB > 2) {
+    cerr << endl << "Stdv";
+  }
+  for (ix = 0; ix < numFeatures; ++ix) {
+    double variance = stats.getVariance(ix);
+    if (variance <= 0 || stats.getNumRows() == 0) {
+      div[ix] = 1.0;
+    } else {
+      div[ix] = sqrt(variance);
+    }
+    if (VERB > 2) {
+      cerr << "\t" << div[ix];
+    }
+  }
+  if (VERB > 2) {
+    cerr << endl;
+  }
+}
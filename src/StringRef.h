@@ -0,0 +1,88 @@
+/*******************************************************************************
+ Copyright 2006-2012 Lukas Käll <lukas.kall@scilifelab.se>
+
+ Licensed under the Apache License, Version 2.0 (the "License");
+ you may not use this file except in compliance with the License.
+ You may obtain a copy of the License at
+
+ http://www.apache.org/licenses/LICENSE-2.0
+
+ Unless required by applicable law or agreed to in writing, software
+ distributed under the License is distributed on an "AS IS" BASIS,
+ WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ See the License for the specific language governing permissions and
+ limitations under the License.
+
+ *******************************************************************************/
+#ifndef STRINGREF_H_
+#define STRINGREF_H_
+
+#include <stdint.h>
+
+#include <algorithm>
+#include <cstring>
+#include <ostream>
+#include <string>
+
+/*
+ * StringRef is a read-only view of characters that are owned elsewhere,
+ * typically by a PSMArena or a memory mapped file, which has to outlive it.
+ * It converts to a std::string copy where one is needed, but can only be 
+ * made from a std::string explicitly, as a view of a temporary would dangle.
+ */
+class StringRef {
+ public:
+  StringRef() : data_(""), size_(0u) {}
+  StringRef(const char* data, size_t size) 
+      : data_(data), size_(static_cast<uint32_t>(size)) {}
+  explicit StringRef(const std::string& s) 
+      : data_(s.data()), size_(static_cast<uint32_t>(s.size())) {}
+  
+  inline const char* data() const { return data_; }
+  inline size_t size() const { return size_; }
+  inline bool empty() const { return size_ == 0u; }
+  inline char operator[](size_t idx) const { return data_[idx]; }
+  
+  inline std::string str() const { return std::string(data_, size_); }
+  operator std::string() const { return str(); }
+  std::string substr(size_t pos, size_t n = std::string::npos) const {
+    pos = std::min(pos, size());
+    return std::string(data_ + pos, std::min(n, size() - pos));
+  }
+  StringRef subref(size_t pos, size_t n = std::string::npos) const {
+    pos = std::min(pos, size());
+    return StringRef(data_ + pos, std::min(n, size() - pos));
+  }
+  
+  int compare(const StringRef& other) const {
+    int cmp = memcmp(data_, other.data_, std::min(size_, other.size_));
+    if (cmp != 0) return cmp;
+    return (size_ < other.size_) ? -1 : (size_ > other.size_ ? 1 : 0);
+  }
+  inline bool operator==(const StringRef& other) const {
+    return size_ == other.size_ && memcmp(data_, other.data_, size_) == 0;
+  }
+  inline bool operator!=(const StringRef& other) const { 
+    return !(*this == other); 
+  }
+  inline bool operator<(const StringRef& other) const { 
+    return compare(other) < 0; 
+  }
+  
+ private:
+  const char* data_;
+  uint32_t size_;
+};
+
+inline bool operator==(const std::string& s, const StringRef& ref) {
+  return StringRef(s) == ref;
+}
+inline bool operator==(const StringRef& ref, const std::string& s) {
+  return ref == StringRef(s);
+}
+
+inline std::ostream& operator<<(std::ostream& out, const StringRef& ref) {
+  return out.write(ref.data(), static_cast<std::streamsize>(ref.size()));
+}
+
+#endif /* STRINGREF_H_ */
@@ -18,12 +18,13 @@
 #include "TabFileValidator.h"
 
 bool TabFileValidator::isTabFile(std::string fileName) {
-  std::ifstream file(fileName.c_str());
+  // compressed files are checked on their decompressed first line
+  std::unique_ptr<std::istream> file = DecompressingStream::openFile(fileName);
   
-  if (!file.is_open()) return false;
+  if (!*file) return false;
   
   std::string tmp;
-  std::istream &in = std::getline(file, tmp);
+  std::istream &in = std::getline(*file, tmp);
   
   if (!in) {
     if (VERB > 0) {
@@ -48,143 +49,7 @@ bool TabFileValidator::isTabFiles(std::vector<std::string> fileNames) {
   return true;
 }
 
-std::string TabFileValidator::getDecoyPrefix(std::vector<std::string> fileNames) {
-  std::string decoyPrefix;
-  for (const string &fileName : fileNames) {
-      decoyPrefix = detectDecoyPrefix(fileName);
-      break;
-  };
-  return decoyPrefix;
-}
-
-void TabFileValidator::getProteinAndLabelColumnIndices(std::string fileName, int &proteinIndex, int &labelIndex) {
-  // open C++ stream to file
-  std::ifstream file(fileName.c_str());
-
-  // file not opened, return false
-  if(!file.is_open()) {
-    return ;
-  }
-
-  std::string headerRow;
-  getline(file, headerRow);
-
-  TabReader reader(headerRow);
-  int columnIndex = 0;
-  while (!reader.error()) {
-    std::string optionalHeader = reader.readString();
-    std::transform(
-      optionalHeader.begin(),
-      optionalHeader.end(),
-      optionalHeader.begin(),
-      [](unsigned char c){ return std::tolower(c); }
-    );
-    if (optionalHeader.find("proteins") != std::string::npos) { 
-      proteinIndex = columnIndex;
-    } else if (optionalHeader.find("label") != std::string::npos){
-      labelIndex = columnIndex;
-    }
-    columnIndex++;
-  }
-}
-
-std::string TabFileValidator::getLongestCommonPrefix(std::vector<std::string> strings) {
-  size_t numStrings = strings.size();
-  if (numStrings == 0) {
-    return "";
-  }
-
-  std::string referenceString = strings.at(0);
-  int referenceStringLength = referenceString.length();
-
-  for (int j = referenceStringLength; j > 0; --j) {
-    string stem = referenceString.substr(0, j);
-    bool foundStem = true;
-    for (int k = 1; k < numStrings; ++k) {
-      if (strings.at(k).find(stem) != 0) {
-        foundStem = false;
-        break;
-      }
-    }
-
-    if (foundStem) return stem;
-  }
-
-  return "";
-}
-
-std::string TabFileValidator::findDecoyPrefix(std::string fileName, int proteinIndex, int labelIndex) {
-  std::ifstream file(fileName.c_str());
-
-  if (!file.is_open()) return "error";
-
-  /* Skip header */
-  std::string nextRow;
-  getline(file, nextRow);
-
-  std::vector<std::string> proteinNames;
-  while (getline(file, nextRow)) {
-    TabReader readerRow(nextRow);
-    int col = 0;
-    bool isDecoy = false;
-    while (!readerRow.error()) {
-      std::string value = readerRow.readString();
-      if (col == labelIndex && value == "-1") {
-        isDecoy = true;
-      }
-      if (col == proteinIndex && isDecoy) {
-        proteinNames.push_back(value);
-      }
-      col++;
-    }
-  }
-
-  /* Randomly sample 10% of the protein identifiers */
-  auto rng = std::default_random_engine {};
-  std::shuffle(std::begin(proteinNames), std::end(proteinNames), rng);
-  int numElements = ceil(0.1 * proteinNames.size());
-  proteinNames.resize(numElements);
-  
-  std::string prefix = getLongestCommonPrefix(proteinNames);
-  size_t loc = prefix.find("_");
-  if (loc != std::string::npos) {
-    prefix = prefix.substr(0, loc + 1);
-  }
-
-  if (VERB > 0) {
-    std::cerr << "Using protein decoy prefix \"" << prefix << "\"" << std::endl;  
-  }
-  
-  return prefix;
-}
-
-std::string TabFileValidator::detectDecoyPrefix(std::string fileName) {
-  if (VERB > 0) {
-    std::cerr << "Finding protein decoy prefix for " << fileName << std::endl;
-  }
-  int proteinIndex = -1;
-  int labelIndex = -1;
-
-  getProteinAndLabelColumnIndices(fileName, proteinIndex, labelIndex);
-  if (proteinIndex == -1 || labelIndex == -1) {
-    if (VERB > 0) {
-        std::cerr <<  proteinIndex << " " << labelIndex << std::endl;
-        std::cerr << "Couldn't find 'Proteins' or 'Label' column in tab-file" << std::endl;
-    }
-    return "error";
-  }
-  return findDecoyPrefix(fileName, proteinIndex, labelIndex);
-}
-
-bool TabFileValidator::validateTabFiles(std::vector<std::string> files, std::string& decoyPrefix) {
-  if (decoyPrefix == "auto") {
-    std::string tmpDecoyPrefix = getDecoyPrefix(files);
-    if (tmpDecoyPrefix == "error") {
-      return false;
-    }
-    decoyPrefix = tmpDecoyPrefix;
-  }
-  
+bool TabFileValidator::validateTabFiles(std::vector<std::string> files) {
   if (!isTabFiles(files)) {
     return false;
   }
@@ -19,9 +19,10 @@
 
 #include <string>
 #include <vector>
-#include <random>
 #include <algorithm>
+#include <memory>
 
+#include "DecompressingStream.h"
 #include "Globals.h"
 #include "TabReader.h"
 
@@ -29,12 +30,7 @@ class TabFileValidator {
   public:
     static bool isTabFile(std::string fileName);
     static bool isTabFiles(std::vector<std::string> fileNames);
-    static std::string getDecoyPrefix(std::vector<std::string> fileNames);
-    static std::string detectDecoyPrefix(std::string fileName);
-    static bool validateTabFiles(std::vector<std::string> fileNames, std::string &decoyPrefix);
-    static void getProteinAndLabelColumnIndices(std::string fileName, int &proteinIndex, int &labelIndex);
-    static std::string findDecoyPrefix(std::string fileName, int proteinIndex, int labelIndex);
-    static std::string getLongestCommonPrefix(std::vector<std::string> strings);
+    static bool validateTabFiles(std::vector<std::string> fileNames);
 };
 
 #endif /*TABFILEVALIDATOR_H_*/
\ No newline at end of file
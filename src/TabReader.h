@@ -20,25 +20,54 @@
 #include <string>
 #include <climits>
 #include <cstring>
+#include <cctype>
+#include <cerrno>
+#include <cstdlib>
 #include <cmath>
 
-// using char pointers is much faster than istringstream
+#include <stdint.h>
+
+#include "StringRef.h"
+
+#if defined(__SSE2__) || defined(_M_X64)
+#include <emmintrin.h>
+#define TABREADER_SSE2
+#endif
+
+// using char pointers is much faster than istringstream. The reader works on
+// a (pointer, length) view of a line, which does not need to be null 
+// terminated, so that lines can be read directly from a memory mapped file.
+//
+// All tab positions of the line are located in a single (SSE2) pass when the
+// reader is constructed. Numbers are decoded by a locale independent parser 
+// for the plain decimal notation found in pin files; anything it cannot 
+// convert exactly (long mantissas, large exponents, inf/nan, hex floats, 
+// malformed input) is handed to strtod/strtol, so that values and error 
+// semantics are the same as for a pure strtod/strtol reader.
 class TabReader {
  public:
-  TabReader(const std::string& line) : f_(line.c_str()), err(0) {
+  TabReader(const std::string& line) 
+      : f_(line.data()), end_(line.data() + line.size()), err(0) {
     errno = 0;
+    indexTabs(line.data());
+  }
+  
+  TabReader(const char* line, size_t length) 
+      : f_(line), end_(line + length), err(0) {
+    errno = 0;
+    indexTabs(line);
   }
   
   void advance(const char* next) {
-    if (*next != '\0') {
+    if (next < end_) {
       f_ = next + 1; // eats up the tab
     } else {
-      f_ = next; // prevents pointing over the null byte
+      f_ = end_; // prevents pointing over the end of the line
     }
   }
   
   void skip() {
-    const char* pch = strchr(f_, '\t');
+    const char* pch = findTab();
     if (pch == NULL) {
       err = 1;
     } else {
@@ -51,45 +80,274 @@ class TabReader {
   }
   
   double readDouble() {
-    char* next = NULL;
-    errno = 0;
-    double d = strtod(f_, &next);
-    if (next == f_ || (*next != '\0' && !isspace(*next))
-                   || ((d == HUGE_VAL || d == -HUGE_VAL) && errno == ERANGE)) {
-      err = errno ? errno : 1;
+    const char* p = skipSpace(f_);
+    bool negative = false;
+    if (p < end_ && (*p == '-' || *p == '+')) {
+      negative = (*p == '-');
+      ++p;
     }
-    advance(next);
-    return d;
+    uint64_t mantissa = 0u;
+    int numSignificantDigits = 0, exponent = 0;
+    bool hasDigits = false;
+    for (; p < end_ && isDigit(*p); ++p) {
+      hasDigits = true;
+      if (mantissa > 0u || *p != '0') {
+        mantissa = mantissa * 10u + static_cast<uint64_t>(*p - '0');
+        ++numSignificantDigits;
+      }
+    }
+    if (p < end_ && *p == '.') {
+      for (++p; p < end_ && isDigit(*p); ++p) {
+        hasDigits = true;
+        if (mantissa > 0u || *p != '0') {
+          mantissa = mantissa * 10u + static_cast<uint64_t>(*p - '0');
+          ++numSignificantDigits;
+        }
+        --exponent;
+      }
+    }
+    if (!hasDigits || numSignificantDigits > 19) return readDoubleStrtod();
+    if (p < end_ && (*p == 'e' || *p == 'E')) {
+      ++p;
+      bool negativeExponent = false;
+      if (p < end_ && (*p == '-' || *p == '+')) {
+        negativeExponent = (*p == '-');
+        ++p;
+      }
+      if (p == end_ || !isDigit(*p)) return readDoubleStrtod();
+      int explicitExponent = 0;
+      for (; p < end_ && isDigit(*p); ++p) {
+        if (explicitExponent > 10000) return readDoubleStrtod();
+        explicitExponent = explicitExponent * 10 + (*p - '0');
+      }
+      exponent += negativeExponent ? -explicitExponent : explicitExponent;
+    }
+    if (p != end_ && !isSpace(*p)) return readDoubleStrtod();
+    
+    // with both the mantissa and the power of ten exactly representable, a 
+    // single multiplication or division is correctly rounded, i.e. gives the
+    // same result as strtod
+    double d;
+    if (mantissa == 0u) {
+      d = 0.0;
+    } else if (mantissa <= (uint64_t(1) << 53) && exponent >= -22 && exponent <= 22) {
+      d = static_cast<double>(mantissa);
+      d = (exponent < 0) ? d / powerOfTen(-exponent) : d * powerOfTen(exponent);
+    } else {
+      return readDoubleStrtod();
+    }
+    advance(p);
+    return negative ? -d : d;
   }
   
   int readInt() {
-    char* next = NULL;
-    errno=0;
-    long val = strtol(f_, &next, 10);
-    if (next == f_ || (*next != '\0' && !isspace(*next))
-                   || val < INT_MIN || val > INT_MAX) {
-      err = errno ? errno : 1;
+    const char* p = skipSpace(f_);
+    bool negative = false;
+    if (p < end_ && (*p == '-' || *p == '+')) {
+      negative = (*p == '-');
+      ++p;
+    }
+    const char* digitsStart = p;
+    int64_t val = 0;
+    for (; p < end_ && isDigit(*p); ++p) {
+      if (p - digitsStart >= 18) return readIntStrtol();
+      val = val * 10 + (*p - '0');
     }
-    advance(next);
+    if (p == digitsStart || (p != end_ && !isSpace(*p))) return readIntStrtol();
+    if (negative) val = -val;
+    if (val < INT_MIN || val > INT_MAX) err = 1;
+    advance(p);
     return static_cast<int>(val);
   }
   
   std::string readString() {
-    const char* pch = strchr(f_, '\t');
+    const char* pch = findTab();
     if (pch == NULL) {
       err = 1;
-      return std::string(f_);
+      return std::string(f_, end_);
     } else {
-      std::string s(f_, static_cast<std::basic_string<char>::size_type>(pch - f_));
+      std::string s(f_, pch);
       advance(pch);
       return s;
     }
   }
 
+  // like readString, but returns a view of the field in the line
+  StringRef readStringRef() {
+    const char* pch = findTab();
+    if (pch == NULL) {
+      err = 1;
+      return StringRef(f_, static_cast<size_t>(end_ - f_));
+    } else {
+      StringRef s(f_, static_cast<size_t>(pch - f_));
+      advance(pch);
+      return s;
+    }
+  }
+
+  // returns a view of the rest of the line, e.g. the protein columns
+  StringRef readRemainder() {
+    StringRef s(f_, static_cast<size_t>(end_ - f_));
+    f_ = end_;
+    return s;
+  }
+
   bool error() { return err != 0; }
  private:
+  static const size_t kNumberBufferSize = 64;
+  static const size_t kMaxIndexedTabs = 256;
+  
   const char* f_;
+  const char* end_;
   int err;
+  
+  // offsets of the tabs in [line_, indexedEnd_)
+  const char* line_;
+  const char* indexedEnd_;
+  uint32_t tabOffsets_[kMaxIndexedTabs];
+  size_t numTabs_, nextTab_;
+  
+  static inline bool isDigit(char c) { 
+    return static_cast<unsigned char>(c - '0') < 10u; 
+  }
+  
+  // the "C" locale isspace
+  static inline bool isSpace(char c) {
+    return c == ' ' || (c >= '\t' && c <= '\r');
+  }
+  
+  inline const char* skipSpace(const char* p) const {
+    while (p < end_ && isSpace(*p)) ++p;
+    return p;
+  }
+  
+  static inline double powerOfTen(int exponent) {
+    static const double kPowersOfTen[] = {
+      1e0, 1e1, 1e2, 1e3, 1e4, 1e5, 1e6, 1e7, 1e8, 1e9, 1e10, 1e11,
+      1e12, 1e13, 1e14, 1e15, 1e16, 1e17, 1e18, 1e19, 1e20, 1e21, 1e22 };
+    return kPowersOfTen[exponent];
+  }
+  
+  void indexTabs(const char* line) {
+    line_ = line;
+    numTabs_ = 0u;
+    nextTab_ = 0u;
+    const char* p = line;
+    size_t maxLength = static_cast<size_t>(UINT32_MAX);
+    const char* end = (static_cast<size_t>(end_ - line) > maxLength) ? 
+                      line + maxLength : end_;
+#ifdef TABREADER_SSE2
+    const __m128i tabs = _mm_set1_epi8('\t');
+    for (; p + 16 <= end; p += 16) {
+      if (numTabs_ + 16 > kMaxIndexedTabs) {
+        indexedEnd_ = p;
+        return;
+      }
+      __m128i chunk = _mm_loadu_si128(reinterpret_cast<const __m128i*>(p));
+      unsigned int mask = static_cast<unsigned int>(
+          _mm_movemask_epi8(_mm_cmpeq_epi8(chunk, tabs)));
+      while (mask != 0u) {
+        unsigned int bit = countTrailingZeros(mask);
+        tabOffsets_[numTabs_++] = static_cast<uint32_t>(p - line) + bit;
+        mask &= mask - 1u;
+      }
+    }
+#endif
+    for (; p < end; ++p) {
+      if (*p == '\t') {
+        if (numTabs_ == kMaxIndexedTabs) break;
+        tabOffsets_[numTabs_++] = static_cast<uint32_t>(p - line);
+      }
+    }
+    indexedEnd_ = p;
+  }
+  
+  static inline unsigned int countTrailingZeros(unsigned int mask) {
+#if defined(__GNUC__)
+    return static_cast<unsigned int>(__builtin_ctz(mask));
+#else
+    unsigned int n = 0u;
+    while ((mask & 1u) == 0u) {
+      mask >>= 1;
+      ++n;
+    }
+    return n;
+#endif
+  }
+  
+  // first tab at or after the current position
+  const char* findTab() {
+    while (nextTab_ < numTabs_ && line_ + tabOffsets_[nextTab_] < f_) {
+      ++nextTab_;
+    }
+    if (nextTab_ < numTabs_) return line_ + tabOffsets_[nextTab_];
+    if (indexedEnd_ < end_) { // lines with more tabs than we index
+      const char* from = (f_ > indexedEnd_) ? f_ : indexedEnd_;
+      return static_cast<const char*>(
+          memchr(from, '\t', static_cast<size_t>(end_ - from)));
+    }
+    return NULL;
+  }
+  
+  double readDoubleStrtod() {
+    char buffer[kNumberBufferSize];
+    std::string longNumber;
+    const char* number = copyNumber(buffer, longNumber);
+    char* next = NULL;
+    errno = 0;
+    double d = strtod(number, &next);
+    const char* f = fromCopy(number, next);
+    if (f == f_ || (f != end_ && !isspace(*f))
+                || ((d == HUGE_VAL || d == -HUGE_VAL) && errno == ERANGE)) {
+      err = errno ? errno : 1;
+    }
+    advance(f);
+    return d;
+  }
+  
+  int readIntStrtol() {
+    char buffer[kNumberBufferSize];
+    std::string longNumber;
+    const char* number = copyNumber(buffer, longNumber);
+    char* next = NULL;
+    errno = 0;
+    long val = strtol(number, &next, 10);
+    const char* f = fromCopy(number, next);
+    if (f == f_ || (f != end_ && !isspace(*f))
+                || val < INT_MIN || val > INT_MAX) {
+      err = errno ? errno : 1;
+    }
+    advance(f);
+    return static_cast<int>(val);
+  }
+  
+  // Copies the next number, including the whitespace that strtod/strtol 
+  // would skip in front of it, into a null terminated buffer, as the line 
+  // itself is not null terminated. Numbers never contain whitespace, so the 
+  // conversion cannot stop later than the copied range.
+  const char* copyNumber(char* buffer, std::string& longNumber) {
+    const char* tokenEnd = f_;
+    while (tokenEnd < end_ && isspace(static_cast<unsigned char>(*tokenEnd))) {
+      ++tokenEnd;
+    }
+    while (tokenEnd < end_ && !isspace(static_cast<unsigned char>(*tokenEnd))) {
+      ++tokenEnd;
+    }
+    size_t length = static_cast<size_t>(tokenEnd - f_);
+    if (length < kNumberBufferSize) {
+      memcpy(buffer, f_, length);
+      buffer[length] = '\0';
+      return buffer;
+    } else {
+      longNumber.assign(f_, tokenEnd);
+      return longNumber.c_str();
+    }
+  }
+  
+  // translates the end of a conversion in the copy back to the line
+  const char* fromCopy(const char* number, const char* next) const {
+    return f_ + (next - number);
+  }
 };
 
-#endif /*TABREADER_H_*/
\ No newline at end of file
+#endif /*TABREADER_H_*/
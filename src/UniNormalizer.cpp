@@ -50,30 +50,30 @@ void UniNormalizer::normalizeweight(const vector<double>& in, vector<
   out[i] = in[i] + sum;
 }
 
-void UniNormalizer::setSet(vector<double*> & featuresV,
-                           vector<double*> & rtFeaturesV, size_t nf,
+void UniNormalizer::setSet(vector<FeatureType*> & featuresV,
+                           vector<FeatureType*> & rtFeaturesV, size_t nf,
                            size_t nrf) {
   numFeatures = nf;
   numRetentionFeatures = nrf;
   sub.resize(nf + nrf, 0.0);
   div.resize(nf + nrf, 0.0);
   vector<double> mins(nf + nrf, 1e+100), maxs(nf + nrf, -1e+100);
-  double* features;
+  FeatureType* features;
   size_t ix;
 
-  vector<double*>::iterator it = featuresV.begin();
+  vector<FeatureType*>::iterator it = featuresV.begin();
   for (; it != featuresV.end(); ++it) {
     features = *it;
     for (ix = 0; ix < numFeatures; ix++) {
-      mins[ix] = min(features[ix], mins[ix]);
-      maxs[ix] = max(features[ix], maxs[ix]);
+      mins[ix] = min<double>(features[ix], mins[ix]);
+      maxs[ix] = max<double>(features[ix], maxs[ix]);
     }
   }
   for (it = rtFeaturesV.begin(); it != rtFeaturesV.end(); ++it) {
     features = *it;
     for (ix = numFeatures; ix < numFeatures + numRetentionFeatures; ++ix) {
-      mins[ix] = min(features[ix - numFeatures], mins[ix]);
-      maxs[ix] = max(features[ix - numFeatures], maxs[ix]);
+      mins[ix] = min<double>(features[ix - numFeatures], mins[ix]);
+      maxs[ix] = max<double>(features[ix - numFeatures], maxs[ix]);
     }
   }
   for (ix = 0; ix < numFeatures + numRetentionFeatures; ++ix) {
@@ -85,18 +85,18 @@ void UniNormalizer::setSet(vector<double*> & featuresV,
   }
 }
 
-void UniNormalizer::updateSet(vector<double*>& featuresV, size_t offset,
+void UniNormalizer::updateSet(vector<FeatureType*>& featuresV, size_t offset,
                               size_t numFeatures) {
   vector<double> mins(numFeatures, 1e+100), maxs(numFeatures, -1e+100);
-  double* features;
+  FeatureType* features;
   size_t ix;
   
-  vector<double*>::iterator it = featuresV.begin();
+  vector<FeatureType*>::iterator it = featuresV.begin();
   for (; it != featuresV.end(); ++it) {
     features = *it;
     for (ix = 0; ix < numFeatures; ix++) {
-      mins[ix] = min(features[ix], mins[ix]);
-      maxs[ix] = max(features[ix], maxs[ix]);
+      mins[ix] = min<double>(features[ix], mins[ix]);
+      maxs[ix] = max<double>(features[ix], maxs[ix]);
     }
   }
   for (ix = 0; ix < numFeatures; ++ix) {
@@ -107,3 +107,17 @@ void UniNormalizer::updateSet(vector<double*>& featuresV, size_t offset,
     }
   }
 }
+
+void UniNormalizer::setStatistics(const FeatureStatistics& stats) {
+  numFeatures = stats.getNumFeatures();
+  numRetentionFeatures = 0;
+  sub.resize(numFeatures, 0.0);
+  div.resize(numFeatures, 0.0);
+  for (size_t ix = 0; ix < numFeatures; ++ix) {
+    sub[ix] = stats.getMin(ix);
+    div[ix] = stats.getMax(ix) - stats.getMin(ix);
+    if (div[ix] <= 0) {
+      div[ix] = 1.0;
+    }
+  }
+}
@@ -1,158 +1,155 @@
 #include "ValidateTabFile.h"
 
-std::string ValidateTabFile::concatenateMultiplePINs(std::vector<std::basic_string<char>> fileNames) {
-  // Validate multiple tab-files, and then concatenate them.
-  std::string inputFN;
-  std::ifstream pinFileStream;
-
-  /* Complete column position to header name */
-  std::map<int,std::string> columnMap = {};
-  /* Temporary mapper while searching for complete position-to-header mapper */
-  std::map<int,std::string> tmpMap;
-
-  /* Keep track on col index */
-  int column_index;
+MultiPinStreamBuf::MultiPinStreamBuf(const std::vector<std::string>& fileNames)
+    : fileNames_(fileNames), fileIdx_(0u) {
+  readColumnNames();
+  rewind();
+}
 
-  /* Loop through all files to search for column headers */
-  for(const std::string &text : fileNames) {
-      
-    /* Get header */
-    pinFileStream.open(text.c_str(), std::ios::in);
+/* Get the header from the file with the most columns */
+void MultiPinStreamBuf::readColumnNames() {
+  for (const std::string& fileName : fileNames_) {
+    std::unique_ptr<std::istream> pinFileStream = 
+        DecompressingStream::openFile(fileName);
     std::string headerRow;
-
-    getline(pinFileStream, headerRow);
-
+    getline(*pinFileStream, headerRow);
+    
+    std::vector<std::string> tmpColumnNames;
     TabReader reader(headerRow);
-
-    column_index = 0;
     while (!reader.error()) {
-      std::string optionalHeader = reader.readString();
-
-      tmpMap[column_index] = optionalHeader;
-      column_index++;
+      tmpColumnNames.push_back(reader.readString());
     }
-
-    /* Get header from file with the most columns */
-    if (columnMap.size() < tmpMap.size()) {
-      columnMap = tmpMap;
+    if (columnNames_.size() < tmpColumnNames.size()) {
+      columnNames_.swap(tmpColumnNames);
     }
-    tmpMap.clear();
-    pinFileStream.close();
   }
+}
 
-  /* Create a temporary tab file to concatenate tab files in to */ 
-  string tcf = "";
-  string tcd = "";
-
-  TmpDir tmpDir;
-  tmpDir.createTempFile(tcf, tcd);
-  inputFN = tcf;
-  ofstream outFile;
-  outFile.open(inputFN);
-
-  /* Only want to print header once */
-  bool firstFile = true;
-  /* If go to next column when going though missing charge states */
-  bool nextColumn;
-
-  /* Start appending pin files to one pin file. */
-  for(const string &text : fileNames) {
-    if (VERB > 0) {
-      std::cerr << "Reading file: " << text.c_str() << std::endl;
+/* Searches the columns of the complete header that are missing in headerRow */
+void MultiPinStreamBuf::getMissingColumns(const std::string& headerRow) {
+  missingCols_.assign(columnNames_.size(), false);
+  TabReader reader(headerRow);
+  size_t columnIndex = 0;
+  while (!reader.error()) {
+    std::string optionalHeader = reader.readString();
+    /* Skip over the (possibly adjacent) missing columns */
+    while (columnIndex < columnNames_.size() && 
+           columnNames_[columnIndex] != optionalHeader) {
+      missingCols_[columnIndex++] = true;
     }
-    /* Keep track of missing charge columns for a given file */
-    std::vector<int> missingCols;
-        
-    /* Read pin file */
-    pinFileStream.open(text.c_str(), std::ios::in);
-    std::string headerRow;
-    getline(pinFileStream, headerRow);
-    TabReader reader(headerRow);
-
-    /* Keep track on column index */
-    column_index = 0;
-    /* Go through all columns to print header and search for missing charge state */
-    while (!reader.error()) {
-      std::string optionalHeader = reader.readString();
-          
-      /* Check if charge state is missing */
-      if (columnMap[column_index] != optionalHeader) {
-        /* Charge state is missing at  'column_index' */
-        missingCols.push_back(column_index);
-        nextColumn=true;
-        if (firstFile) {
-          outFile << columnMap[column_index] << "\t";
-        }
-        /* Check if there are any adjacent missing charge states */
-        while(nextColumn) {
-          column_index++;
-          if (columnMap[column_index] == optionalHeader) {
-            /* No missing charge state, continue */
-            nextColumn=false;
-          } else {
-            /* Missing charge state */
-            missingCols.push_back(column_index);
-            if (firstFile) {
-              outFile << columnMap[column_index] << "\t";
-            }             
-          }
-        }
-      } 
-      if (firstFile) {
-        outFile << columnMap[column_index] << "\t";
-      }
-      column_index++;
+    if (columnIndex == columnNames_.size()) {
+      ostringstream temp;
+      temp << "ERROR: Could not match the column " << optionalHeader << " of "
+           << fileNames_[fileIdx_] << " to the columns of the other input files."
+           << std::endl;
+      throw MyException(temp.str());
     }
+    columnIndex++;
+  }
+}
 
-    /* Go through rest of the rows in pin-file */
+bool MultiPinStreamBuf::openNextFile() {
+  if (pinFileStream_) {
+    pinFileStream_.reset();
+    ++fileIdx_;
+  }
+  if (fileIdx_ >= fileNames_.size()) return false;
+  
+  const std::string& fileName = fileNames_[fileIdx_];
+  if (VERB > 0) {
+    std::cerr << "Reading file: " << fileName << std::endl;
+  }
+  pinFileStream_ = DecompressingStream::openFile(fileName);
+  
+  std::string headerRow;
+  getline(*pinFileStream_, headerRow);
+  getMissingColumns(headerRow);
+  if (fileIdx_ == 0u) {
+    /* Only print the header once */
+    for (size_t i = 0; i < columnNames_.size(); ++i) {
+      if (i > 0) buffer_.push_back('\t');
+      buffer_ += columnNames_[i];
+    }
+    buffer_.push_back('\n');
+  } else {
+    /* Skip the row with default direction, compressed files cannot seek back
+       so any other row is passed on right away */
     std::string nextRow;
-    getline(pinFileStream, nextRow);
-
-    if (firstFile) {
-      outFile <<  "\n";
-    } else {
+    if (getline(*pinFileStream_, nextRow)) {
       std::string defaultDirectionString = "defaultdirection";
-      if (nextRow.size() >= defaultDirectionString.size()) {
-        std::string psmid = nextRow.substr(0, defaultDirectionString.size());
-        std::transform(psmid.begin(), psmid.end(), psmid.begin(), ::tolower);
-        if (psmid == defaultDirectionString) {
-          getline(pinFileStream, nextRow); // skip row with default direction
-        }
+      std::string psmid = nextRow.substr(0, defaultDirectionString.size());
+      std::transform(psmid.begin(), psmid.end(), psmid.begin(), ::tolower);
+      if (psmid != defaultDirectionString) {
+        remapRow(nextRow);
       }
     }
+  }
+  return true;
+}
 
-    do {
-      TabReader readerRow(nextRow);
+/* Appends the row to the buffer, with zeroes in the missing columns */
+void MultiPinStreamBuf::remapRow(const std::string& row) {
+  if (std::find(missingCols_.begin(), missingCols_.end(), true) == 
+        missingCols_.end()) {
+    buffer_ += row;
+    buffer_.push_back('\n');
+    return;
+  }
+  size_t col = 0;
+  size_t fieldStart = 0;
+  bool lastField = false;
+  while (!lastField) {
+    size_t fieldEnd = row.find('\t', fieldStart);
+    if (fieldEnd == std::string::npos) {
+      fieldEnd = row.size();
+      lastField = true;
+    }
+    while (col < missingCols_.size() && missingCols_[col]) {
+      buffer_ += "0\t";
+      ++col;
+    }
+    buffer_.append(row, fieldStart, fieldEnd - fieldStart);
+    if (!lastField) buffer_.push_back('\t');
+    ++col;
+    fieldStart = fieldEnd + 1;
+  }
+  buffer_.push_back('\n');
+}
 
-      /* Keep track on column for missing charge states */
-      int col = 0;
-      while (!readerRow.error()) {           
-        std::string value = readerRow.readString();
-        /* Check for missing charge state */
-        if (std::find(missingCols.begin(), missingCols.end(), col) != missingCols.end()) {
-          nextColumn=true;
-          outFile << 0 << "\t";
-          col++;
-          /* Check for adjecent missing charge states */
-          while(nextColumn) {
-            if(std::find(missingCols.begin(), missingCols.end(), col) != missingCols.end()) {
-              /* Missing adjecent charge state  */
-              outFile << 0 << "\t";
-              col++;
-            } else {
-              /* Charge states  */
-              nextColumn = false;
-            }
-          }  
-        }
-        outFile << value << "\t";
-        col++;
-      }
-      outFile << "\n";
-    } while (getline(pinFileStream, nextRow));
-    pinFileStream.close();
-    firstFile = false;      
+MultiPinStreamBuf::int_type MultiPinStreamBuf::underflow() {
+  buffer_.clear();
+  std::string row;
+  while (buffer_.size() < kBufferSize) {
+    if (pinFileStream_ && getline(*pinFileStream_, row)) {
+      remapRow(row);
+    } else if (!openNextFile()) {
+      break;
+    }
+  }
+  char* bufferStart = &buffer_[0];
+  setg(bufferStart, bufferStart, bufferStart + buffer_.size());
+  if (buffer_.empty()) return traits_type::eof();
+  return traits_type::to_int_type(*gptr());
+}
+
+void MultiPinStreamBuf::rewind() {
+  pinFileStream_.reset();
+  fileIdx_ = 0u;
+  buffer_.clear();
+  setg(NULL, NULL, NULL);
+}
+
+MultiPinStreamBuf::pos_type MultiPinStreamBuf::seekoff(off_type off, 
+    std::ios_base::seekdir dir, std::ios_base::openmode which) {
+  if (dir == std::ios_base::beg) return seekpos(pos_type(off), which);
+  return pos_type(off_type(-1));
+}
+
+MultiPinStreamBuf::pos_type MultiPinStreamBuf::seekpos(pos_type pos, 
+    std::ios_base::openmode which) {
+  if (!(which & std::ios_base::in) || pos != pos_type(0)) {
+    return pos_type(off_type(-1));
   }
-  outFile.close();
-  return inputFN;
+  rewind();
+  return pos;
 }
@@ -1,12 +1,66 @@
+#ifndef VALIDATETABFILE_H_
+#define VALIDATETABFILE_H_
+
 #include <string>
 #include <iostream>
 #include <map>
+#include <memory>
 #include <fstream>
+#include <streambuf>
+#include <vector>
 
 #include "DataSet.h"
-#include "TmpDir.h"
+#include "DecompressingStream.h"
+
+/*
+ * MultiPinStreamBuf reads several pin files as if they were one, without
+ * writing them to a temporary file first. The header is taken from the file
+ * with the most columns, columns that are missing in the other files (e.g.
+ * charge states that do not occur in a fraction) are filled in with zeroes
+ * on the fly, and only the DefaultDirection row of the first file is kept.
+ * Compressed files are decompressed on the fly as well.
+ *
+ * Only rewinding to the start is supported as a seek operation.
+ */
+class MultiPinStreamBuf : public std::streambuf {
+ public:
+  explicit MultiPinStreamBuf(const std::vector<std::string>& fileNames);
+  
+ protected:
+  int_type underflow();
+  pos_type seekoff(off_type off, std::ios_base::seekdir dir,
+                   std::ios_base::openmode which);
+  pos_type seekpos(pos_type pos, std::ios_base::openmode which);
+  
+ private:
+  static const size_t kBufferSize = 1u << 20;
+  
+  std::vector<std::string> fileNames_;
+  std::vector<std::string> columnNames_;
+  
+  size_t fileIdx_;
+  std::unique_ptr<std::istream> pinFileStream_;
+  std::vector<bool> missingCols_; // output columns missing in current file
+  std::string buffer_;
+  
+  void readColumnNames();
+  void getMissingColumns(const std::string& headerRow);
+  bool openNextFile();
+  void remapRow(const std::string& row);
+  void rewind();
+};
+
+class MultiPinStream : public std::istream {
+ public:
+  explicit MultiPinStream(const std::vector<std::string>& fileNames)
+      : std::istream(NULL), buffer_(fileNames) {
+    rdbuf(&buffer_);
+    // let read errors through instead of reporting them as EOF
+    exceptions(std::ios_base::badbit);
+  }
+  
+ private:
+  MultiPinStreamBuf buffer_;
+};
 
-class ValidateTabFile {       
-  public:     
-    std::string concatenateMultiplePINs(std::vector<std::basic_string<char>> fileNames);        
-};
\ No newline at end of file
+#endif /* VALIDATETABFILE_H_ */
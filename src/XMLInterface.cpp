@@ -184,7 +184,7 @@ int XMLInterface::readAndScorePin(istream& dataStream, std::vector<double>& rawW
 
                         if (subsetPSMs.size() < setHandler.getMaxPSMs() || randIdx < upperLimit) {
                             PSMDescriptionPriority psmPriority;
-                            psmPriority.psm = readPsm(psm, fragSpectrumScan.scanNumber(), readProteins, setHandler.getFeaturePool());
+                            psmPriority.psm = readPsm(psm, fragSpectrumScan.scanNumber(), readProteins, setHandler.getFeaturePool(), setHandler.getPSMArena());
                             psmPriority.label = (psm.isDecoy() ? LabelType::DECOY : LabelType::TARGET);
                             psmPriority.priority = randIdx;
                             subsetPSMs.push(psmPriority);
@@ -192,7 +192,6 @@ int XMLInterface::readAndScorePin(istream& dataStream, std::vector<double>& rawW
                                 PSMDescriptionPriority del = subsetPSMs.top();
                                 upperLimit = del.priority;
                                 setHandler.getFeaturePool().deallocate(del.psm->features);
-                                PSMDescription::deletePtr(del.psm);
                                 subsetPSMs.pop();
                             }
                         }
@@ -216,7 +215,7 @@ int XMLInterface::readAndScorePin(istream& dataStream, std::vector<double>& rawW
                             scanIdLookUp[scanId] = psm.isDecoy();
                         }
 
-                        PSMDescription* psmPtr = readPsm(psm, fragSpectrumScan.scanNumber(), readProteins, setHandler.getFeaturePool());
+                        PSMDescription* psmPtr = readPsm(psm, fragSpectrumScan.scanNumber(), readProteins, setHandler.getFeaturePool(), setHandler.getPSMArena());
                         if (psm.isDecoy()) {
                             decoySet->registerPsm(psmPtr);
                         } else {
@@ -244,7 +243,7 @@ int XMLInterface::readAndScorePin(istream& dataStream, std::vector<double>& rawW
                 for (const auto& psm : fragSpectrumScan.peptideSpectrumMatch()) {
                     ScoreHolder sh;
                     sh.label = (psm.isDecoy() ? LabelType::DECOY : LabelType::TARGET);
-                    sh.pPSM = readPsm(psm, fragSpectrumScan.scanNumber(), readProteins, setHandler.getFeaturePool());
+                    sh.pPSM = readPsm(psm, fragSpectrumScan.scanNumber(), readProteins, setHandler.getFeaturePool(), setHandler.getPSMArena());
 
                     allScores.scoreAndAddPSM(sh, rawWeights, setHandler.getFeaturePool());
                 }
@@ -323,8 +322,8 @@ std::string XMLInterface::decoratePeptide(const ::percolatorInNs::peptideType& p
 
 PSMDescription* XMLInterface::readPsm(
     const percolatorInNs::peptideSpectrumMatch& psm, unsigned scanNumber,
-    bool readProteins, FeatureMemoryPool& featurePool) {
-    PSMDescription* myPsm = new PSMDescription();
+    bool readProteins, FeatureMemoryPool& featurePool, PSMArena& psmArena) {
+    PSMDescription* myPsm = psmArena.create();
     string mypept = decoratePeptide(psm.peptide());
 
     if (psm.occurence().size() <= 0) {
@@ -335,16 +334,19 @@ PSMDescription* XMLInterface::readPsm(
         throw MyException(temp.str());
     }
 
+    std::vector<std::string> proteinNames;
     percolatorInNs::peptideSpectrumMatch::occurence_const_iterator occIt;
     occIt = psm.occurence().begin();
     for (; occIt != psm.occurence().end(); ++occIt) {
-        if (readProteins) myPsm->proteinIds.push_back(occIt->proteinId());
+        if (readProteins) proteinNames.push_back(occIt->proteinId());
         // adding n-term and c-term residues to peptide
         // NOTE the residues for the peptide in the PSMs are always the same for every protein
-        myPsm->setPeptide(occIt->flankN() + "." + mypept + "." + occIt->flankC());
+        myPsm->setPeptide(psmArena.storeString(
+            occIt->flankN() + "." + mypept + "." + occIt->flankC()));
     }
+    myPsm->setProteins(proteinNames);
 
-    myPsm->setId(psm.id());
+    myPsm->setId(psmArena.storeString(psm.id()));
     myPsm->scan = scanNumber;
     myPsm->expMass = psm.experimentalMass();
     myPsm->calcMass = psm.calculatedMass();
@@ -383,7 +385,7 @@ void XMLInterface::writeXML_PSMs(Scores& fullset) {
     os.open(xmlOutputFN_PSMs.c_str(), ios::out);
 
     os << "  <psms>" << endl;
-    for (std::vector<ScoreHolder>::iterator psm = fullset.begin();
+    for (Scores::iterator psm = fullset.begin();
          psm != fullset.end(); ++psm) {
         psm->printPSM(os, printDecoys_, printExpMass_);
     }
@@ -402,7 +404,7 @@ void XMLInterface::writeXML_Peptides(Scores& fullset) {
     os.open(xmlOutputFN_Peptides.c_str(), ios::out);
     // append PEPTIDEs
     os << "  <peptides>" << endl;
-    for (vector<ScoreHolder>::iterator psm = fullset.begin();
+    for (Scores::iterator psm = fullset.begin();
          psm != fullset.end(); ++psm) {
         psm->printPeptide(os, printDecoys_, printExpMass_, fullset);
     }
@@ -595,12 +597,12 @@ void XMLInterface::writePepXML_PSMs(Scores& fullset, double selectionFdr_, std::
     /* os << "  <psms>" << endl; */
     map<char, float> aaDict = getRoughAminoWeightDict();
     /* Sort psms based on base name  */
-    std::sort(fullset.begin(), fullset.end(), lessThanBaseName());
+    fullset.sort(lessThanBaseName());
     std::string pepXMLBaseName = "";
     bool first_msms_summary = true;
 
     int index = 1;
-    for (std::vector<ScoreHolder>::iterator sh = fullset.begin(); sh != fullset.end(); ++sh) {
+    for (Scores::iterator sh = fullset.begin(); sh != fullset.end(); ++sh) {
         std::string id = sh->pPSM->getId();
         auto baseName = id.substr(0, id.find('.'));
         if (baseName != pepXMLBaseName) {
@@ -125,7 +125,7 @@ class XMLInterface {
 #ifdef XML_SUPPORT
   PSMDescription* readPsm(const ::percolatorInNs::peptideSpectrumMatch &psm, 
                           unsigned scanNumber, bool readProteins,
-                          FeatureMemoryPool& featurePool);
+                          FeatureMemoryPool& featurePool, PSMArena& psmArena);
   ScanId getScanId(const percolatorInNs::peptideSpectrumMatch& psm, 
                    unsigned scanNumber);
   std::string decoratePeptide(const ::percolatorInNs::peptideType& peptide);
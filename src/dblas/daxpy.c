@@ -1,4 +1,5 @@
 #include "blas.h"
+#include "dblas_simd.h"
 
 #ifdef __cplusplus
 extern "C" {
@@ -25,6 +26,8 @@ int daxpy_(int *n, double *sa, double *sx, int *incx, double *sy,
   {
     if (iincx == 1 && iincy == 1) /* code for both increments equal to 1 */
     {
+      if (dblas_simd_daxpy(nn, ssa, sx, sy))
+        return 0;
       m = nn-3;
       for (i = 0; i < m; i += 4)
       {
@@ -0,0 +1,275 @@
+#include "dblas_simd.h"
+
+#if defined(__GNUC__) && (defined(__x86_64__) || defined(__i386__))
+#define DBLAS_X86
+#include <immintrin.h>
+#endif
+
+/* This file is compiled with -ffp-contract=off, see CMakeLists.txt, as the
+   AVX-512 target also enables FMA and fused multiply-adds would round
+   differently from the reference loops. */
+
+#ifdef DBLAS_X86
+
+/* y := alpha*A'*x + y for columns of A, in the order of the reference loop */
+static void dgemvTScalar(long m, long n, double alpha, const double* a,
+                         long lda, const double* x, double* y)
+{
+  long i, j;
+  double temp;
+
+  for (j = 0; j < n; ++j)
+  {
+    temp = 0.;
+    for (i = 0; i < m; ++i)
+      temp += a[i + j * lda] * x[i];
+    y[j] += alpha * temp;
+  }
+}
+
+__attribute__((target("avx2")))
+static void daxpyAvx2(long n, double a, const double* x, double* y)
+{
+  __m256d va = _mm256_set1_pd(a);
+  long i;
+
+  for (i = 0; i + 4 <= n; i += 4)
+    _mm256_storeu_pd(y + i, _mm256_add_pd(_mm256_loadu_pd(y + i),
+                                          _mm256_mul_pd(va, _mm256_loadu_pd(x + i))));
+  for ( ; i < n; ++i)
+    y[i] += a * x[i];
+}
+
+__attribute__((target("avx2")))
+static void dscalAvx2(long n, double a, double* x)
+{
+  __m256d va = _mm256_set1_pd(a);
+  long i;
+
+  for (i = 0; i + 4 <= n; i += 4)
+    _mm256_storeu_pd(x + i, _mm256_mul_pd(va, _mm256_loadu_pd(x + i)));
+  for ( ; i < n; ++i)
+    x[i] = a * x[i];
+}
+
+/* rows i..i+3 of the columns c[0..4) as vectors over the columns, by a 4x4
+   transpose */
+__attribute__((target("avx2")))
+static inline void loadRows4(const double* const* c, long i, __m256d* rows)
+{
+  __m256d c0 = _mm256_loadu_pd(c[0] + i), c1 = _mm256_loadu_pd(c[1] + i);
+  __m256d c2 = _mm256_loadu_pd(c[2] + i), c3 = _mm256_loadu_pd(c[3] + i);
+  __m256d t0 = _mm256_unpacklo_pd(c0, c1), t1 = _mm256_unpackhi_pd(c0, c1);
+  __m256d t2 = _mm256_unpacklo_pd(c2, c3), t3 = _mm256_unpackhi_pd(c2, c3);
+  rows[0] = _mm256_permute2f128_pd(t0, t2, 0x20);
+  rows[1] = _mm256_permute2f128_pd(t1, t3, 0x20);
+  rows[2] = _mm256_permute2f128_pd(t0, t2, 0x31);
+  rows[3] = _mm256_permute2f128_pd(t1, t3, 0x31);
+}
+
+/* four columns at a time, each lane sums its column in the reference order */
+__attribute__((target("avx2")))
+static void dgemvTAvx2(long m, long n, double alpha, const double* a,
+                       long lda, const double* x, double* y)
+{
+  long numVectorColumns = n - n % 4, numBlockRows = m - m % 4;
+  __m256d valpha = _mm256_set1_pd(alpha), temp, rows[4];
+  const double* c[4];
+  long i, j, k;
+
+  for (j = 0; j < numVectorColumns; j += 4)
+  {
+    for (k = 0; k < 4; ++k)
+      c[k] = a + (j + k) * lda;
+    temp = _mm256_setzero_pd();
+    for (i = 0; i < numBlockRows; i += 4)
+    {
+      loadRows4(c, i, rows);
+      for (k = 0; k < 4; ++k)
+        temp = _mm256_add_pd(temp, _mm256_mul_pd(rows[k],
+                                                 _mm256_set1_pd(x[i + k])));
+    }
+    for ( ; i < m; ++i)
+      temp = _mm256_add_pd(temp, _mm256_mul_pd(
+          _mm256_set_pd(c[3][i], c[2][i], c[1][i], c[0][i]),
+          _mm256_set1_pd(x[i])));
+    _mm256_storeu_pd(y + j, _mm256_add_pd(_mm256_loadu_pd(y + j),
+                                          _mm256_mul_pd(valpha, temp)));
+  }
+  dgemvTScalar(m, n - numVectorColumns, alpha, a + numVectorColumns * lda,
+               lda, x, y + numVectorColumns);
+}
+
+__attribute__((target("avx512f")))
+static void daxpyAvx512(long n, double a, const double* x, double* y)
+{
+  __m512d va = _mm512_set1_pd(a);
+  long i;
+
+  for (i = 0; i + 8 <= n; i += 8)
+    _mm512_storeu_pd(y + i, _mm512_add_pd(_mm512_loadu_pd(y + i),
+                                          _mm512_mul_pd(va, _mm512_loadu_pd(x + i))));
+  daxpyAvx2(n - i, a, x + i, y + i);
+}
+
+__attribute__((target("avx512f")))
+static void dscalAvx512(long n, double a, double* x)
+{
+  __m512d va = _mm512_set1_pd(a);
+  long i;
+
+  for (i = 0; i + 8 <= n; i += 8)
+    _mm512_storeu_pd(x + i, _mm512_mul_pd(va, _mm512_loadu_pd(x + i)));
+  dscalAvx2(n - i, a, x + i);
+}
+
+/* eight columns at a time, as two transposed blocks of four */
+__attribute__((target("avx512f")))
+static void dgemvTAvx512(long m, long n, double alpha, const double* a,
+                         long lda, const double* x, double* y)
+{
+  long numVectorColumns = n - n % 8, numBlockRows = m - m % 4;
+  __m512d valpha = _mm512_set1_pd(alpha), temp;
+  __m256d low[4], high[4];
+  const double* c[8];
+  long i, j, k;
+
+  for (j = 0; j < numVectorColumns; j += 8)
+  {
+    for (k = 0; k < 8; ++k)
+      c[k] = a + (j + k) * lda;
+    temp = _mm512_setzero_pd();
+    for (i = 0; i < numBlockRows; i += 4)
+    {
+      loadRows4(c, i, low);
+      loadRows4(c + 4, i, high);
+      for (k = 0; k < 4; ++k)
+        temp = _mm512_add_pd(temp, _mm512_mul_pd(
+            _mm512_insertf64x4(_mm512_castpd256_pd512(low[k]), high[k], 1),
+            _mm512_set1_pd(x[i + k])));
+    }
+    for ( ; i < m; ++i)
+      temp = _mm512_add_pd(temp, _mm512_mul_pd(
+          _mm512_set_pd(c[7][i], c[6][i], c[5][i], c[4][i],
+                        c[3][i], c[2][i], c[1][i], c[0][i]),
+          _mm512_set1_pd(x[i])));
+    _mm512_storeu_pd(y + j, _mm512_add_pd(_mm512_loadu_pd(y + j),
+                                          _mm512_mul_pd(valpha, temp)));
+  }
+  dgemvTAvx2(m, n - numVectorColumns, alpha, a + numVectorColumns * lda,
+             lda, x, y + numVectorColumns);
+}
+
+/* the kernel in use, -1 until the first call picks the best one; accessed
+   atomically as the BLAS functions are called from several threads */
+static int kernelInUse = -1;
+
+#endif /* DBLAS_X86 */
+
+dblas_kernel dblas_best_kernel(void)
+{
+#ifdef DBLAS_X86
+  __builtin_cpu_init();
+  if (__builtin_cpu_supports("avx512f"))
+    return DBLAS_AVX512;
+  if (__builtin_cpu_supports("avx2"))
+    return DBLAS_AVX2;
+#endif
+  return DBLAS_SCALAR;
+}
+
+dblas_kernel dblas_kernel_in_use(void)
+{
+#ifdef DBLAS_X86
+  int kernel = __atomic_load_n(&kernelInUse, __ATOMIC_RELAXED);
+  if (kernel < 0)
+  {
+    kernel = (int) dblas_best_kernel();
+    __atomic_store_n(&kernelInUse, kernel, __ATOMIC_RELAXED);
+  }
+  return (dblas_kernel) kernel;
+#else
+  return DBLAS_SCALAR;
+#endif
+}
+
+void dblas_use_kernel(dblas_kernel kernel)
+{
+  dblas_kernel best = dblas_best_kernel();
+#ifdef DBLAS_X86
+  __atomic_store_n(&kernelInUse, (int) (kernel < best ? kernel : best),
+                   __ATOMIC_RELAXED);
+#else
+  (void) kernel;
+  (void) best;
+#endif
+}
+
+const char* dblas_kernel_name(dblas_kernel kernel)
+{
+  switch (kernel)
+  {
+    case DBLAS_AVX512:
+      return "AVX-512";
+    case DBLAS_AVX2:
+      return "AVX2";
+    default:
+      return "scalar";
+  }
+}
+
+int dblas_simd_daxpy(long n, double a, const double* x, double* y)
+{
+  switch (dblas_kernel_in_use())
+  {
+#ifdef DBLAS_X86
+    case DBLAS_AVX512:
+      daxpyAvx512(n, a, x, y);
+      return 1;
+    case DBLAS_AVX2:
+      daxpyAvx2(n, a, x, y);
+      return 1;
+#endif
+    default:
+      (void) n; (void) a; (void) x; (void) y;
+      return 0;
+  }
+}
+
+int dblas_simd_dscal(long n, double a, double* x)
+{
+  switch (dblas_kernel_in_use())
+  {
+#ifdef DBLAS_X86
+    case DBLAS_AVX512:
+      dscalAvx512(n, a, x);
+      return 1;
+    case DBLAS_AVX2:
+      dscalAvx2(n, a, x);
+      return 1;
+#endif
+    default:
+      (void) n; (void) a; (void) x;
+      return 0;
+  }
+}
+
+int dblas_simd_dgemv_t(long m, long n, double alpha, const double* a,
+                       long lda, const double* x, double* y)
+{
+  switch (dblas_kernel_in_use())
+  {
+#ifdef DBLAS_X86
+    case DBLAS_AVX512:
+      dgemvTAvx512(m, n, alpha, a, lda, x, y);
+      return 1;
+    case DBLAS_AVX2:
+      dgemvTAvx2(m, n, alpha, a, lda, x, y);
+      return 1;
+#endif
+    default:
+      (void) m; (void) n; (void) alpha; (void) a; (void) lda; (void) x;
+      (void) y;
+      return 0;
+  }
+}
@@ -0,0 +1,43 @@
+/* dblas_simd.h  --  vector kernels of the builtin BLAS */
+
+/* daxpy_, dscal_ and dgemv_ ('T') hand their unit stride cases to these
+   kernels, which use AVX2 or AVX-512 when the CPU has them. The kernels do
+   the same multiplications and additions in the same order per element as
+   the reference loops, so the results do not depend on the kernel used.
+   ddot_ and dnrm2_ sum in a fixed serial order and stay scalar. */
+
+#ifndef DBLAS_SIMD_INCLUDE
+#define DBLAS_SIMD_INCLUDE
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+typedef enum {
+  DBLAS_SCALAR = 0,
+  DBLAS_AVX2 = 1,
+  DBLAS_AVX512 = 2
+} dblas_kernel;
+
+/* the widest kernel this CPU can run */
+dblas_kernel dblas_best_kernel(void);
+/* the kernel used by the BLAS functions, the best one unless changed by
+   dblas_use_kernel, which is not thread safe and meant for tests and
+   benchmarks */
+dblas_kernel dblas_kernel_in_use(void);
+void dblas_use_kernel(dblas_kernel kernel);
+const char* dblas_kernel_name(dblas_kernel kernel);
+
+/* y := a*x + y, x := a*x and y := alpha*A'*x + y with column major A of
+   m rows, for unit strides. They return 0 without doing anything when the
+   scalar kernel is in use, the reference loops do the work then. */
+int dblas_simd_daxpy(long n, double a, const double* x, double* y);
+int dblas_simd_dscal(long n, double a, double* x);
+int dblas_simd_dgemv_t(long m, long n, double alpha, const double* a,
+                       long lda, const double* x, double* y);
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif
@@ -1,4 +1,5 @@
 #include "blas.h"
+#include "dblas_simd.h"
 
 #ifdef __cplusplus
 extern "C" {
@@ -160,6 +161,11 @@ int dgemv_(char *trans, int *m, int *n,
 /*        Form  y := alpha*A'*x + y. */
 
 	jy = ky;
+	if (*incx == 1 && *incy == 1 &&
+	    dblas_simd_dgemv_t(*m, *n, *alpha, &a[a_offset], a_dim1,
+			       &x[1], &y[1])) {
+	    return 0;
+	}
 	if (*incx == 1) {
 	    i1 = *n;
 	    for (j = 1; j <= i1; ++j) {
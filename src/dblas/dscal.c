@@ -1,4 +1,5 @@
 #include "blas.h"
+#include "dblas_simd.h"
 
 #ifdef __cplusplus
 extern "C" {
@@ -24,6 +25,8 @@ int dscal_(int *n, double *sa, double *sx, int *incx)
   {
     if (iincx == 1) /* code for increment equal to 1 */
     {
+      if (dblas_simd_dscal(nn, ssa, sx))
+        return 0;
       m = nn-4;
       for (i = 0; i < m; i += 5)
       {
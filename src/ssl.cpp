@@ -44,7 +44,7 @@ extern "C" {
 // for compatibility issues, not using log2
 
 AlgIn::AlgIn(const unsigned int size, const int numFeat) {
-  vals = new double*[size];
+  vals = new FeatureType*[size];
   Y = new double[size];
   n = numFeat;
   positives = 0;
@@ -55,9 +55,92 @@ AlgIn::~AlgIn() {
   delete[] Y;
 }
 
-double cglsFun1(int active, int* J, const double* Y,
+// dot product of a feature row with double precision weights, through BLAS 
+// when the features are stored as doubles
+inline double featureDot(int n, double* features, double* w) {
+  int inc = 1;
+  return ddot_(&n, features, &inc, w, &inc);
+}
+
+inline double featureDot(int n, const float* features, const double* w) {
+  double sum = 0.0;
+  for (int i = 0; i < n; ++i) {
+    sum += features[i] * w[i];
+  }
+  return sum;
+}
+
+// makes v hold d elements, allocating only when it has to grow
+template <typename Vector, typename Value>
+void reserveVector(Vector& v, Value*, int& capacity, int d) {
+  if (d > capacity) {
+    delete[] v.vec;
+    v.vec = new Value[static_cast<std::size_t>(d)];
+    capacity = d;
+  }
+  v.d = d;
+}
+
+SvmWorkspace::SvmWorkspace()
+    : weightsCapacity_(0), outputsCapacity_(0), weightsBarCapacity_(0),
+      outputsBarCapacity_(0), activeSubsetCapacity_(0) {
+  weights.d = outputs.d = weightsBar.d = outputsBar.d = activeSubset.d = 0;
+}
+
+void SvmWorkspace::prepareSolution(int n, int m) {
+  reserveVector(weights, weights.vec, weightsCapacity_, n);
+  reserveVector(outputs, outputs.vec, outputsCapacity_, m);
+  std::fill(weights.vec, weights.vec + n, 0.0);
+  std::fill(outputs.vec, outputs.vec + m, 0.0);
+}
+
+void SvmWorkspace::setTrainingSet(const AlgIn& data, double cpos,
+                                  double cneg) {
+  costs.resize(static_cast<std::size_t>(data.m));
+  for (int i = 0; i < data.m; i++) {
+    costs[i] = (data.Y[i] == 1) ? cpos : cneg;
+  }
+  reserveVector(weightsBar, weightsBar.vec, weightsBarCapacity_, data.n);
+  reserveVector(outputsBar, outputsBar.vec, outputsBarCapacity_, data.m);
+  reserveVector(activeSubset, activeSubset.vec, activeSubsetCapacity_, data.m);
+  rowOfExample_.assign(static_cast<std::size_t>(data.m), -1);
+  activeExamples.clear();
+}
+
+// lays out the rows of the examples J[0..active) with a bias column of ones,
+// moving the rows of the examples that were already active
+void SvmWorkspace::updateActiveRows(const AlgIn& data, const int* J,
+                                    int active) {
+  if (activeExamples.size() == static_cast<std::size_t>(active) &&
+      std::equal(J, J + active, activeExamples.begin())) {
+    return;
+  }
+  std::size_t n = static_cast<std::size_t>(data.n), n0 = n - 1;
+  nextActiveRows_.resize(static_cast<std::size_t>(active) * n);
+  for (std::size_t k = 0; k < activeExamples.size(); k++) {
+    rowOfExample_[activeExamples[k]] = static_cast<int>(k);
+  }
+  for (int i = 0; i < active; i++) {
+    double* row = &nextActiveRows_[static_cast<std::size_t>(i) * n];
+    int k = rowOfExample_[J[i]];
+    if (k >= 0) {
+      memcpy(row, &activeRows[static_cast<std::size_t>(k) * n],
+             sizeof(double) * n);
+    } else {
+      std::copy(data.vals[J[i]], data.vals[J[i]] + n0, row);
+      row[n0] = 1.0;
+    }
+  }
+  for (std::size_t k = 0; k < activeExamples.size(); k++) {
+    rowOfExample_[activeExamples[k]] = -1;
+  }
+  activeRows.swap(nextActiveRows_);
+  activeExamples.assign(J, J + active);
+}
+
+double cglsFun1(int active, int* J, const double* C,
                 double* set2, int n, double* q, 
-                double* p, double cpos, double cneg){
+                double* p){
   double omega_q = 0.0;
   int inc = 1;
   int i = 0;
@@ -70,22 +153,21 @@ double cglsFun1(int active, int* J, const double* Y,
          p, &inc, &beta, q, &inc);
 
   for (i = 0; i < active; i++) {
-    omega_q += ((Y[J[i]]==1)? cpos : cneg) * (q[i]) * (q[i]);
+    omega_q += C[J[i]] * (q[i]) * (q[i]);
   }
 
   return(omega_q);
 }
 
-void cglsFun2(int active, int* J, const double* Y,
+void cglsFun2(int active, int* J, const double* C,
               double* set2, int n0, int n, double* q, 
-              double* o, double* z, double* r, 
-              double cpos, double cneg){
+              double* o, double* z, double* r){
   int i;
   int inc = 1;
   
   for (i = 0; i < active; i++) {
     o[J[i]] += q[i];
-    z[i] -= ((Y[J[i]]==1)? cpos : cneg) * q[i];
+    z[i] -= C[J[i]] * q[i];
     daxpy_(&n, &(z[i]), set2 + i * n, &inc, r, &inc);
   }
 }
@@ -94,6 +176,16 @@ int CGLS(const AlgIn& data, const double lambda, const int cgitermax,
          const double epsilon, const vector_int& Subset,
          vector_double& Weights, vector_double& Outputs,
          double cpos, double cneg) {
+  SvmWorkspace workspace;
+  workspace.setTrainingSet(data, cpos, cneg);
+  return CGLS(data, lambda, cgitermax, epsilon, Subset, Weights, Outputs,
+              workspace);
+}
+
+int CGLS(const AlgIn& data, const double lambda, const int cgitermax,
+         const double epsilon, const vector_int& Subset,
+         vector_double& Weights, vector_double& Outputs,
+         SvmWorkspace& workspace) {
   if (VERBOSE_CGLS) {
     cout << "CGLS starting..." << endl;
   }
@@ -101,35 +193,33 @@ int CGLS(const AlgIn& data, const double lambda, const int cgitermax,
   Timer tictoc;
   int active = Subset.d;
   int* J = Subset.vec;
-  double** set = data.vals;
   const double* Y = data.Y;
+  const double* C = workspace.costs.data();
   int n = data.n;
   double* beta = Weights.vec;
   double* o = Outputs.vec;
+  workspace.updateActiveRows(data, J, active);
+  double* set2 = workspace.activeRows.data();
   // initialize z
-  double* z = new double[active];
-  double* q = new double[active];
+  workspace.z.resize(static_cast<std::size_t>(active));
+  workspace.q.resize(static_cast<std::size_t>(active));
+  double* z = workspace.z.data();
+  double* q = workspace.q.data();
   int ii = 0;
   int i;
   int n0 = n-1;
   int inc = 1;
   double one = 1;
   double negLambda = -lambda;
-  int rowStart = 0;
-  double* set2 = new double[n*active];
-  double* r = new double[n];
-  for (i = n; i--;) {
-    r[i] = 0.0;
-  }
+  workspace.r.assign(static_cast<std::size_t>(n), 0.0);
+  double* r = workspace.r.data();
   for (i = 0; i < active; i++) {
     ii = J[i];
-    z[i] = ((Y[ii]==1)? cpos : cneg) * (Y[ii] - o[ii]);
-    rowStart = i * n;
-    memcpy(set2 + rowStart, set[ii], sizeof(double)*static_cast<std::size_t>(n0));
-    set2[rowStart + n0] = 1.0;
+    z[i] = C[ii] * (Y[ii] - o[ii]);
     daxpy_(&n, &(z[i]), set2 + i*n, &inc, r, &inc);
   }
-  double* p = new double[n];
+  workspace.p.resize(static_cast<std::size_t>(n));
+  double* p = workspace.p.data();
   daxpy_(&n, &negLambda, beta, &inc, r, &inc);
   memcpy(p, r, sizeof(double)*static_cast<std::size_t>(n));
   double omega1 = ddot_(&n, r, &inc, r, &inc);
@@ -145,7 +235,7 @@ int CGLS(const AlgIn& data, const double lambda, const int cgitermax,
   // iterate
   while (cgiter < cgitermax) {
     cgiter++;
-    omega_q = cglsFun1(active, J, Y, set2, n, q, p, cpos, cneg);
+    omega_q = cglsFun1(active, J, C, set2, n, q, p);
     gamma = omega1 / (lambda * omega_p + omega_q);
     inv_omega2 = 1 / omega1;
 
@@ -155,8 +245,8 @@ int CGLS(const AlgIn& data, const double lambda, const int cgitermax,
     daxpy_(&n, &gamma, p, &inc, beta, &inc);
     dscal_(&active, &gamma, q, &inc);
 
-    cglsFun2(active, J, Y, set2,
-             n0, n, q, o, z, r, cpos, cneg);
+    cglsFun2(active, J, C, set2,
+             n0, n, q, o, z, r);
 
     omega_z = ddot_(&active, z, &inc, z, &inc);
     omega1 = ddot_(&n, r, &inc, r, &inc);
@@ -183,20 +273,23 @@ int CGLS(const AlgIn& data, const double lambda, const int cgitermax,
     cerr << "CGLS converged in " << cgiter << " iteration(s) and "
         << tictoc.getCPUTimeStr() << " CPU seconds." << endl;
   }
-  delete[] z;
-  delete[] q;
-  delete[] r;
-  delete[] p;
-  delete[] set2;
   return optimality;
 }
 
 int L2_SVM_MFN(const AlgIn& data, options& Options,
                vector_double& Weights,
                vector_double& Outputs, double cpos, double cneg) {
+  SvmWorkspace workspace;
+  return L2_SVM_MFN(data, Options, Weights, Outputs, cpos, cneg, workspace);
+}
+
+int L2_SVM_MFN(const AlgIn& data, options& Options,
+               vector_double& Weights,
+               vector_double& Outputs, double cpos, double cneg,
+               SvmWorkspace& workspace) {
   /* Disassemble the structures */
   Timer tictoc;
-  double** set = data.vals;
+  FeatureType** set = data.vals;
   const double* Y = data.Y;
   int n = Weights.d;
   const int m = data.m;
@@ -211,9 +304,9 @@ int L2_SVM_MFN(const AlgIn& data, options& Options,
   int ini = 0;
   int n0 = n-1;
   int inc = 1;
-  vector_int ActiveSubset;
-  ActiveSubset.vec = new int[m];
-  ActiveSubset.d = m;
+  workspace.setTrainingSet(data, cpos, cneg);
+  const double* C = workspace.costs.data();
+  vector_int& ActiveSubset = workspace.activeSubset;
   // initialize
   F = 0.5 * lambda * ddot_(&n, w, &inc, w, &inc);
   int active = 0;
@@ -224,7 +317,7 @@ int L2_SVM_MFN(const AlgIn& data, options& Options,
       ActiveSubset.vec[active] = i;
       active++;
       // C[i]
-      F += 0.5 * ((Y[i]==1)? cpos : cneg) * diff * diff;
+      F += 0.5 * C[i] * diff * diff;
     } else {
       ActiveSubset.vec[inactive] = i;
       inactive--;
@@ -234,14 +327,11 @@ int L2_SVM_MFN(const AlgIn& data, options& Options,
   int iter = 0;
   int opt = 0;
   int opt2 = 0;
-  vector_double Weights_bar;
-  vector_double Outputs_bar;
-  double* w_bar = new double[static_cast<std::size_t>(n)];
-  double* o_bar = new double[static_cast<std::size_t>(m)];
-  Weights_bar.vec = w_bar;
-  Outputs_bar.vec = o_bar;
-  Weights_bar.d = n;
-  Outputs_bar.d = m;
+  vector_double& Weights_bar = workspace.weightsBar;
+  vector_double& Outputs_bar = workspace.outputsBar;
+  double* w_bar = Weights_bar.vec;
+  double* o_bar = Outputs_bar.vec;
+  workspace.deltas.resize(static_cast<std::size_t>(m));
   double delta = 0.0;
   int ii = 0;
   while (iter < Options.mfnitermax) {
@@ -259,10 +349,10 @@ int L2_SVM_MFN(const AlgIn& data, options& Options,
                epsilon,
                ActiveSubset,
                Weights_bar,
-               Outputs_bar, cpos, cneg);
+               Outputs_bar, workspace);
     for (int i = active; i < m; i++) {
       ii = ActiveSubset.vec[i];
-      o_bar[ii] = ddot_(&n0, set[ii], &inc, w_bar, &inc) + w_bar[n - 1];
+      o_bar[ii] = featureDot(n0, set[ii], w_bar) + w_bar[n - 1];
     }
     if (ini == 0) {
       cgitermax = CGITERMAX;
@@ -301,7 +391,8 @@ int L2_SVM_MFN(const AlgIn& data, options& Options,
         return 1;
       }
     }
-    delta = line_search(w, w_bar, lambda, o, o_bar, Y, n, m, cpos, cneg);
+    delta = line_search(w, w_bar, lambda, o, o_bar, Y, C, n, m,
+                        workspace.deltas.data());
     F_old = F;
     double delta2 = 1-delta;
     dscal_(&n, &delta2, w, &inc);
@@ -315,7 +406,7 @@ int L2_SVM_MFN(const AlgIn& data, options& Options,
       if (diff > 0) {
         ActiveSubset.vec[active] = i;
         active++;
-        F += 0.5 * ((Y[i]==1)? cpos : cneg) * diff * diff;
+        F += 0.5 * C[i] * diff * diff;
       } else {
         ActiveSubset.vec[inactive] = i;
         inactive--;
@@ -330,8 +421,9 @@ int L2_SVM_MFN(const AlgIn& data, options& Options,
 }
 
 double line_search(double* w, double* w_bar, double lambda, double* o,
-                   double* o_bar, const double* Y, int d, /* data dimensionality -- 'n' */
-                   int l, double cpos, double cneg){
+                   double* o_bar, const double* Y, const double* C,
+                   int d, /* data dimensionality -- 'n' */
+                   int l, Delta* deltas){
   int i = 0;
   double omegaL = 0.0;
   double omegaR = 0.0;
@@ -348,12 +440,11 @@ double line_search(double* w, double* w_bar, double lambda, double* o,
   int ii = 0;
   double d2 = 0.0;
 
-  Delta* deltas = new Delta[l];
   int p = 0;
   for (i = 0; i < l; i++) {
     diff = Y[i] * (o_bar[i] - o[i]);
     if (Y[i] * o[i] < 1) {
-      d2 = ((Y[i]==1)? cpos : cneg) * (o_bar[i] - o[i]);
+      d2 = C[i] * (o_bar[i] - o[i]);
       L += (o[i] - Y[i]) * d2;
       R += (o_bar[i] - Y[i]) * d2;
       if (diff > 0) {
@@ -379,11 +470,10 @@ double line_search(double* w, double* w_bar, double lambda, double* o,
       break;
     }
     ii = deltas[i].index;
-    diff = (deltas[i].s) * ((Y[ii]==1)? cpos : cneg) * (o_bar[ii] - o[ii]);
+    diff = (deltas[i].s) * C[ii] * (o_bar[ii] - o[ii]);
     L += diff * (o[ii] - Y[ii]);
     R += diff * (o_bar[ii] - Y[ii]);
   }
-  delete[] deltas;
   return (-L / (R - L));
 }
 
@@ -14,6 +14,8 @@
 #include <vector>
 #include <ctime>
 
+#include "FeatureMemoryPool.h"
+
 using namespace std;
 
 /* OPTIMIZATION CONSTANTS */
@@ -34,7 +36,7 @@ class AlgIn {
     int n; /* number of features */
     int positives;
     int negatives;
-    double** vals;
+    FeatureType** vals;
     double* Y; /* labels */
 };
 
@@ -80,6 +82,37 @@ inline bool operator<(const Delta& a, const Delta& b) {
   return (a.delta < b.delta);
 }
 
+/* Buffers of L2_SVM_MFN and CGLS that are kept between calls, so that a */
+/* thread that trains many SVMs allocates them once. CGLS keeps the rows of */
+/* the active examples, with the bias column, in activeRows in the order of */
+/* the active subset. Between MFN iterations only the rows of the examples */
+/* that become active are copied from the features, the rows of the examples */
+/* that stay active are moved from the previous matrix. */
+class SvmWorkspace {
+  public:
+    SvmWorkspace();
+    /* zeroed weights and outputs of n weights and m examples */
+    void prepareSolution(int n, int m);
+    /* the cost of each example of data, and no active rows yet */
+    void setTrainingSet(const AlgIn& data, double cpos, double cneg);
+    void updateActiveRows(const AlgIn& data, const int* J, int active);
+
+    vector_double weights, outputs; /* for the callers of L2_SVM_MFN */
+    vector_double weightsBar, outputsBar;
+    vector_int activeSubset;
+    std::vector<double> costs; /* cpos or cneg of each example */
+    std::vector<double> activeRows, z, q, r, p;
+    std::vector<int> activeExamples; /* the example of each active row */
+    std::vector<Delta> deltas;
+  private:
+    SvmWorkspace(const SvmWorkspace&);
+    SvmWorkspace& operator=(const SvmWorkspace&);
+    int weightsCapacity_, outputsCapacity_;
+    int weightsBarCapacity_, outputsBarCapacity_, activeSubsetCapacity_;
+    std::vector<double> nextActiveRows_;
+    std::vector<int> rowOfExample_; /* row in activeRows, or -1 */
+};
+
 /* svmlin algorithms and their subroutines */
 
 /* Conjugate Gradient for Sparse Linear Least Squares Problems */
@@ -89,13 +122,24 @@ int CGLS(const AlgIn& set, const double lambda, const int cgitermax,
          const double epsilon, const vector_int& Subset,
          vector_double& Weights, vector_double& Outputs,
          double cpos, double cneg);
+/* with the costs and buffers of a workspace set up for set */
+int CGLS(const AlgIn& set, const double lambda, const int cgitermax,
+         const double epsilon, const vector_int& Subset,
+         vector_double& Weights, vector_double& Outputs,
+         SvmWorkspace& workspace);
 
 /* Linear Modified Finite Newton L2-SVM*/
 /* Solves: min_w 0.5*Options->lamda*w'*w + 0.5*sum_i Data->C[i] max(0,1 - Y[i] w' x_i)^2 */
 int L2_SVM_MFN(const AlgIn& set, options& Options,
                vector_double& Weights,
                vector_double& Outputs, double cpos, double cneg);
+/* with the buffers of a workspace, e.g. one per thread */
+int L2_SVM_MFN(const AlgIn& set, options& Options,
+               vector_double& Weights,
+               vector_double& Outputs, double cpos, double cneg,
+               SvmWorkspace& workspace);
+/* C is the cost of each example, deltas room for l of them */
 double line_search(double* w, double* w_bar, double lambda, double* o,
-                         double* o_bar, const double* Y, int d, int l,
-                          double cpos, double cneg);
+                         double* o_bar, const double* Y, const double* C,
+                          int d, int l, Delta* deltas);
 #endif
@@ -0,0 +1,208 @@
+/*******************************************************************************
+ Copyright 2006-2012 Lukas Käll <lukas.kall@scilifelab.se>
+
+ Licensed under the Apache License, Version 2.0 (the "License");
+ you may not use this file except in compliance with the License.
+ You may obtain a copy of the License at
+
+ http://www.apache.org/licenses/LICENSE-2.0
+
+ Unless required by applicable law or agreed to in writing, software
+ distributed under the License is distributed on an "AS IS" BASIS,
+ WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ See the License for the specific language governing permissions and
+ limitations under the License.
+
+ *******************************************************************************/
+
+/*
+ * Compares the feature rows of FeatureMemoryPool with the packed rows in
+ * 64K feature blocks from new[] that the pool used before. The same random
+ * rows are scored the way Scores::calcScore does and trained on with
+ * L2_SVM_MFN, whose CGLS iterations copy the active rows. The rows are
+ * visited in a shuffled order, as the score sorted ScoreHolders visit them.
+ */
+
+#include <stdint.h>
+
+#include <algorithm>
+#include <chrono>
+#include <cstdlib>
+#include <iostream>
+#include <vector>
+
+#include "FeatureMemoryPool.h"
+#include "ssl.h"
+
+// the pool as it was before the aligned huge page blocks
+class LegacyFeaturePool {
+ public:
+  static const size_t kBlockSize = 65536;
+
+  explicit LegacyFeaturePool(size_t numFeatures)
+      : numFeatures_(numFeatures), numRowsPerBlock_(kBlockSize / numFeatures),
+        numRows_(0) {}
+  ~LegacyFeaturePool() {
+    for (size_t i = 0; i < memStarts_.size(); ++i) delete[] memStarts_[i];
+  }
+
+  FeatureType* allocate() {
+    if (numRows_ >= numRowsPerBlock_ * memStarts_.size()) {
+      memStarts_.push_back(new FeatureType[numFeatures_ * numRowsPerBlock_]());
+    }
+    size_t i = numRows_++;
+    return memStarts_[i / numRowsPerBlock_] +
+        (i % numRowsPerBlock_) * numFeatures_;
+  }
+
+ private:
+  size_t numFeatures_, numRowsPerBlock_, numRows_;
+  std::vector<FeatureType*> memStarts_;
+};
+
+// same stream of numbers on every run
+class Lcg {
+ public:
+  Lcg() : state_(42u) {}
+  uint32_t next() {
+    state_ = state_ * 6364136223846793005ull + 1442695040888963407ull;
+    return static_cast<uint32_t>(state_ >> 33);
+  }
+  double uniform() { return next() / 2147483648.0; }
+ private:
+  uint64_t state_;
+};
+
+template <typename Pool>
+void fillRows(Pool& pool, size_t numRows, size_t numFeatures,
+              std::vector<FeatureType*>& rows, std::vector<double>& labels) {
+  Lcg lcg;
+  rows.resize(numRows);
+  labels.resize(numRows);
+  for (size_t i = 0; i < numRows; ++i) {
+    rows[i] = pool.allocate();
+    labels[i] = (i % 2 == 0) ? 1.0 : -1.0;
+    for (size_t j = 0; j < numFeatures; ++j) {
+      rows[i][j] = static_cast<FeatureType>(
+          lcg.uniform() + (labels[i] > 0 && j % 3 == 0 ? 0.5 : 0.0));
+    }
+  }
+}
+
+double scoreRows(const std::vector<FeatureType*>& rows,
+                 const std::vector<size_t>& order,
+                 const std::vector<double>& w, size_t numRounds) {
+  size_t numFeatures = w.size() - 1u;
+  double checksum = 0.0;
+  for (size_t round = 0; round < numRounds; ++round) {
+    for (size_t i = 0; i < order.size(); ++i) {
+      const FeatureType* feat = rows[order[i]];
+      double score = w[numFeatures];
+      for (size_t ix = numFeatures; ix--;) {
+        score += feat[ix] * w[ix];
+      }
+      checksum += score;
+    }
+  }
+  return checksum;
+}
+
+double trainOnRows(const std::vector<FeatureType*>& rows,
+                   const std::vector<size_t>& order,
+                   const std::vector<double>& labels, size_t numFeatures) {
+  AlgIn data(static_cast<unsigned int>(rows.size()),
+             static_cast<int>(numFeatures) + 1);
+  data.m = static_cast<int>(rows.size());
+  for (size_t i = 0; i < order.size(); ++i) {
+    data.vals[i] = rows[order[i]];
+    data.Y[i] = labels[order[i]];
+    if (data.Y[i] > 0) {
+      ++data.positives;
+    } else {
+      ++data.negatives;
+    }
+  }
+  options pOptions;
+  pOptions.lambda = 1.0;
+  pOptions.lambda_u = 1.0;
+  pOptions.epsilon = EPSILON;
+  pOptions.cgitermax = CGITERMAX;
+  pOptions.mfnitermax = MFNITERMAX;
+  vector_double weights, outputs;
+  weights.d = data.n;
+  weights.vec = new double[weights.d]();
+  outputs.d = data.m;
+  outputs.vec = new double[outputs.d]();
+  L2_SVM_MFN(data, pOptions, weights, outputs, 1.0, 1.0);
+  double checksum = 0.0;
+  for (int i = 0; i < weights.d; ++i) checksum += weights.vec[i];
+  return checksum;
+}
+
+int main(int argc, char** argv) {
+  size_t numRows = (argc > 1) ? static_cast<size_t>(atol(argv[1])) : 2000000u;
+  size_t numFeatures = (argc > 2) ? static_cast<size_t>(atol(argv[2])) : 40u;
+  size_t numRounds = (argc > 3) ? static_cast<size_t>(atol(argv[3])) : 5u;
+  if (numRows == 0 || numFeatures == 0 || numFeatures > 65536u) {
+    std::cerr << "Usage: benchmark_featurepool [rows] [features] [rounds]"
+              << std::endl;
+    return EXIT_FAILURE;
+  }
+  std::cout << numRows << " rows x " << numFeatures << " features of "
+            << sizeof(FeatureType) << " bytes, row stride "
+            << FeatureMemoryPool::getRowStride(numFeatures) << std::endl;
+
+  std::vector<size_t> order(numRows);
+  Lcg lcg;
+  for (size_t i = 0; i < numRows; ++i) order[i] = i;
+  for (size_t i = numRows; i > 1; --i) {
+    std::swap(order[i - 1], order[lcg.next() % i]);
+  }
+  std::vector<double> w(numFeatures + 1);
+  for (size_t i = 0; i < w.size(); ++i) w[i] = lcg.uniform() - 0.5;
+
+  std::vector<FeatureType*> legacyRows, rows;
+  std::vector<double> labels;
+  LegacyFeaturePool legacyPool(numFeatures);
+  fillRows(legacyPool, numRows, numFeatures, legacyRows, labels);
+  FeatureMemoryPool pool;
+  pool.createPool(numFeatures);
+  fillRows(pool, numRows, numFeatures, rows, labels);
+
+  std::chrono::steady_clock::time_point start =
+      std::chrono::steady_clock::now();
+  double legacyScoreSum = scoreRows(legacyRows, order, w, numRounds);
+  std::chrono::duration<double> legacyScoreTime =
+      std::chrono::steady_clock::now() - start;
+  start = std::chrono::steady_clock::now();
+  double scoreSum = scoreRows(rows, order, w, numRounds);
+  std::chrono::duration<double> scoreTime =
+      std::chrono::steady_clock::now() - start;
+
+  start = std::chrono::steady_clock::now();
+  double legacyWeightSum = trainOnRows(legacyRows, order, labels, numFeatures);
+  std::chrono::duration<double> legacyTrainTime =
+      std::chrono::steady_clock::now() - start;
+  start = std::chrono::steady_clock::now();
+  double weightSum = trainOnRows(rows, order, labels, numFeatures);
+  std::chrono::duration<double> trainTime =
+      std::chrono::steady_clock::now() - start;
+
+  std::cout << "Scoring, " << numRounds << " rounds" << std::endl;
+  std::cout << "  packed new[] blocks:  " << legacyScoreTime.count() << " s"
+            << std::endl;
+  std::cout << "  FeatureMemoryPool:    " << scoreTime.count() << " s, "
+            << legacyScoreTime.count() / scoreTime.count() << "x" << std::endl;
+  std::cout << "L2_SVM_MFN/CGLS training" << std::endl;
+  std::cout << "  packed new[] blocks:  " << legacyTrainTime.count() << " s"
+            << std::endl;
+  std::cout << "  FeatureMemoryPool:    " << trainTime.count() << " s, "
+            << legacyTrainTime.count() / trainTime.count() << "x" << std::endl;
+  if (scoreSum != legacyScoreSum || weightSum != legacyWeightSum) {
+    std::cerr << "ERROR: checksums differ: " << legacyScoreSum << " vs "
+              << scoreSum << ", " << legacyWeightSum << " vs " << weightSum
+              << std::endl;
+    return EXIT_FAILURE;
+  }
+  return EXIT_SUCCESS;
+}
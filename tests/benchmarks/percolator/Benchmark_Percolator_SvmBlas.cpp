@@ -0,0 +1,241 @@
+/*******************************************************************************
+ Copyright 2006-2012 Lukas Käll <lukas.kall@scilifelab.se>
+
+ Licensed under the Apache License, Version 2.0 (the "License");
+ you may not use this file except in compliance with the License.
+ You may obtain a copy of the License at
+
+ http://www.apache.org/licenses/LICENSE-2.0
+
+ Unless required by applicable law or agreed to in writing, software
+ distributed under the License is distributed on an "AS IS" BASIS,
+ WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ See the License for the specific language governing permissions and
+ limitations under the License.
+
+ *******************************************************************************/
+
+/*
+ * Times the BLAS the build links on random PSMs of a few sizes: the two
+ * matrix products of a CGLS iteration over all rows, q = X'p by dgemv and
+ * r += z[i]*x_i by daxpy, and a whole L2_SVM_MFN training with its CGLS
+ * iterations. The builtin BLAS is timed with each of its kernels that the
+ * CPU can run, which have to give the same results to the last bit. Each
+ * time is the best of a few rounds.
+ */
+
+#include <stdint.h>
+
+#include <chrono>
+#include <cstdlib>
+#include <iostream>
+#include <string>
+#include <vector>
+
+#include "ssl.h"
+#ifndef DBLAS_SYSTEM_BLAS
+#include "dblas/dblas_simd.h"
+#endif
+
+extern "C" {
+  extern int daxpy_(int *, double *, double *, int *, double *, int *);
+  extern int dgemv_(char *, int *, int *,
+                    double *, double *, int *,
+                    double *, int *,  double *,
+                    double *, int *);
+}
+
+// same stream of numbers on every run
+class Lcg {
+ public:
+  Lcg() : state_(42u) {}
+  uint32_t next() {
+    state_ = state_ * 6364136223846793005ull + 1442695040888963407ull;
+    return static_cast<uint32_t>(state_ >> 33);
+  }
+  double uniform() { return next() / 2147483648.0; }
+ private:
+  uint64_t state_;
+};
+
+// the CGLS products over the rows laid out as CGLS does, with a bias column,
+// returning the time of a pass in seconds, averaged over a few passes, and
+// the sum of the results in checksum
+double multiplyRows(std::vector<double>& activeRows, int numFeatures,
+                    double& checksum) {
+  int n = numFeatures + 1, active = static_cast<int>(activeRows.size() / n);
+  int inc = 1;
+  char trans = 'T';
+  double alpha = 1.0, beta = 0.0;
+  std::vector<double> p(n), q(active), r(n, 0.0);
+  for (int i = 0; i < n; ++i) p[i] = 0.01 * i - 0.2;
+  const int kNumPasses = 10;
+  std::chrono::steady_clock::time_point start =
+      std::chrono::steady_clock::now();
+  for (int pass = 0; pass < kNumPasses; ++pass) {
+    dgemv_(&trans, &n, &active, &alpha, &activeRows[0], &n, &p[0], &inc,
+           &beta, &q[0], &inc);
+    for (int i = 0; i < active; ++i) {
+      daxpy_(&n, &q[i], &activeRows[static_cast<size_t>(i) * n], &inc,
+             &r[0], &inc);
+    }
+  }
+  std::chrono::duration<double> multiplyTime =
+      std::chrono::steady_clock::now() - start;
+  checksum = 0.0;
+  for (int i = 0; i < n; ++i) checksum += r[i];
+  return multiplyTime.count() / kNumPasses;
+}
+
+// trains on the rows, returning the time in seconds, and the sum of the
+// trained weights in checksum
+double trainOnRows(const std::vector<FeatureType*>& rows,
+                   const std::vector<double>& labels, size_t numFeatures,
+                   double& checksum) {
+  AlgIn data(static_cast<unsigned int>(rows.size()),
+             static_cast<int>(numFeatures) + 1);
+  data.m = static_cast<int>(rows.size());
+  for (size_t i = 0; i < rows.size(); ++i) {
+    data.vals[i] = rows[i];
+    data.Y[i] = labels[i];
+    if (data.Y[i] > 0) {
+      ++data.positives;
+    } else {
+      ++data.negatives;
+    }
+  }
+  options pOptions;
+  pOptions.lambda = 1.0;
+  pOptions.lambda_u = 1.0;
+  pOptions.epsilon = EPSILON;
+  pOptions.cgitermax = CGITERMAX;
+  pOptions.mfnitermax = MFNITERMAX;
+  vector_double weights, outputs;
+  weights.d = data.n;
+  weights.vec = new double[weights.d]();
+  outputs.d = data.m;
+  outputs.vec = new double[outputs.d]();
+  std::chrono::steady_clock::time_point start =
+      std::chrono::steady_clock::now();
+  L2_SVM_MFN(data, pOptions, weights, outputs, 1.0, 1.0);
+  std::chrono::duration<double> trainTime =
+      std::chrono::steady_clock::now() - start;
+  checksum = 0.0;
+  for (int i = 0; i < weights.d; ++i) checksum += weights.vec[i];
+  return trainTime.count();
+}
+
+class ShapeBenchmark {
+ public:
+  ShapeBenchmark(size_t numRows, size_t numFeatures, size_t numRounds)
+      : numFeatures_(numFeatures), numRounds_(numRounds),
+        values_(numRows * numFeatures), rows_(numRows), labels_(numRows),
+        activeRows_(numRows * (numFeatures + 1u)) {
+    Lcg lcg;
+    for (size_t i = 0; i < numRows; ++i) {
+      rows_[i] = &values_[i * numFeatures];
+      labels_[i] = (lcg.next() % 3u == 0u) ? 1.0 : -1.0;
+      for (size_t j = 0; j < numFeatures; ++j) {
+        rows_[i][j] = static_cast<FeatureType>(
+            lcg.uniform() + (labels_[i] > 0 && j % 3 == 0 ? 0.3 : 0.0));
+        activeRows_[i * (numFeatures + 1u) + j] = rows_[i][j];
+      }
+      activeRows_[i * (numFeatures + 1u) + numFeatures] = 1.0;
+    }
+  }
+
+  // the best of the rounds, with the checksums of the last one
+  void run(double& multiplyTime, double& multiplyChecksum, double& trainTime,
+           double& trainChecksum) {
+    multiplyTime = trainTime = 0.0;
+    for (size_t round = 0; round < numRounds_; ++round) {
+      double time = multiplyRows(activeRows_, static_cast<int>(numFeatures_),
+                                 multiplyChecksum);
+      if (round == 0 || time < multiplyTime) multiplyTime = time;
+      time = trainOnRows(rows_, labels_, numFeatures_, trainChecksum);
+      if (round == 0 || time < trainTime) trainTime = time;
+    }
+  }
+
+ private:
+  size_t numFeatures_, numRounds_;
+  std::vector<FeatureType> values_;
+  std::vector<FeatureType*> rows_;
+  std::vector<double> labels_, activeRows_;
+};
+
+void printTimes(const char* backend, double multiplyTime, double trainTime,
+                double scalarMultiplyTime, double scalarTrainTime) {
+  std::cout << "  " << backend << ": CGLS products " << multiplyTime * 1e3
+            << " ms";
+  if (scalarMultiplyTime > 0.0) {
+    std::cout << " (" << scalarMultiplyTime / multiplyTime << "x)";
+  }
+  std::cout << ", L2_SVM_MFN " << trainTime << " s";
+  if (scalarTrainTime > 0.0) {
+    std::cout << " (" << scalarTrainTime / trainTime << "x)";
+  }
+  std::cout << std::endl;
+}
+
+bool benchmarkShape(size_t numRows, size_t numFeatures, size_t numRounds) {
+  std::cout << numRows << " rows x " << numFeatures << " features"
+            << std::endl;
+  ShapeBenchmark benchmark(numRows, numFeatures, numRounds);
+  double multiplyTime, multiplyChecksum, trainTime, trainChecksum;
+#ifdef DBLAS_SYSTEM_BLAS
+  benchmark.run(multiplyTime, multiplyChecksum, trainTime, trainChecksum);
+  printTimes("system BLAS", multiplyTime, trainTime, 0.0, 0.0);
+  return true;
+#else
+  bool same = true;
+  double scalarMultiplyTime = 0.0, scalarMultiplyChecksum = 0.0;
+  double scalarTrainTime = 0.0, scalarTrainChecksum = 0.0;
+  for (int kernel = DBLAS_SCALAR; kernel <= dblas_best_kernel(); ++kernel) {
+    dblas_use_kernel(static_cast<dblas_kernel>(kernel));
+    benchmark.run(multiplyTime, multiplyChecksum, trainTime, trainChecksum);
+    std::string backend = std::string("builtin BLAS, ") +
+        dblas_kernel_name(static_cast<dblas_kernel>(kernel));
+    printTimes(backend.c_str(), multiplyTime, trainTime, scalarMultiplyTime,
+               scalarTrainTime);
+    if (kernel == DBLAS_SCALAR) {
+      scalarMultiplyTime = multiplyTime;
+      scalarMultiplyChecksum = multiplyChecksum;
+      scalarTrainTime = trainTime;
+      scalarTrainChecksum = trainChecksum;
+    } else if (multiplyChecksum != scalarMultiplyChecksum ||
+               trainChecksum != scalarTrainChecksum) {
+      std::cerr << "ERROR: results differ from the scalar kernel: "
+                << scalarMultiplyChecksum << " vs " << multiplyChecksum
+                << ", " << scalarTrainChecksum << " vs " << trainChecksum
+                << std::endl;
+      same = false;
+    }
+  }
+  dblas_use_kernel(dblas_best_kernel());
+  return same;
+#endif
+}
+
+int main(int argc, char** argv) {
+  // small and large searches with few and many features
+  const size_t kShapes[][2] = { { 20000u, 10u }, { 100000u, 25u },
+                                { 200000u, 50u } };
+  size_t numRows = (argc > 1) ? static_cast<size_t>(atol(argv[1])) : 0u;
+  size_t numFeatures = (argc > 2) ? static_cast<size_t>(atol(argv[2])) : 25u;
+  size_t numRounds = (argc > 3) ? static_cast<size_t>(atol(argv[3])) : 3u;
+  if ((argc > 1 && numRows == 0) || numFeatures == 0 || numRounds == 0) {
+    std::cerr << "Usage: benchmark_svmblas [rows] [features] [rounds]"
+              << std::endl;
+    return EXIT_FAILURE;
+  }
+  bool same = true;
+  if (numRows > 0) {
+    same = benchmarkShape(numRows, numFeatures, numRounds);
+  } else {
+    for (size_t i = 0; i < sizeof(kShapes) / sizeof(kShapes[0]); ++i) {
+      same = benchmarkShape(kShapes[i][0], kShapes[i][1], numRounds) && same;
+    }
+  }
+  return same ? EXIT_SUCCESS : EXIT_FAILURE;
+}
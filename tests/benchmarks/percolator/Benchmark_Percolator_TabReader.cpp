@@ -0,0 +1,180 @@
+/*******************************************************************************
+ Copyright 2006-2012 Lukas Käll <lukas.kall@scilifelab.se>
+
+ Licensed under the Apache License, Version 2.0 (the "License");
+ you may not use this file except in compliance with the License.
+ You may obtain a copy of the License at
+
+ http://www.apache.org/licenses/LICENSE-2.0
+
+ Unless required by applicable law or agreed to in writing, software
+ distributed under the License is distributed on an "AS IS" BASIS,
+ WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ See the License for the specific language governing permissions and
+ limitations under the License.
+
+ *******************************************************************************/
+
+/*
+ * Compares the field decoding of TabReader with the original strchr/strtod
+ * based reader on the rows of a pin file. Both readers decode every field of
+ * every row the way SetHandler/DataSet do, and the checksums of the decoded
+ * values have to agree.
+ */
+
+#include <chrono>
+#include <cstdlib>
+#include <fstream>
+#include <iostream>
+#include <string>
+#include <vector>
+
+#include "TabReader.h"
+
+// TabReader as it was before the fast decoder, kept as the reference
+class LegacyTabReader {
+ public:
+  LegacyTabReader(const std::string& line) : f_(line.c_str()), err(0) {
+    errno = 0;
+  }
+  
+  void advance(const char* next) {
+    if (*next != '\0') {
+      f_ = next + 1;
+    } else {
+      f_ = next;
+    }
+  }
+  
+  void skip() {
+    const char* pch = strchr(f_, '\t');
+    if (pch == NULL) {
+      err = 1;
+    } else {
+      advance(pch);
+    }
+  }
+  
+  double readDouble() {
+    char* next = NULL;
+    errno = 0;
+    double d = strtod(f_, &next);
+    if (next == f_ || (*next != '\0' && !isspace(*next))
+                   || ((d == HUGE_VAL || d == -HUGE_VAL) && errno == ERANGE)) {
+      err = errno ? errno : 1;
+    }
+    advance(next);
+    return d;
+  }
+  
+  int readInt() {
+    char* next = NULL;
+    errno=0;
+    long val = strtol(f_, &next, 10);
+    if (next == f_ || (*next != '\0' && !isspace(*next))
+                   || val < INT_MIN || val > INT_MAX) {
+      err = errno ? errno : 1;
+    }
+    advance(next);
+    return static_cast<int>(val);
+  }
+  
+  std::string readString() {
+    const char* pch = strchr(f_, '\t');
+    if (pch == NULL) {
+      err = 1;
+      return std::string(f_);
+    } else {
+      std::string s(f_, static_cast<std::basic_string<char>::size_type>(pch - f_));
+      advance(pch);
+      return s;
+    }
+  }
+
+  bool error() { return err != 0; }
+ private:
+  const char* f_;
+  int err;
+};
+
+// decodes id, label, scan number, the numerical columns, the peptide and the
+// proteins of a row and folds them into a checksum
+template <typename Reader>
+double decodeRow(Reader& reader, size_t numNumericColumns) {
+  double checksum = static_cast<double>(reader.readString().size());
+  checksum += reader.readInt();
+  checksum += reader.readInt();
+  for (size_t i = 0; i < numNumericColumns; ++i) {
+    checksum += reader.readDouble();
+  }
+  checksum += static_cast<double>(reader.readString().size());
+  while (!reader.error()) {
+    checksum += static_cast<double>(reader.readString().size());
+  }
+  return checksum;
+}
+
+int main(int argc, char** argv) {
+  std::string pinFile = (argc > 1) ? argv[1] : BENCHMARK_PIN_FILE;
+  size_t minRows = (argc > 2) ? static_cast<size_t>(atol(argv[2])) : 1000000u;
+  
+  std::ifstream pinStream(pinFile.c_str());
+  std::string header, line;
+  if (!getline(pinStream, header)) {
+    std::cerr << "Could not read " << pinFile << std::endl;
+    return EXIT_FAILURE;
+  }
+  size_t numColumns = 1u;
+  for (size_t i = 0; i < header.size(); ++i) {
+    if (header[i] == '\t') ++numColumns;
+  }
+  // id, label, scan number, peptide and proteins are not numerical
+  size_t numNumericColumns = numColumns - 5u;
+  std::vector<std::string> rows;
+  size_t numBytes = 0u;
+  while (getline(pinStream, line)) {
+    if (line.compare(0, 16, "DefaultDirection") == 0) continue;
+    rows.push_back(line);
+    numBytes += line.size() + 1u;
+  }
+  if (rows.empty()) {
+    std::cerr << "No PSM rows found in " << pinFile << std::endl;
+    return EXIT_FAILURE;
+  }
+  size_t numRounds = (minRows + rows.size() - 1u) / rows.size();
+  std::cout << "Decoding " << rows.size() << " rows x " << numRounds 
+            << " rounds of " << pinFile << std::endl;
+  
+  double legacyChecksum = 0.0, checksum = 0.0;
+  std::chrono::steady_clock::time_point start = std::chrono::steady_clock::now();
+  for (size_t round = 0; round < numRounds; ++round) {
+    for (size_t i = 0; i < rows.size(); ++i) {
+      LegacyTabReader reader(rows[i]);
+      legacyChecksum += decodeRow(reader, numNumericColumns);
+    }
+  }
+  std::chrono::duration<double> legacyTime = 
+      std::chrono::steady_clock::now() - start;
+  
+  start = std::chrono::steady_clock::now();
+  for (size_t round = 0; round < numRounds; ++round) {
+    for (size_t i = 0; i < rows.size(); ++i) {
+      TabReader reader(rows[i].data(), rows[i].size());
+      checksum += decodeRow(reader, numNumericColumns);
+    }
+  }
+  std::chrono::duration<double> time = std::chrono::steady_clock::now() - start;
+  
+  double megaBytes = static_cast<double>(numBytes * numRounds) / 1e6;
+  std::cout << "strtod/strchr reader: " << legacyTime.count() << " s, " 
+            << megaBytes / legacyTime.count() << " MB/s" << std::endl;
+  std::cout << "TabReader:            " << time.count() << " s, " 
+            << megaBytes / time.count() << " MB/s" << std::endl;
+  std::cout << "Speedup: " << legacyTime.count() / time.count() << "x" << std::endl;
+  if (checksum != legacyChecksum) {
+    std::cerr << "ERROR: checksums differ: " << legacyChecksum << " vs " 
+              << checksum << std::endl;
+    return EXIT_FAILURE;
+  }
+  return EXIT_SUCCESS;
+}
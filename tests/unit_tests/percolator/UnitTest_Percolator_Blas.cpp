@@ -0,0 +1,120 @@
+/*
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ * http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ *
+ */
+
+/*
+ * Unit tests for the vector kernels of the builtin BLAS, which have to give
+ * the same results as the reference loops for any vector and matrix size.
+ * There is nothing to test when the system BLAS is linked instead.
+ */
+
+#ifndef DBLAS_SYSTEM_BLAS
+
+#include <gtest/gtest.h>
+
+#include <vector>
+
+#include "dblas/dblas_simd.h"
+
+extern "C" {
+  extern int daxpy_(int *, double *, double *, int *, double *, int *);
+  extern int dscal_(int *, double *, double *, int *);
+  extern int dgemv_(char *, int *, int *,
+                    double *, double *, int *,
+                    double *, int *,  double *,
+                    double *, int *);
+}
+
+class BlasTest : public ::testing::Test {
+ protected:
+  virtual void TearDown() {
+    dblas_use_kernel(dblas_best_kernel());
+  }
+
+  static std::vector<double> makeValues(size_t size, double offset) {
+    std::vector<double> values(size);
+    for (size_t i = 0; i < size; ++i) {
+      values[i] = ((i * 37u + 11u) % 29u) * 0.173 - 2.3 + offset + 1e-9 * i;
+    }
+    return values;
+  }
+};
+
+TEST_F(BlasTest, CheckVectorKernelsMatchScalar) {
+  const int kSizes[] = { 1, 3, 4, 7, 8, 13, 37 };
+  int inc = 1;
+  for (size_t s = 0; s < sizeof(kSizes) / sizeof(int); ++s) {
+    int n = kSizes[s];
+    std::vector<double> x = makeValues(n, 0.1), y = makeValues(n, -0.4);
+    double a = -0.37;
+    dblas_use_kernel(DBLAS_SCALAR);
+    std::vector<double> expectedAxpy(y), expectedScal(x);
+    daxpy_(&n, &a, &x[0], &inc, &expectedAxpy[0], &inc);
+    dscal_(&n, &a, &expectedScal[0], &inc);
+    for (int kernel = DBLAS_AVX2; kernel <= dblas_best_kernel(); ++kernel) {
+      dblas_use_kernel(static_cast<dblas_kernel>(kernel));
+      std::vector<double> axpy(y), scal(x);
+      daxpy_(&n, &a, &x[0], &inc, &axpy[0], &inc);
+      dscal_(&n, &a, &scal[0], &inc);
+      for (int i = 0; i < n; ++i) {
+        EXPECT_EQ(expectedAxpy[i], axpy[i])
+            << dblas_kernel_name(static_cast<dblas_kernel>(kernel))
+            << ", daxpy of " << n << ", element " << i;
+        EXPECT_EQ(expectedScal[i], scal[i])
+            << dblas_kernel_name(static_cast<dblas_kernel>(kernel))
+            << ", dscal of " << n << ", element " << i;
+      }
+    }
+  }
+}
+
+TEST_F(BlasTest, CheckTransposedGemvKernelsMatchScalar) {
+  // m rows of the column major matrix are the features of an active row
+  // in CGLS, n columns are the active rows
+  const int kNumRows[] = { 1, 3, 4, 5, 17 };
+  const int kNumColumns[] = { 1, 3, 4, 8, 13, 37 };
+  const double kAlphas[] = { 1.0, -0.7 };
+  const double kBetas[] = { 0.0, 0.5 };
+  char trans = 'T';
+  int inc = 1;
+  for (size_t r = 0; r < sizeof(kNumRows) / sizeof(int); ++r) {
+    for (size_t c = 0; c < sizeof(kNumColumns) / sizeof(int); ++c) {
+      int m = kNumRows[r], n = kNumColumns[c];
+      std::vector<double> a = makeValues(m * n, 0.0), x = makeValues(m, 0.3);
+      std::vector<double> y = makeValues(n, 1.1);
+      for (size_t p = 0; p < 4u; ++p) {
+        double alpha = kAlphas[p % 2u], beta = kBetas[p / 2u];
+        dblas_use_kernel(DBLAS_SCALAR);
+        std::vector<double> expected(y);
+        dgemv_(&trans, &m, &n, &alpha, &a[0], &m, &x[0], &inc, &beta,
+               &expected[0], &inc);
+        for (int kernel = DBLAS_AVX2; kernel <= dblas_best_kernel();
+             ++kernel) {
+          dblas_use_kernel(static_cast<dblas_kernel>(kernel));
+          std::vector<double> result(y);
+          dgemv_(&trans, &m, &n, &alpha, &a[0], &m, &x[0], &inc, &beta,
+                 &result[0], &inc);
+          for (int j = 0; j < n; ++j) {
+            EXPECT_EQ(expected[j], result[j])
+                << dblas_kernel_name(static_cast<dblas_kernel>(kernel))
+                << ", " << m << "x" << n << ", alpha " << alpha << ", beta "
+                << beta << ", column " << j;
+          }
+        }
+      }
+    }
+  }
+}
+
+#endif /* DBLAS_SYSTEM_BLAS */
@@ -113,7 +113,7 @@ TEST_F(CrossValidationTest, doStepTest)
     decoys->setLabel(LabelType::DECOY);
     for (int i = 0 ; i < 2 * N ; ++i) {
         PSMDescription *psm = new PSMDescription();
-        psm->features = new double[2];
+        psm->features = new FeatureType[2];
         psm->features[0] = static_cast<double>(i) / N - 1E-6;
         psm->features[1] = static_cast<double>(i % 2);
         psm->scan = scanNumber++;
@@ -121,7 +121,7 @@ TEST_F(CrossValidationTest, doStepTest)
     }
     for (int i = 0 ; i < N ; ++i) {
         PSMDescription *psm = new PSMDescription();
-        psm->features = new double[2];
+        psm->features = new FeatureType[2];
         psm->features[0] = static_cast<double>(i) / N;
         psm->features[1] = static_cast<double>(i % 2);
         psm->scan = scanNumber++;
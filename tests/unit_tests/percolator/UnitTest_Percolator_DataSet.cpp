@@ -27,6 +27,7 @@ class DataSetTest : public ::testing::Test {
     virtual void SetUp();
     virtual void TearDown();
     FeatureMemoryPool featurePool;
+    PSMArena psmArena;
     std::vector<OptionalField> optionalFields;
     PSMDescription *myPsm;
     std::string decoyPrefix;
@@ -42,7 +43,7 @@ void DataSetTest::SetUp()
 
 void DataSetTest::TearDown()
 {
-    delete myPsm;
+    psmArena.clear();
 }
 
 // A PSM line needs to at least contain an ID, a Peptide name, and a
@@ -50,38 +51,39 @@ void DataSetTest::TearDown()
 TEST_F(DataSetTest, ChecMinimalPsmParsing)
 {
     DataSet::readPsm("Id\t-1\tPEPTIDE\tProteinList",
-            1, optionalFields, true, myPsm, featurePool, decoyPrefix);
+            1, optionalFields, true, myPsm, featurePool, psmArena, decoyPrefix);
     ASSERT_TRUE(myPsm != NULL);
     ASSERT_EQ("Id", myPsm->getId());
     ASSERT_EQ("PEPTIDE", myPsm->getFullPeptide());
-    ASSERT_EQ(1, myPsm->proteinIds.size());
-    ASSERT_EQ("ProteinList", myPsm->proteinIds[0]);
+    ASSERT_EQ(1, myPsm->getProteinIds().size());
+    ASSERT_EQ("ProteinList", 
+              PSMDescription::getProteinName(myPsm->getProteinIds()[0]));
 }
 
 // Throw on lines with missing fields.
 TEST_F(DataSetTest, CheckInvalidPsmLines)
 {
     EXPECT_THROW(DataSet::readPsm("",
-            1, optionalFields, true, myPsm, featurePool, decoyPrefix), MyException);
+            1, optionalFields, true, myPsm, featurePool, psmArena, decoyPrefix), MyException);
     EXPECT_THROW(DataSet::readPsm("Id",
-            1, optionalFields, true, myPsm, featurePool, decoyPrefix), MyException);
+            1, optionalFields, true, myPsm, featurePool, psmArena, decoyPrefix), MyException);
     EXPECT_THROW(DataSet::readPsm("Id\t0",
-            1, optionalFields, true, myPsm, featurePool, decoyPrefix), MyException);
+            1, optionalFields, true, myPsm, featurePool, psmArena, decoyPrefix), MyException);
     EXPECT_THROW(DataSet::readPsm("Id\t0\tPEPTIDE",
-            1, optionalFields, true, myPsm, featurePool, decoyPrefix), MyException);
+            1, optionalFields, true, myPsm, featurePool, psmArena, decoyPrefix), MyException);
     EXPECT_THROW(DataSet::readPsm("Id\tPEPTIDE\tProteinList",
-            1, optionalFields, true, myPsm, featurePool, decoyPrefix), MyException);
+            1, optionalFields, true, myPsm, featurePool, psmArena, decoyPrefix), MyException);
 }
 
 TEST_F(DataSetTest, CheckPsmParsingWithFeatures)
 {
     optionalFields.push_back(CALCMASS);
     DataSet::readPsm("Id\t1\t1\tPEPTIDE\tProteinList",
-            1, optionalFields, true, myPsm, featurePool, decoyPrefix);
+            1, optionalFields, true, myPsm, featurePool, psmArena, decoyPrefix);
     DataSet::readPsm("Id\t1\t1\t2\t3\tPEPTIDE\tProteinList",
-            1, optionalFields, true, myPsm, featurePool, decoyPrefix);
+            1, optionalFields, true, myPsm, featurePool, psmArena, decoyPrefix);
     DataSet::readPsm("Id\t1\t0.0\t1.1\t2.2\t3.3\t4.4\t5.5\tPEPTIDE\tProteinList",
-            1, optionalFields, true, myPsm, featurePool, decoyPrefix);
+            1, optionalFields, true, myPsm, featurePool, psmArena, decoyPrefix);
 }
 
 // Verify that only integer values are accepted for the label.
@@ -89,16 +91,16 @@ TEST_F(DataSetTest, CheckFeatureParsing)
 {
     optionalFields.clear();
     DataSet::readPsm("Id\t1\tPEPTIDE\tProteinList",
-            1, optionalFields, true, myPsm, featurePool, decoyPrefix);
+            1, optionalFields, true, myPsm, featurePool, psmArena, decoyPrefix);
     DataSet::readPsm("Id\t-1\tPEPTIDE\tProteinList",
-            1, optionalFields, true, myPsm, featurePool, decoyPrefix);
+            1, optionalFields, true, myPsm, featurePool, psmArena, decoyPrefix);
     EXPECT_THROW(DataSet::readPsm("Id\t-1.3\tPEPTIDE\tProteinList",
-            1, optionalFields, true, myPsm, featurePool, decoyPrefix), MyException);
+            1, optionalFields, true, myPsm, featurePool, psmArena, decoyPrefix), MyException);
 
     DataSet::readPsm("Id\t100000000\tPEPTIDE\tProteinList",
-            1, optionalFields, true, myPsm, featurePool, decoyPrefix);
+            1, optionalFields, true, myPsm, featurePool, psmArena, decoyPrefix);
     EXPECT_THROW(DataSet::readPsm("Id\t100000000000000000000\tPEPTIDE\tProteinList",
-            1, optionalFields, true, myPsm, featurePool, decoyPrefix), MyException);
+            1, optionalFields, true, myPsm, featurePool, psmArena, decoyPrefix), MyException);
 }
 
 // Verify that features are successfully read.
@@ -109,16 +111,16 @@ TEST_F(DataSetTest, CheckOptionalFieldsParsing)
     optionalFields.push_back(CALCMASS);
     optionalFields.push_back(SCANNR);
     EXPECT_THROW(DataSet::readPsm("Id\t-1\tPEPTIDE\tProteinList",
-            1, optionalFields, true, myPsm, featurePool, decoyPrefix), MyException);
+            1, optionalFields, true, myPsm, featurePool, psmArena, decoyPrefix), MyException);
 
     DataSet::readPsm("Id\t-1\t2.5\t42\tPEPTIDE\tProteinList",
-            1, optionalFields, true, myPsm, featurePool, decoyPrefix);
+            1, optionalFields, true, myPsm, featurePool, psmArena, decoyPrefix);
     ASSERT_TRUE(myPsm != NULL);
     ASSERT_EQ(2.5, myPsm->calcMass);
     ASSERT_EQ(42, myPsm->scan);
 
     EXPECT_THROW(DataSet::readPsm("Id\t-1\t2:5\t42\tPEPTIDE\tProteinList",
-            1, optionalFields, true, myPsm, featurePool, decoyPrefix), MyException);
+            1, optionalFields, true, myPsm, featurePool, psmArena, decoyPrefix), MyException);
     EXPECT_THROW(DataSet::readPsm("Id\t-1\t2.5\t4I2\tPEPTIDE\tProteinList",
-            1, optionalFields, true, myPsm, featurePool, decoyPrefix), MyException);
+            1, optionalFields, true, myPsm, featurePool, psmArena, decoyPrefix), MyException);
 }
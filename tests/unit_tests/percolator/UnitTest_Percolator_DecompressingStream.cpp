@@ -0,0 +1,137 @@
+/*
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ * http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ *
+ */
+
+#include <gtest/gtest.h>
+#include <cstdio>
+#include <fstream>
+#include <sstream>
+#include <string>
+#ifdef HAVE_ZSTD
+#include <zstd.h>
+#endif
+#include "DecompressingStream.h"
+
+/*
+ * Unit tests for reading compressed input files.
+ */
+
+namespace {
+// two concatenated gzip members, holding a header and a PSM row
+const unsigned char kTwoMemberGzip[] = {
+  0x1f, 0x8b, 0x08, 0x00, 0x00, 0x00, 0x00, 0x00, 0x02, 0x03, 0xcb, 0x4c, 
+  0xe1, 0xf4, 0x49, 0x4c, 0x4a, 0xcd, 0xe1, 0x74, 0x33, 0xe4, 0x0c, 0x48, 
+  0x2d, 0x28, 0xc9, 0x4c, 0x49, 0xe5, 0x0c, 0x28, 0xca, 0x2f, 0x49, 0xcd, 
+  0xcc, 0x2b, 0xe6, 0x02, 0x00, 0xcc, 0x52, 0xd2, 0xea, 0x1d, 0x00, 0x00, 
+  0x00, 0x1f, 0x8b, 0x08, 0x00, 0x00, 0x00, 0x00, 0x00, 0x02, 0x03, 0x2b, 
+  0x31, 0xe4, 0x34, 0xe4, 0x34, 0xd0, 0x33, 0xe5, 0xf4, 0xd6, 0x0b, 0x70, 
+  0x0d, 0x08, 0xf1, 0x74, 0x71, 0xd5, 0x0b, 0xe2, 0x0c, 0x30, 0xe4, 0x02, 
+  0x00, 0xd3, 0x52, 0x8e, 0x7b, 0x18, 0x00, 0x00, 0x00
+};
+const char kContent[] = 
+    "id\tLabel\tF1\tPeptide\tProteins\n"
+    "t1\t1\t0.5\tK.PEPTIDE.R\tP1\n";
+// the size of the chunks that the decompression thread hands over
+const size_t kChunkSize = 1u << 20;
+}
+
+class DecompressingStreamTest : public ::testing::Test {
+  protected:
+    virtual void SetUp() {
+        std::ofstream gzipFile(gzipFN_, std::ios::out | std::ios::binary);
+        gzipFile.write(reinterpret_cast<const char*>(kTwoMemberGzip), 
+                       sizeof(kTwoMemberGzip));
+        std::ofstream plainFile(plainFN_, std::ios::out | std::ios::binary);
+        plainFile << kContent;
+    }
+    virtual void TearDown() {
+        std::remove(gzipFN_);
+        std::remove(plainFN_);
+    }
+    const char* gzipFN_ = "decompressing_test.pin.gz";
+    const char* plainFN_ = "decompressing_test.pin";
+};
+
+TEST_F(DecompressingStreamTest, CheckDetectFormat)
+{
+    EXPECT_EQ(DecompressingStreamBuf::GZIP, 
+              DecompressingStreamBuf::detectFormat(gzipFN_));
+    EXPECT_EQ(DecompressingStreamBuf::NONE, 
+              DecompressingStreamBuf::detectFormat(plainFN_));
+}
+
+// Verify that all gzip members are read, also after rewinding, and that
+// uncompressed files are read as they are.
+TEST_F(DecompressingStreamTest, CheckContent)
+{
+    std::unique_ptr<std::istream> plain = DecompressingStream::openFile(plainFN_);
+    std::ostringstream plainContent;
+    plainContent << plain->rdbuf();
+    EXPECT_EQ(kContent, plainContent.str());
+    
+    if (!DecompressingStreamBuf::isSupported(DecompressingStreamBuf::GZIP)) {
+        return;
+    }
+    std::unique_ptr<std::istream> in = DecompressingStream::openFile(gzipFN_);
+    for (int pass = 0; pass < 2; ++pass) {
+        std::string line;
+        ASSERT_TRUE(static_cast<bool>(getline(*in, line)));
+        EXPECT_EQ("id\tLabel\tF1\tPeptide\tProteins", line);
+        ASSERT_TRUE(static_cast<bool>(getline(*in, line)));
+        EXPECT_EQ("t1\t1\t0.5\tK.PEPTIDE.R\tP1", line);
+        EXPECT_FALSE(static_cast<bool>(getline(*in, line)));
+        in->clear();
+        in->seekg(0, std::ios::beg);
+    }
+}
+
+// Verify that a zstd frame without a checksum, larger than a chunk and
+// with its last block straddling the first chunk boundary, is read to its
+// end.
+TEST_F(DecompressingStreamTest, CheckZstdRoundTrip)
+{
+#ifdef HAVE_ZSTD
+    std::string content = "id\tLabel\tF1\tPeptide\tProteins\n";
+    for (int i = 0; content.size() < kChunkSize + 100000u; ++i) {
+        content += "t" + std::to_string(i) + "\t1\t0.5\tK.PEPTIDE.R\tP1\n";
+    }
+    ZSTD_CCtx* cctx = ZSTD_createCCtx();
+    ZSTD_CCtx_setParameter(cctx, ZSTD_c_checksumFlag, 0);
+    std::string compressed(ZSTD_compressBound(content.size()), '\0');
+    ZSTD_outBuffer out = { &compressed[0], compressed.size(), 0 };
+    // end a block shortly before the chunk boundary, the last block then
+    // straddles it
+    size_t split = kChunkSize - 5000u;
+    ZSTD_inBuffer first = { content.data(), split, 0 };
+    while (ZSTD_compressStream2(cctx, &out, &first, ZSTD_e_flush) != 0u) {}
+    ZSTD_inBuffer rest = { content.data() + split, content.size() - split, 0 };
+    while (ZSTD_compressStream2(cctx, &out, &rest, ZSTD_e_end) != 0u) {}
+    ZSTD_freeCCtx(cctx);
+    const char* zstdFN = "decompressing_test.pin.zst";
+    {
+        std::ofstream zstdFile(zstdFN, std::ios::out | std::ios::binary);
+        zstdFile.write(compressed.data(), static_cast<std::streamsize>(out.pos));
+    }
+    EXPECT_EQ(DecompressingStreamBuf::ZSTD,
+              DecompressingStreamBuf::detectFormat(zstdFN));
+    std::ostringstream readContent;
+    {
+        std::unique_ptr<std::istream> in = DecompressingStream::openFile(zstdFN);
+        readContent << in->rdbuf();
+    }
+    std::remove(zstdFN);
+    EXPECT_EQ(content.size(), readContent.str().size());
+    EXPECT_TRUE(content == readContent.str());
+#endif
+}
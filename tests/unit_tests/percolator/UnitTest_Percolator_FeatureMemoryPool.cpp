@@ -0,0 +1,75 @@
+/*
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ * http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ *
+ */
+
+/*
+ * Unit tests for the FeatureMemoryPool class.
+ */
+
+#include <gtest/gtest.h>
+
+#include <vector>
+
+#include "FeatureMemoryPool.h"
+
+TEST(FeatureMemoryPoolTest, CheckAlignedRows)
+{
+    FeatureMemoryPool pool;
+    pool.createPool(5u);
+    size_t rowStride = FeatureMemoryPool::getRowStride(5u);
+    EXPECT_EQ(0u, (rowStride * sizeof(FeatureType)) % 
+                  FeatureMemoryPool::kRowAlignment);
+    FeatureType* first = pool.allocate();
+    FeatureType* second = pool.allocate();
+    EXPECT_EQ(0u, reinterpret_cast<size_t>(first) % 64u);
+    EXPECT_EQ(rowStride, static_cast<size_t>(second - first));
+    EXPECT_EQ(0.0, first[rowStride - 1]);
+}
+
+TEST(FeatureMemoryPoolTest, CheckPermuteRows)
+{
+    const size_t numFeatures = 3u;
+    FeatureMemoryPool pool;
+    pool.createPool(numFeatures);
+    // more rows than fit in a block, with every third row freed again
+    size_t numRows = pool.getNumRowsPerBlock() + 100u;
+    std::vector<FeatureType*> rows;
+    for (size_t i = 0; i < numRows; ++i) {
+      FeatureType* row = pool.allocate();
+      for (size_t j = 0; j < numFeatures; ++j) {
+        row[j] = static_cast<FeatureType>(i * numFeatures + j);
+      }
+      if (i % 3 == 0) {
+        pool.deallocate(row);
+      } else {
+        rows.push_back(row);
+      }
+    }
+    // reverse the order of the rows that are in use
+    std::vector<FeatureType*> order(rows.rbegin(), rows.rend());
+    std::vector<FeatureType> expected;
+    for (size_t k = 0; k < order.size(); ++k) {
+      expected.insert(expected.end(), order[k], order[k] + numFeatures);
+    }
+    pool.permuteRows(order);
+    for (size_t k = 0; k < order.size(); ++k) {
+      FeatureType* row = pool.addressFromIdx(static_cast<unsigned int>(k));
+      for (size_t j = 0; j < numFeatures; ++j) {
+        ASSERT_EQ(expected[k * numFeatures + j], row[j]);
+      }
+    }
+    // the freed rows are handed out behind the rows in use
+    EXPECT_EQ(pool.addressFromIdx(static_cast<unsigned int>(order.size())), 
+              pool.allocate());
+}
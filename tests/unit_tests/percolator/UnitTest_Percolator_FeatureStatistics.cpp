@@ -0,0 +1,85 @@
+/*
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ * http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ *
+ */
+
+/*
+ * Unit tests for the FeatureStatistics class and the normalizers set up
+ * from it.
+ */
+
+#include <gtest/gtest.h>
+
+#include <vector>
+
+#include "FeatureStatistics.h"
+#include "Normalizer.h"
+#include "StdvNormalizer.h"
+#include "UniNormalizer.h"
+
+class FeatureStatisticsTest : public ::testing::Test {
+ protected:
+  virtual void SetUp() {
+    for (int i = 0; i < 101; ++i) {
+      values_.push_back(1000.0 + 0.5 * i);
+      values_.push_back(-3.0 * (i % 7) + 1e-3 * i);
+      values_.push_back(4.0);
+    }
+    for (size_t i = 0; i < values_.size(); i += kNumFeatures) {
+      rows_.push_back(&values_[i]);
+    }
+  }
+
+  static const size_t kNumFeatures = 3u;
+  std::vector<FeatureType> values_;
+  std::vector<FeatureType*> rows_;
+};
+
+TEST_F(FeatureStatisticsTest, MergedPartsMatchOnePass) {
+  FeatureStatistics all(kNumFeatures), first(kNumFeatures), 
+                    second(kNumFeatures);
+  for (size_t i = 0; i < rows_.size(); ++i) {
+    all.add(rows_[i]);
+    (i < 40 ? first : second).add(rows_[i]);
+  }
+  first.merge(second);
+  ASSERT_EQ(rows_.size(), first.getNumRows());
+  for (size_t ix = 0; ix < kNumFeatures; ++ix) {
+    EXPECT_NEAR(all.getMean(ix), first.getMean(ix), 1e-9);
+    EXPECT_NEAR(all.getVariance(ix), first.getVariance(ix), 1e-9);
+    EXPECT_EQ(all.getMin(ix), first.getMin(ix));
+    EXPECT_EQ(all.getMax(ix), first.getMax(ix));
+  }
+  EXPECT_EQ(0.0, all.getVariance(2));
+}
+
+TEST_F(FeatureStatisticsTest, NormalizersMatchTwoPassSetup) {
+  FeatureStatistics stats(kNumFeatures);
+  for (size_t i = 0; i < rows_.size(); ++i) {
+    stats.add(rows_[i]);
+  }
+  std::vector<FeatureType*> noRtFeatures;
+  
+  StdvNormalizer stdvTwoPass, stdvOnline;
+  stdvTwoPass.setSet(rows_, noRtFeatures, kNumFeatures, 0);
+  stdvOnline.setStatistics(stats);
+  UniNormalizer uniTwoPass, uniOnline;
+  uniTwoPass.setSet(rows_, noRtFeatures, kNumFeatures, 0);
+  uniOnline.setStatistics(stats);
+  for (size_t ix = 0; ix < kNumFeatures; ++ix) {
+    EXPECT_NEAR(stdvTwoPass.getSub()[ix], stdvOnline.getSub()[ix], 1e-9);
+    EXPECT_NEAR(stdvTwoPass.getDiv()[ix], stdvOnline.getDiv()[ix], 1e-9);
+    EXPECT_EQ(uniTwoPass.getSub()[ix], uniOnline.getSub()[ix]);
+    EXPECT_EQ(uniTwoPass.getDiv()[ix], uniOnline.getDiv()[ix]);
+  }
+}
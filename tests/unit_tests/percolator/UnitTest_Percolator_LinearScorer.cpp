@@ -0,0 +1,99 @@
+/*
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ * http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ *
+ */
+
+/*
+ * Unit tests for the LinearScorer kernels, which have to give the same
+ * scores as the scalar kernel for any number of rows and features.
+ */
+
+#include <gtest/gtest.h>
+
+#include <vector>
+
+#include "LinearScorer.h"
+
+class LinearScorerTest : public ::testing::Test {
+ protected:
+  // rows of exactly numFeatures values each, so that over-reads are not
+  // hidden by padding
+  void fillRows(size_t numRows, size_t numFeatures) {
+    values_.assign(numRows, std::vector<FeatureType>(numFeatures));
+    rows_.resize(numRows);
+    for (size_t i = 0; i < numRows; ++i) {
+      for (size_t j = 0; j < numFeatures; ++j) {
+        values_[i][j] = static_cast<FeatureType>(
+            ((i * 31u + j * 17u) % 23u) * 0.37 - 3.1 + 1e-7 * i);
+      }
+      rows_[i] = numFeatures > 0u ? &values_[i][0] : NULL;
+    }
+    w_.resize(numFeatures + 1u);
+    for (size_t j = 0; j <= numFeatures; ++j) {
+      w_[j] = 0.013 * j - 0.29 + ((j % 3u == 0u) ? 1.7 : 0.0);
+    }
+  }
+
+  std::vector<std::vector<FeatureType> > values_;
+  std::vector<const FeatureType*> rows_;
+  std::vector<double> w_;
+};
+
+TEST_F(LinearScorerTest, CheckScalarKernel) {
+  fillRows(5u, 3u);
+  std::vector<double> scores(5u);
+  LinearScorer::scoreRows(&rows_[0], 5u, &w_[0], 3u, &scores[0],
+                          LinearScorer::BIAS_FIRST, LinearScorer::SCALAR);
+  for (size_t i = 0; i < 5u; ++i) {
+    double score = w_[3];
+    for (size_t ix = 3u; ix--;) score += rows_[i][ix] * w_[ix];
+    EXPECT_DOUBLE_EQ(score, scores[i]);
+  }
+  LinearScorer::scoreRows(&rows_[0], 5u, &w_[0], 3u, &scores[0],
+                          LinearScorer::BIAS_LAST, LinearScorer::SCALAR);
+  for (size_t i = 0; i < 5u; ++i) {
+    double score = 0.0;
+    for (size_t ix = 0; ix < 3u; ++ix) score += rows_[i][ix] * w_[ix];
+    EXPECT_DOUBLE_EQ(score + w_[3], scores[i]);
+  }
+}
+
+TEST_F(LinearScorerTest, CheckKernelsMatchScalar) {
+  const size_t kNumRows[] = { 1u, 3u, 4u, 8u, 13u, 37u };
+  const size_t kNumFeatures[] = { 0u, 1u, 2u, 4u, 7u, 16u, 27u };
+  LinearScorer::SumOrder orders[] = { LinearScorer::BIAS_FIRST,
+                                      LinearScorer::BIAS_LAST };
+  for (size_t r = 0; r < sizeof(kNumRows) / sizeof(size_t); ++r) {
+    for (size_t f = 0; f < sizeof(kNumFeatures) / sizeof(size_t); ++f) {
+      size_t numRows = kNumRows[r], numFeatures = kNumFeatures[f];
+      fillRows(numRows, numFeatures);
+      for (size_t o = 0; o < 2u; ++o) {
+        std::vector<double> expected(numRows), scores(numRows);
+        LinearScorer::scoreRows(&rows_[0], numRows, &w_[0], numFeatures,
+                                &expected[0], orders[o], LinearScorer::SCALAR);
+        for (int kernel = LinearScorer::AVX2;
+             kernel <= LinearScorer::getBestKernel(); ++kernel) {
+          LinearScorer::scoreRows(&rows_[0], numRows, &w_[0], numFeatures,
+              &scores[0], orders[o], static_cast<LinearScorer::Kernel>(kernel));
+          for (size_t i = 0; i < numRows; ++i) {
+            EXPECT_EQ(expected[i], scores[i])
+                << LinearScorer::getKernelName(
+                       static_cast<LinearScorer::Kernel>(kernel))
+                << ", " << numRows << " rows, " << numFeatures
+                << " features, row " << i;
+          }
+        }
+      }
+    }
+  }
+}
@@ -21,6 +21,7 @@
 
 #include <gtest/gtest.h>
 #include "PSMDescription.h"
+#include "PSMArena.h"
 
 TEST(PSMDescriptionTest, CheckRemovePTMs)
 {
@@ -45,3 +46,98 @@ TEST(PSMDescriptionTest, CheckRemovePTMsWithModifications)
     ASSERT_EQ("A.BCcD.E", PSMDescription::removePTMs("A.BCc[2]D.E"));
     ASSERT_EQ("A.cBCDn.E", PSMDescription::removePTMs("A.c[1]BCDn[2].E"));
 }
+
+TEST(PSMDescriptionTest, CheckProteinNameInterning)
+{
+    std::vector<std::string> names;
+    names.push_back("protA");
+    names.push_back("decoy_protA");
+    PSMDescription first, second;
+    first.setProteins(names);
+    names.pop_back();
+    second.setProteins(names);
+
+    ASSERT_EQ(2u, first.getProteinIds().size());
+    ASSERT_EQ(1u, second.getProteinIds().size());
+    EXPECT_EQ(first.getProteinIds()[0], second.getProteinIds()[0]);
+    EXPECT_NE(first.getProteinIds()[0], first.getProteinIds()[1]);
+    EXPECT_EQ("protA", PSMDescription::getProteinName(second.getProteinIds()[0]));
+    EXPECT_EQ("decoy_protA", PSMDescription::getProteinName(first.getProteinIds()[1]));
+
+    first.clear();
+    EXPECT_TRUE(first.getProteinIds().empty());
+}
+
+TEST(PSMDescriptionTest, CheckArenaOwnedStrings)
+{
+    PSMArena arena;
+    PSMDescription* psm = arena.create();
+    {
+      std::string id = "file1_scan3";
+      std::string peptide = "K.PEPTIDER.A";
+      psm->setId(StringRef(id));
+      psm->setPeptide(StringRef(peptide));
+      arena.storeStrings(psm);
+    }
+    // the views must no longer refer to the destroyed locals
+    EXPECT_EQ("file1_scan3", psm->getId());
+    EXPECT_EQ("K.PEPTIDER.A", psm->getFullPeptide());
+    EXPECT_EQ("PEPTIDER", psm->getFullPeptideRef().subref(2, 8).str());
+
+    StringRef large = arena.storeString(std::string(1u << 20, 'x'));
+    EXPECT_EQ(1u << 20, large.size());
+    EXPECT_EQ("file1_scan3", psm->getId());
+    arena.clear();
+}
+
+TEST(PSMDescriptionTest, CheckDeferredProteinList)
+{
+    std::string line = "protB\tdecoy_protB";
+    PSMDescription psm;
+    psm.setProteinList(StringRef(line));
+    ASSERT_EQ(2u, psm.getProteinIds().size());
+    EXPECT_EQ("protB", PSMDescription::getProteinName(psm.getProteinIds()[0]));
+    EXPECT_EQ("decoy_protB", 
+              PSMDescription::getProteinName(psm.getProteinIds()[1]));
+
+    std::vector<std::string> names(1, "protC");
+    psm.setProteins(names);
+    ASSERT_EQ(1u, psm.getProteinIds().size());
+    EXPECT_EQ("protC", PSMDescription::getProteinName(psm.getProteinIds()[0]));
+}
+
+TEST(PSMDescriptionTest, CheckFirstProteinName)
+{
+    std::string line = "\tprotD\tdecoy_protD";
+    PSMDescription psm;
+    psm.setProteinList(StringRef(line));
+    size_t numProteinNames = PSMDescription::getNumProteinNames();
+    EXPECT_EQ("protD", psm.getFirstProteinName().str());
+    // the deferred proteins are not decoded for it
+    EXPECT_EQ(numProteinNames, PSMDescription::getNumProteinNames());
+
+    size_t pos = 0u;
+    StringRef name;
+    std::vector<std::string> names;
+    while (PSMDescription::nextProteinName(StringRef(line), pos, name)) {
+        names.push_back(name.str());
+    }
+    std::vector<std::string> splitNames;
+    PSMDescription::splitProteinList(StringRef(line), splitNames);
+    ASSERT_EQ(2u, names.size());
+    EXPECT_EQ(splitNames, names);
+
+    // other separators split the first column only
+    PSMDescription::setProteinNameSeparator(",");
+    std::string commaLine = ",protE,,decoy_protE\tprotF";
+    PSMDescription::splitProteinList(StringRef(commaLine), splitNames);
+    PSMDescription::setProteinNameSeparator("\t");
+    ASSERT_EQ(2u, splitNames.size());
+    EXPECT_EQ("protE", splitNames[0]);
+    EXPECT_EQ("decoy_protE", splitNames[1]);
+
+    psm.setProteins(names);
+    EXPECT_EQ("protD", psm.getFirstProteinName().str());
+    psm.clear();
+    EXPECT_TRUE(psm.getFirstProteinName().empty());
+}
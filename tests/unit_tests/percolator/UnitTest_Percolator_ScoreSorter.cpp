@@ -0,0 +1,112 @@
+/*
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ * http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ *
+ */
+
+/*
+ * Unit tests for ScoreSorter, which has to order the ScoreHolders as
+ * std::stable_sort with the ScoreHolder comparison operators does.
+ */
+
+#include <gtest/gtest.h>
+
+#include <algorithm>
+#include <functional>
+#include <vector>
+
+#include "ScoreSorter.h"
+
+class ScoreSorterTest : public ::testing::Test {
+ protected:
+  // scores with many ties, negative scores and both signed zeros, enough of
+  // them to be radix sorted
+  virtual void SetUp() {
+    for (unsigned int i = 0; i < 5000u; ++i) {
+      PSMDescription* pPSM = new PSMDescription();
+      pPSM->scan = (i * 7919u) % 613u;
+      pPSM->expMass = 100.0 + (i % 5u);
+      psms_.push_back(pPSM);
+      double score = ((i * 104729u) % 331u) * 0.25 - 40.0;
+      if (i % 97u == 0u) score = (i % 2u) ? -0.0 : 0.0;
+      scores_.push_back(ScoreHolder(score,
+          (i % 3u) ? LabelType::TARGET : LabelType::DECOY, pPSM));
+    }
+  }
+
+  virtual void TearDown() {
+    for (size_t i = 0; i < psms_.size(); ++i) delete psms_[i];
+  }
+
+  static void expectSameOrder(const std::vector<ScoreHolder>& expected,
+                              const std::vector<ScoreHolder>& sorted) {
+    ASSERT_EQ(expected.size(), sorted.size());
+    // the same PSMs, also where the operators consider them equal
+    for (size_t i = 0; i < expected.size(); ++i) {
+      EXPECT_EQ(expected[i].pPSM, sorted[i].pPSM) << "at " << i;
+    }
+  }
+
+  std::vector<PSMDescription*> psms_;
+  std::vector<ScoreHolder> scores_;
+};
+
+TEST_F(ScoreSorterTest, CheckSortDescending) {
+  std::vector<ScoreHolder> expected(scores_);
+  std::stable_sort(expected.begin(), expected.end(),
+                   std::greater<ScoreHolder>());
+  ScoreSorter::sortDescending(scores_.begin(), scores_.end());
+  expectSameOrder(expected, scores_);
+}
+
+TEST_F(ScoreSorterTest, CheckSortAscending) {
+  std::vector<ScoreHolder> expected(scores_);
+  std::stable_sort(expected.begin(), expected.end());
+  ScoreSorter::sortAscending(scores_.begin(), scores_.end());
+  expectSameOrder(expected, scores_);
+}
+
+TEST_F(ScoreSorterTest, CheckOrdersFromScoreColumn) {
+  // new scores in a separate column, the ScoreHolders keep their old ones
+  std::vector<double> scores(scores_.size());
+  std::vector<ScoreHolder> expected(scores_);
+  for (size_t i = 0; i < scores_.size(); ++i) {
+    scores[i] = ((i * 7u) % 41u) * -0.5;
+    expected[i].score = scores[i];
+  }
+  std::vector<const PSMDescription*> psms(scores_.size());
+  std::vector<LabelType> labels(scores_.size());
+  for (size_t i = 0; i < scores_.size(); ++i) {
+    psms[i] = scores_[i].pPSM;
+    labels[i] = scores_[i].label;
+  }
+  std::vector<uint32_t> order;
+  std::vector<ScoreHolder> sorted;
+  for (int descending = 0; descending < 2; ++descending) {
+    std::vector<ScoreHolder> expectedSorted(expected);
+    if (descending) {
+      std::stable_sort(expectedSorted.begin(), expectedSorted.end(),
+                       std::greater<ScoreHolder>());
+      ScoreSorter::getDescendingOrder(&scores[0], &psms[0], &labels[0],
+                                      scores_.size(), order);
+    } else {
+      std::stable_sort(expectedSorted.begin(), expectedSorted.end());
+      ScoreSorter::getAscendingOrder(&scores[0], &psms[0], &labels[0],
+                                     scores_.size(), order);
+    }
+    sorted.clear();
+    for (size_t i = 0; i < order.size(); ++i) {
+      sorted.push_back(scores_[order[i]]);
+    }
+    expectSameOrder(expectedSorted, sorted);
+  }
+}
@@ -59,7 +59,7 @@ TEST_F(ScoreHolderTest, CheckOrderingFunctions)
     // scan values are assigned [ 2, 3, 4, 0, 1 ]
     scores.clear();
     for (int i = 0 ; i < 5 ; ++i) {
-        PSMDescription *pPSM = new PSMDescription(psmNames[i]);
+        PSMDescription *pPSM = new PSMDescription(StringRef(psmNames[i]));
         pPSM->scan = (i + 2) % 5;
         scores.push_back(ScoreHolder(1.0 + i, LabelType::TARGET, pPSM));
     }
@@ -72,7 +72,7 @@ TEST_F(ScoreHolderTest, CheckOrderingFunctions)
     // scan values are assigned [ 0, 0, 1, 1, 2]
     scores.clear();
     for (int i = 0 ; i < 5 ; ++i) {
-        PSMDescription *pPSM = new PSMDescription(psmNames[i]);
+        PSMDescription *pPSM = new PSMDescription(StringRef(psmNames[i]));
         pPSM->specFileNr = 3 + i / 2;
         pPSM->scan = i / 2;
         scores.push_back(ScoreHolder(1.0 + i, LabelType::TARGET, pPSM));
@@ -87,7 +87,7 @@ TEST_F(ScoreHolderTest, CheckOrderingFunctions)
     // scan values are assigned [ 2, 3, 4, 0, 1 ]
     scores.clear();
     for (int i = 0 ; i < 5 ; ++i) {
-        PSMDescription *pPSM = new PSMDescription(psmNames[i]);
+        PSMDescription *pPSM = new PSMDescription(StringRef(psmNames[i]));
         pPSM->specFileNr = i / 2;
         pPSM->scan = (i + 2) % 5;
         scores.push_back(ScoreHolder(1.0 + i, LabelType::TARGET, pPSM));
@@ -130,7 +130,7 @@ TEST_F(ScoreHolderTest, CheckUniquenessFilter)
     // scan values are assigned [ 0, 0, 1, 1, 2 ]
     scores.clear();
     for (int i = 0 ; i < 5 ; ++i) {
-        PSMDescription *pPSM = new PSMDescription(psmNames[i]);
+        PSMDescription *pPSM = new PSMDescription(StringRef(psmNames[i]));
         pPSM->scan = i / 2;
         scores.push_back(ScoreHolder(1.0 + i, LabelType::TARGET, pPSM));
     }
@@ -145,7 +145,7 @@ TEST_F(ScoreHolderTest, CheckUniquenessFilter)
     // scan values are assigned [ 0, 0, 1, 1, 2 ]
     scores.clear();
     for (int i = 0 ; i < 5 ; ++i) {
-        PSMDescription *pPSM = new PSMDescription(psmNames[i]);
+        PSMDescription *pPSM = new PSMDescription(StringRef(psmNames[i]));
         pPSM->specFileNr = i / 3;
         pPSM->scan = i / 2;
         scores.push_back(ScoreHolder(1.0 + i, LabelType::TARGET, pPSM));
@@ -187,10 +187,10 @@ TEST_F(ScoresTest, CheckPopulating)
     set2->setLabel(LabelType::DECOY);
     for (int i = 0 ; i < 5 ; ++i) {
         PSMDescription *psm;
-        psm = new PSMDescription(psmNames[i]);
+        psm = new PSMDescription(StringRef(psmNames[i]));
         psm->scan = 100 + i;
         set1->registerPsm(psm);
-        psm = new PSMDescription(psmNames[i]);
+        psm = new PSMDescription(StringRef(psmNames[i]));
         psm->scan = 105 + i;
         set2->registerPsm(psm);
     }
@@ -201,7 +201,7 @@ TEST_F(ScoresTest, CheckPopulating)
     ASSERT_EQ(10, scores.size());
 
     unsigned scanValue = 100;
-    for (std::vector<ScoreHolder>::const_iterator it = scores.begin() ;
+    for (Scores::const_iterator it = scores.begin() ;
             it != scores.end() ;
             it++, scanValue++) {
         ASSERT_EQ(scanValue, it->pPSM->scan);
@@ -222,3 +222,72 @@ TEST_F(ScoresTest, CheckPopulatingEmpty)
     setHandler.push_back_dataset(set2);
     EXPECT_THROW(scores.populateWithPSMs(setHandler), MyException);
 }
+
+// Test that weedOutRedundantTDC() keeps the best scoring PSM of each 
+// spectrum, where a spectrum is identified by file, scan and mass.
+TEST_F(ScoresTest, CheckTargetDecoyCompetition)
+{
+    Scores scores(true);
+    // specFileNr, scan, expMass, score, label
+    const unsigned int specFileNrs[] = { 0u, 0u, 1u, 0u, 1u };
+    const unsigned int scans[] = { 1u, 1u, 1u, 1u, 1u };
+    const double expMasses[] = { 500.0, 500.0, 500.0, 600.0, 500.0 };
+    const double scoreValues[] = { 1.0, 2.0, 3.0, 0.5, -1.0 };
+    const LabelType labels[] = { LabelType::TARGET, LabelType::DECOY, 
+        LabelType::TARGET, LabelType::DECOY, LabelType::DECOY };
+    for (int i = 0 ; i < 5 ; ++i) {
+        PSMDescription *pPSM = new PSMDescription(StringRef(psmNames[i]));
+        pPSM->specFileNr = specFileNrs[i];
+        pPSM->scan = scans[i];
+        pPSM->expMass = expMasses[i];
+        pPSM->internSpectrumId();
+        scores.addScoreHolder(ScoreHolder(scoreValues[i], labels[i], pPSM));
+    }
+    scores.weedOutRedundantTDC();
+    ASSERT_EQ(3u, scores.size());
+    EXPECT_EQ(1u, scores.posSize());
+    EXPECT_EQ(2u, scores.negSize());
+    
+    const double expectedScores[] = { 3.0, 2.0, 0.5 };
+    int i = 0;
+    for (Scores::const_iterator it = scores.begin() ; it != scores.end() ; 
+            ++it, ++i) {
+        EXPECT_EQ(expectedScores[i], it->score);
+    }
+}
+
+// Test that countTargetsBelowFdr() counts as many targets below the FDR
+// threshold as calcScoresAndQvals(), also with tied scores.
+TEST_F(ScoresTest, CheckCountTargetsBelowFdr)
+{
+    size_t origNumFeatures = FeatureNames::getNumFeatures();
+    FeatureNames::setNumFeatures(2);
+    Scores scores(false);
+    for (int i = 0 ; i < 600 ; ++i) {
+        PSMDescription *pPSM = new PSMDescription();
+        pPSM->features = new FeatureType[2];
+        pPSM->features[0] = static_cast<FeatureType>((i * 37) % 101);
+        pPSM->features[1] = static_cast<FeatureType>(i % 7);
+        pPSM->scan = i;
+        bool isTarget = (i % 3 != 0) || (i % 101 < 20);
+        scores.addScoreHolder(ScoreHolder(0.0, 
+            isTarget ? LabelType::TARGET : LabelType::DECOY, pPSM));
+    }
+    scores.postMergeStep();
+
+    double weights[][3] = { { 1.0, 0.5, -2.0 }, { -0.3, 1.0, 0.0 }, 
+                            { 0.0, 0.0, 1.0 } };
+    double fdrs[] = { 0.0, 0.01, 0.05, 0.3, 1.0 };
+    for (int k = 0 ; k < 3 ; ++k) {
+        std::vector<double> w(weights[k], weights[k] + 3);
+        for (int f = 0 ; f < 5 ; ++f) {
+            for (int skip = 0 ; skip < 2 ; ++skip) {
+                int count = scores.countTargetsBelowFdr(w, fdrs[f], skip == 1);
+                Scores copy(scores);
+                EXPECT_EQ(copy.calcScoresAndQvals(w, fdrs[f], skip == 1), count)
+                    << "weights " << k << ", fdr " << fdrs[f];
+            }
+        }
+    }
+    FeatureNames::setNumFeatures(origNumFeatures);
+}
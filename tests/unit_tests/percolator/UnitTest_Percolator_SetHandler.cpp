@@ -19,6 +19,10 @@
 #include <sstream>
 #include "SetHandler.h"
 
+#ifdef _OPENMP
+#include <omp.h>
+#endif
+
 /* A simple class that tracks global deletions.
  */
 class DeletionTracker {
@@ -161,3 +165,258 @@ TEST_F(SetHandlerTest, TestReadWithFeatures)
             "id05\t-1\t3838.10\t2837.188\t0.021003\t0.021003\tPEP\tPRO\n"
             "id06\t-1\t2182.15\t2182.175\t-0.02667\t0.026670\tPEP\tPRO\n"));
 }
+
+// Verify that PSMs parsed in parallel end up in the sets in input order and
+// that the concatenated search detection sees all of them (every scan has
+// both a target and a decoy PSM, i.e. separate searches).
+TEST_F(SetHandlerTest, TestReadKeepsInputOrder)
+{
+#ifdef _OPENMP
+    int numThreads = omp_get_max_threads();
+    omp_set_num_threads(4);
+#endif
+    std::ostringstream input;
+    input << "id\tLabel\tScanNr\tExpMass\tFeature\tPeptide\tProtein\n";
+    for (int i = 0; i < 5000; ++i) {
+        input << "t" << i << "\t1\t" << i << "\t1000.5\t" << i
+              << "\tK.PEPTIDE.R\tPROT\n";
+        input << "d" << i << "\t-1\t" << i << "\t1000.5\t" << -i
+              << "\tK.EDITPEP.R\tdecoy_PROT\n";
+    }
+    std::istringstream str(input.str());
+    SetHandler sh(0);
+    SanityCheck *pCheck = NULL;
+    EXPECT_EQ(1, sh.readTab(str, pCheck));
+#ifdef _OPENMP
+    omp_set_num_threads(numThreads);
+#endif
+    ASSERT_TRUE(pCheck != NULL);
+    EXPECT_FALSE(pCheck->concatenatedSearch());
+    delete pCheck;
+
+    std::vector<ScoreHolder> targets, decoys;
+    sh.populateScoresWithPSMs(targets, LabelType::TARGET);
+    sh.populateScoresWithPSMs(decoys, LabelType::DECOY);
+    ASSERT_EQ(5000u, targets.size());
+    ASSERT_EQ(5000u, decoys.size());
+    for (int i = 0; i < 5000; ++i) {
+        std::ostringstream id;
+        id << "t" << i;
+        EXPECT_EQ(id.str(), targets[i].pPSM->getId());
+        EXPECT_EQ(static_cast<unsigned int>(i), targets[i].pPSM->scan);
+        EXPECT_EQ(static_cast<double>(-i), decoys[i].pPSM->features[0]);
+    }
+}
+
+// Verify that rescoring a -N run from the spill and the score-only parsing
+// of readAndScoreTab both give every PSM of the input w*x + b, in input order.
+TEST_F(SetHandlerTest, TestScoreAllPsms)
+{
+#ifdef _OPENMP
+    int numThreads = omp_get_max_threads();
+    omp_set_num_threads(4);
+#endif
+    std::ostringstream input;
+    input << "id\tLabel\tScanNr\tFeature1\tFeature2\tPeptide\tProtein\n";
+    for (int i = 0; i < 3000; ++i) {
+        input << "psm" << i << "\t" << (i % 3 == 0 ? "-1" : "1") << "\t" << i 
+              << "\t" << i << "\t" << 0.5 * i << "\tK.PEPTIDE.R\tPROT" << i % 7 
+              << "\n";
+    }
+    std::vector<double> rawWeights;
+    rawWeights.push_back(2.0);
+    rawWeights.push_back(-1.0);
+    rawWeights.push_back(0.25);
+
+    std::istringstream subsetStream(input.str());
+    SetHandler subsetSh(100);
+    SanityCheck *pCheck = NULL;
+    EXPECT_EQ(1, subsetSh.readTab(subsetStream, pCheck));
+    delete pCheck;
+    pCheck = NULL;
+    EXPECT_EQ(100, subsetSh.getSizeFromLabel(LabelType::TARGET) + 
+                   subsetSh.getSizeFromLabel(LabelType::DECOY));
+    ASSERT_TRUE(subsetSh.hasPSMSpill());
+    Scores spillScores(false);
+    EXPECT_EQ(1, subsetSh.readAndScoreSpill(rawWeights, spillScores));
+    
+    std::istringstream scoreStream(input.str());
+    SetHandler scoreSh(0);
+    Scores tabScores(false);
+    EXPECT_EQ(1, scoreSh.readAndScoreTab(scoreStream, rawWeights, tabScores, 
+                                         pCheck));
+#ifdef _OPENMP
+    omp_set_num_threads(numThreads);
+#endif
+    
+    ASSERT_EQ(3000u, spillScores.size());
+    ASSERT_EQ(3000u, tabScores.size());
+    for (int i = 0; i < 3000; ++i) {
+        std::ostringstream id, protein;
+        id << "psm" << i;
+        protein << "PROT" << i % 7;
+        double expected = 2.0 * i - 0.5 * i + 0.25;
+        for (Scores* scores : { &spillScores, &tabScores }) {
+            const ScoreHolder& sh = *(scores->begin() + i);
+            EXPECT_EQ(id.str(), sh.pPSM->getId());
+            EXPECT_EQ(i % 3 == 0, sh.isDecoy());
+            EXPECT_DOUBLE_EQ(expected, sh.score);
+            ASSERT_EQ(1u, sh.pPSM->getProteinIds().size());
+            EXPECT_EQ(protein.str(), 
+                      PSMDescription::getProteinName(sh.pPSM->getProteinIds()[0]));
+        }
+    }
+}
+
+// Verify that hash sampling keeps about maxPSMs PSMs, and either all or
+// none of the PSMs of a spectrum.
+TEST_F(SetHandlerTest, TestSubsetHashSampling)
+{
+    const std::string pinFN("sethandler_test_sampling.pin");
+    {
+        std::ofstream pin(pinFN.c_str());
+        pin << "id\tLabel\tScanNr\tExpMass\tFeature\tPeptide\tProtein\n";
+        for (int i = 0; i < 4000; ++i) {
+            pin << "t" << i << "\t1\t" << i << "\t1000.5\t" << i
+                << "\tK.PEPTIDE.R\tPROT\n";
+            pin << "d" << i << "\t-1\t" << i << "\t1000.5\t" << -i
+                << "\tK.EDITPEP.R\tdecoy_PROT\n";
+        }
+    }
+    MemoryMappedFileStream str;
+    ASSERT_TRUE(str.open(pinFN));
+    SetHandler sh(1000);
+    sh.setSubsetHashSampling(true);
+    SanityCheck *pCheck = NULL;
+    EXPECT_EQ(1, sh.readTab(str, pCheck));
+    ASSERT_TRUE(pCheck != NULL);
+    EXPECT_FALSE(pCheck->concatenatedSearch());
+    delete pCheck;
+    EXPECT_FALSE(sh.hasPSMSpill());
+    
+    std::vector<ScoreHolder> targets, decoys;
+    sh.populateScoresWithPSMs(targets, LabelType::TARGET);
+    sh.populateScoresWithPSMs(decoys, LabelType::DECOY);
+    EXPECT_NEAR(1000.0, static_cast<double>(targets.size() + decoys.size()), 
+                200.0);
+    ASSERT_EQ(targets.size(), decoys.size());
+    for (size_t i = 0; i < targets.size(); ++i) {
+        EXPECT_EQ(targets[i].pPSM->scan, decoys[i].pPSM->scan);
+    }
+    std::remove(pinFN.c_str());
+}
+
+// Verify that the PSMs evicted by reservoir sampling are reused, so that the
+// arena holds about maxPSMs PSMs after streaming many more through it.
+TEST_F(SetHandlerTest, TestSubsetReservoirReusesPsms)
+{
+    const std::string pinFN("sethandler_test_reservoir.pin");
+    const unsigned int numPsms = 20000u, maxPSMs = 100u;
+    {
+        std::ofstream pin(pinFN.c_str());
+        pin << "id\tLabel\tScanNr\tExpMass\tFeature\tPeptide\tProtein\n";
+        for (unsigned int i = 0; i < numPsms; ++i) {
+            pin << "psm_" << i << "\t" << (i % 2 == 0 ? "1" : "-1") << "\t"
+                << i << "\t1000.5\t" << i << "\tK." 
+                << std::string(5u + i % 20u, 'A') << ".R\tPROT\n";
+        }
+    }
+    MemoryMappedFileStream str;
+    ASSERT_TRUE(str.open(pinFN));
+    SetHandler sh(maxPSMs);
+    SanityCheck *pCheck = NULL;
+    EXPECT_EQ(1, sh.readTab(str, pCheck));
+    delete pCheck;
+    
+    std::vector<ScoreHolder> targets, decoys;
+    sh.populateScoresWithPSMs(targets, LabelType::TARGET);
+    sh.populateScoresWithPSMs(decoys, LabelType::DECOY);
+    EXPECT_EQ(maxPSMs, targets.size() + decoys.size());
+    // one more PSM is held while the lowest priority one is evicted
+    EXPECT_EQ(maxPSMs + 1u, sh.getPSMArena().getNumPsmSlots());
+    size_t maxPsmBytes = sizeof(PSMDescription) + 2u * 32u;
+    EXPECT_LT(sh.getPSMArena().getNumBytes(), 2u * maxPSMs * maxPsmBytes);
+    std::remove(pinFN.c_str());
+}
+
+// Verify that the decoy prefix is derived from the decoy proteins while
+// reading when it is set to "auto".
+TEST_F(SetHandlerTest, TestDetectDecoyPrefix)
+{
+    SetHandler sh(0);
+    std::string decoyPrefix("auto");
+    sh.setDecoyPrefix(decoyPrefix);
+    EXPECT_TRUE(testInput(&sh,
+            "id\tLabel\tFeature\tPeptide\tProteins\n"
+            "t1\t1\t1.0\tK.PEPTIDE.R\tsp|P1|PROT1\n"
+            "d1\t-1\t0.5\tK.EDITPEP.R\trev_sp|P2|PROT2\trev_sp|P1|PROT1\n"
+            "d2\t-1\t0.2\tK.DEPTIPE.R\trev_sp|Q3|PROT3\n"));
+    EXPECT_EQ("rev_", sh.getDecoyPrefix());
+
+    SetHandler fixedSh(0);
+    decoyPrefix = "decoy_";
+    fixedSh.setDecoyPrefix(decoyPrefix);
+    EXPECT_EQ("decoy_", fixedSh.getDecoyPrefix());
+}
+
+// Verify that the PSMs read back from a pin cache match the parsed input, 
+// and that a cache made from other input is not used.
+TEST_F(SetHandlerTest, TestReadCache)
+{
+    const std::string cacheFN("sethandler_test.pincache");
+    std::vector<std::string> ids, proteins;
+    std::vector<double> features;
+    {
+        SetHandler sh(0);
+        std::istringstream str(
+            "id\tLabel\tScanNr\tExpMass\tF1\tF2\tPeptide\tProteins\n"
+            "DefaultDirection\t-\t-\t-\t1\t0\n"
+            "t1\t1\t1\t900.5\t1.5\t-2\tK.PEPTIDE.R\tP1\tP2\n"
+            "d1\t-1\t1\t900.5\t0.5\t3\tK.EDITPEP.R\tdecoy_P1\n"
+            "t2\t1\t2\t1000.25\t2.5\t4\tK.PEPTIDE.R\tP3\n");
+        SanityCheck *pCheck = NULL;
+        ASSERT_EQ(1, sh.readTab(str, pCheck));
+        EXPECT_TRUE(sh.writeCache(cacheFN, "input", pCheck));
+        delete pCheck;
+        for (unsigned int ix = 0; ix < 2u; ++ix) {
+            const std::vector<PSMDescription*>& psms = sh.getSubset(ix)->getPsms();
+            for (size_t i = 0; i < psms.size(); ++i) {
+                ids.push_back(psms[i]->getId());
+                proteins.push_back(PSMDescription::getProteinName(
+                    psms[i]->getProteinIds().back()));
+                features.push_back(psms[i]->features[0]);
+                features.push_back(psms[i]->features[1]);
+            }
+        }
+    }
+    SanityCheck *pCheck = NULL;
+    SetHandler otherSh(0);
+    EXPECT_FALSE(otherSh.readCache(cacheFN, "other input", pCheck));
+    
+    SetHandler sh(0);
+    ASSERT_TRUE(sh.readCache(cacheFN, "input", pCheck));
+    ASSERT_TRUE(pCheck != NULL);
+    EXPECT_FALSE(pCheck->concatenatedSearch());
+    ASSERT_EQ(2u, SanityCheck::getDefaultWeights().size());
+    EXPECT_EQ(1.0, SanityCheck::getDefaultWeights()[0]);
+    delete pCheck;
+    EXPECT_EQ(2u, DataSet::getNumFeatures());
+    EXPECT_EQ("F2", DataSet::getFeatureNames().getFeatureName(1));
+    
+    size_t k = 0;
+    for (unsigned int ix = 0; ix < 2u; ++ix) {
+        const std::vector<PSMDescription*>& psms = sh.getSubset(ix)->getPsms();
+        for (size_t i = 0; i < psms.size(); ++i, ++k) {
+            ASSERT_LT(k, ids.size());
+            EXPECT_EQ(ids[k], psms[i]->getId());
+            EXPECT_EQ(proteins[k], PSMDescription::getProteinName(
+                psms[i]->getProteinIds().back()));
+            EXPECT_EQ(features[2 * k], psms[i]->features[0]);
+            EXPECT_EQ(features[2 * k + 1], psms[i]->features[1]);
+        }
+    }
+    EXPECT_EQ(ids.size(), k);
+    EXPECT_EQ(2u, sh.getSubsetFromLabel(LabelType::TARGET)->getSize());
+    EXPECT_EQ(900.5, sh.getSubsetFromLabel(LabelType::DECOY)->getPsms()[0]->expMass);
+    std::remove(cacheFN.c_str());
+}
@@ -75,6 +75,9 @@ TEST_F(TabReaderTest, CheckReadInt)
     tryValidInt("-2147483648", -2147483648);
     tryInvalidInt("100000000000000000000000");
     tryInvalidInt("-100000000000000000000000");
+    tryInvalidInt("2147483648");
+    tryInvalidInt("1.5");
+    tryValidInt("+0007", 7);
 }
 
 // What is and isn't a valid real number.
@@ -87,6 +90,27 @@ TEST_F(TabReaderTest, CheckReadDouble)
     tryInvalidDouble("x1.5");
     tryInvalidDouble("1:5");
     tryInvalidDouble("15:");
+
+    // the fast decoder and the strtod fallback have to agree with strtod
+    const char* numbers[] = { "0.1", "-0.0", "3.14159265358979", "1e22", 
+        "1e23", "2.5E-7", "123456789012345678901234", "0.000001234567", 
+        "1e-320", "1.", ".5", "0x1p3", "inf", "-nan", "9007199254740993" };
+    for (size_t i = 0; i < sizeof(numbers) / sizeof(numbers[0]); ++i) {
+        TabReader reader(numbers[i], strlen(numbers[i]));
+        double d = reader.readDouble();
+        double expected = strtod(numbers[i], NULL);
+        if (std::isnan(expected)) {
+            EXPECT_TRUE(std::isnan(d)) << numbers[i];
+        } else {
+            EXPECT_EQ(expected, d) << numbers[i];
+            EXPECT_EQ(std::signbit(expected), std::signbit(d)) << numbers[i];
+        }
+        EXPECT_FALSE(reader.error()) << numbers[i];
+    }
+    tryInvalidDouble("1e");
+    tryInvalidDouble("1e400");
+    tryInvalidDouble("-");
+    tryInvalidDouble(".");
 }
 
 // Tests reading a sequence of fields, including skipping fields.
@@ -104,3 +128,23 @@ TEST_F(TabReaderTest, CheckSequentialReading)
     reader.readInt();
     ASSERT_TRUE(reader.error());
 }
+
+// Tests reading from a view of a line that is not null terminated, as done
+// for memory mapped input.
+TEST_F(TabReaderTest, CheckReadingFromView)
+{
+    const char* buffer = "id\t-1\t2.5\tPEPTIDE\tPROT\nnext\t1";
+    TabReader reader(buffer, 22);
+    ASSERT_EQ("id", reader.readString());
+    ASSERT_EQ(-1, reader.readInt());
+    ASSERT_EQ(2.5, reader.readDouble());
+    ASSERT_EQ("PEPTIDE", reader.readString());
+    ASSERT_FALSE(reader.error());
+    ASSERT_EQ("PROT", reader.readString());
+    ASSERT_TRUE(reader.error());
+
+    const char* number = "1.5e3x";
+    TabReader numberReader(number, 5);
+    ASSERT_EQ(1500.0, numberReader.readDouble());
+    ASSERT_FALSE(numberReader.error());
+}
@@ -0,0 +1,74 @@
+/*
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ * http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ *
+ */
+
+#include <gtest/gtest.h>
+#include <cstdio>
+#include <fstream>
+#include <sstream>
+#include "ValidateTabFile.h"
+
+/*
+ * Unit tests for reading multiple pin files as one.
+ */
+
+class MultiPinStreamTest : public ::testing::Test {
+  protected:
+    virtual void SetUp() {
+        Globals::getInstance()->setVerbose(0);
+        fileA_ = writeFile("multipin_test_a.pin",
+            "id\tLabel\tCharge2\tCharge3\tPeptide\tProteins\n"
+            "DefaultDirection\t-\t0\t1\n"
+            "a1\t1\t1\t0\tK.PEPTIDE.R\tP1\tP2\n");
+        fileB_ = writeFile("multipin_test_b.pin",
+            "id\tLabel\tCharge3\tPeptide\tProteins\n"
+            "DefaultDirection\t-\t1\n"
+            "b1\t-1\t1\tK.EDITPEP.R\tdecoy_P1\n"
+            "b2\t1\t1\tK.PEPTIDE.R\tP3");
+    }
+    virtual void TearDown() {
+        std::remove(fileA_.c_str());
+        std::remove(fileB_.c_str());
+    }
+    std::string writeFile(const std::string& fileName,
+                          const std::string& content) {
+        std::ofstream out(fileName.c_str());
+        out << content;
+        return fileName;
+    }
+    std::string fileA_, fileB_;
+};
+
+// Verify that missing columns are filled in with zeroes and that only the
+// first header and default direction rows are kept, also after rewinding.
+TEST_F(MultiPinStreamTest, CheckMergedContent)
+{
+    std::vector<std::string> fileNames;
+    fileNames.push_back(fileB_);
+    fileNames.push_back(fileA_);
+    MultiPinStream stream(fileNames);
+    const std::string expected =
+        "id\tLabel\tCharge2\tCharge3\tPeptide\tProteins\n"
+        "DefaultDirection\t-\t0\t1\n"
+        "b1\t-1\t0\t1\tK.EDITPEP.R\tdecoy_P1\n"
+        "b2\t1\t0\t1\tK.PEPTIDE.R\tP3\n"
+        "a1\t1\t1\t0\tK.PEPTIDE.R\tP1\tP2\n";
+    for (int pass = 0; pass < 2; ++pass) {
+        std::ostringstream content;
+        content << stream.rdbuf();
+        EXPECT_EQ(expected, content.str());
+        stream.clear();
+        stream.seekg(0, std::ios::beg);
+    }
+}